@@ -4,6 +4,7 @@
  *
  *
    count lines and their width using getline(3)
+   or a parallel mmap(2) based scanner
    Find large lines
 
    © Copyright (C) Basile Starynkevitch 2017 - 2026
@@ -23,129 +24,1619 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistr.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BWC_X86 1
+#endif
+
 const char *progname = NULL;
 bool emacsout = false;
 
 int linlargelimit = 80;		/// above that line width limit in
 				/// UTF8 glyphs large lines are
 				/// noticed
+
+bool bwc_indexing = false;	/// with --index, use and write sidecar
+				/// line indexes of regular files
+long bwc_linequery = 0;		/// with --line=N, print line N
+bool bwc_silent = false;	/// no reports, e.g. for --line
+const char *bwc_statsformat = NULL;	/// with --stats=text|json|csv,
+					/// width percentiles and histogram
+
+int nbthreads = 0;		/// with -j, number of threads scanning
+				/// mmap-ed files; 0 means online CPUs
+
+/// totals over all files, for the final summary
+int bwc_totfiles;
+long bwc_totlines;
+long bwc_totbytes;
+
+#define BWC_HUGE_LINE (1 << 20)	/// lines bigger than that are fatal
+#define BWC_MIN_CHUNK (1 << 20)	/// smallest mmap-ed chunk given to a thread
+#define BWC_MAX_THREADS 256
+#define BWC_STREAM_BUF (4 << 20)	/// buffer of streamed inputs, above
+					/// BWC_HUGE_LINE
+#define BWC_PIPE_SIZE (1 << 20)	/// wanted capacity of input pipes
+#define BWC_CHUNKS_PER_THREAD 4	/// helps balancing the work of threads
+#define BWC_FILES_PER_THREAD 4	/// bounds the reorder window of files
+#define BWC_INDEX_SUFFIX ".bwcidx"	/// sidecar line index of a file
+#define BWC_INDEX_MAGIC "BWCIDX1"
+#define BWC_INDEX_BLOCK 1024	/// lines per block of a line index
+
+/* The width histogram has HDR style log buckets: widths below
+   2<<BWC_HIST_SUBBITS are exact, then every power of two range is
+   split in 1<<BWC_HIST_SUBBITS buckets, so within 1/16 below 2**31,
+   the end of the last bucket, far above the widths of non huge lines */
+#define BWC_HIST_SUBBITS 4
+#define BWC_HIST_BUCKETS ((32 - BWC_HIST_SUBBITS) << BWC_HIST_SUBBITS)
+
+/// a malformed UTF8 line, reported after the scan
+struct bwc_malformed
+{
+  long mf_linum;		/// chunk relative line number, from 1
+  long mf_off;			/// absolute byte offset of that line
+};
+
+/// statistics of a whole file (with getline) or of one chunk of a
+/// mmap-ed file; line numbers there are relative to the chunk
+struct bwc_stats
+{
+  long st_lincnt;		/// number of lines
+  long st_linwidth;		/// widest valid line, in UTF8 glyphs
+  long st_widthsum;		/// sum of the widths of valid lines
+  uint64_t st_hist[BWC_HIST_BUCKETS];	/// widths of valid lines
+  long *st_largarr;		/// line numbers of large lines
+  int st_largcnt, st_largdim;
+  struct bwc_malformed *st_malfarr;	/// malformed lines
+  int st_malfcnt, st_malfdim;
+  long st_hugelin;		/// line number of the huge line, or 0
+  long st_hugeoff;		/// its byte offset
+  long st_hugebytes;		/// its size
+  /// when st_indexing, every line is encoded in st_idxbuf as the
+  /// varints of its byte size and of one plus its width (0 when
+  /// malformed), in blocks of BWC_INDEX_BLOCK lines
+  bool st_indexing;
+  uint8_t *st_idxbuf;
+  size_t st_idxlen, st_idxsiz;
+  struct bwc_idxblock *st_idxblocks;
+  int st_idxblkcnt, st_idxblkdim;
+};
+
+/// the header of a sidecar line index file, in host byte order; it
+/// is followed by ih_nbblocks blocks then by the varint stream
+struct bwc_idxhead
+{
+  char ih_magic[8];		/// BWC_INDEX_MAGIC
+  uint32_t ih_endian;		/// 0x01020304
+  uint32_t ih_blocklines;	/// BWC_INDEX_BLOCK
+  uint64_t ih_dev, ih_ino;	/// of the indexed file
+  int64_t ih_size;
+  int64_t ih_mtime_sec, ih_mtime_nsec;
+  int64_t ih_lincnt;
+  int64_t ih_linwidth;
+  int64_t ih_nbblocks;
+  int64_t ih_streamsize;
+};
+
+/// a block of lines in an index, summarized
+struct bwc_idxblock
+{
+  int64_t ib_firstline;		/// line number, from 0
+  int64_t ib_off;		/// byte offset of that line
+  int64_t ib_streampos;		/// position of its varints
+  int64_t ib_maxwidth;		/// widest valid line in the block
+  int64_t ib_nbmalformed;	/// malformed lines in the block
+};
+
+/// a mmap-ed sidecar index
+struct bwc_index
+{
+  void *ix_map;
+  size_t ix_mapsize;
+  const struct bwc_idxhead *ix_head;
+  const struct bwc_idxblock *ix_blocks;
+  const uint8_t *ix_stream;
+};
+
+/// a chunk of a mmap-ed file, starting after a newline
+struct bwc_chunk
+{
+  const char *ch_base;		/// start of the mmap-ed file
+  size_t ch_start, ch_end;	/// byte offsets of the chunk
+  struct bwc_stats ch_stats;
+};
+
+/// start times of a scan, for the cpu time and the throughput
+struct bwc_timer
+{
+  clock_t ti_cpu;
+  struct timespec ti_real;
+};
+
+/// a line scanning kernel: return the end of the line starting at p
+/// (just after its newline, or end), validating its UTF8 and counting
+/// its glyphs in *pwidth, or setting it to -1 for malformed UTF8
+typedef const char *bwc_scan_sig_t (const char *p, const char *end,
+				    long *pwidth);
+
+static bwc_scan_sig_t *bwc_scan_line;
+
+/// grow a dynamic array of elsize elements, keeping its cnt first ones
+static void
+bwc_grow (void **parr, int *pdim, int cnt, size_t elsize, const char *what)
+{
+  int newdim = ((*pdim + *pdim / 4 + 4) | 0xf) + 1;
+  void *newarr = calloc (newdim, elsize);
+  if (!newarr)
+    {
+      fprintf (stderr, "%s: calloc %s (newdim=%d) failed - %s\n",
+	       progname, what, newdim, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  if (cnt > 0)
+    memcpy (newarr, *parr, elsize * cnt);
+  free (*parr);
+  *parr = newarr;
+  *pdim = newdim;
+}				/* end bwc_grow */
+
+static void
+bwc_start_timer (struct bwc_timer *ti)
+{
+  ti->ti_cpu = clock ();
+  clock_gettime (CLOCK_MONOTONIC, &ti->ti_real);
+}				/* end bwc_start_timer */
+
+static void
+bwc_stop_timer (const struct bwc_timer *ti, double *pcput, double *prealt)
+{
+  struct timespec endts = { 0, 0 };
+  *pcput = (clock () - ti->ti_cpu) * 1.0e-6;
+  clock_gettime (CLOCK_MONOTONIC, &endts);
+  *prealt = (endts.tv_sec - ti->ti_real.tv_sec)
+    + 1.0e-9 * (endts.tv_nsec - ti->ti_real.tv_nsec);
+}				/* end bwc_stop_timer */
+
+static void
+bwc_free_stats (struct bwc_stats *st)
+{
+  free (st->st_largarr);
+  free (st->st_malfarr);
+  free (st->st_idxbuf);
+  free (st->st_idxblocks);
+  memset (st, 0, sizeof (*st));
+}				/* end bwc_free_stats */
+
+/* check the multibyte UTF8 character starting at p, like u8_check
+   does; return its end or NULL if it is malformed */
+static inline const char *
+bwc_utf8_char (const char *p, const char *end)
+{
+  const unsigned char *s = (const unsigned char *) p;
+  size_t n = (size_t) (end - p);
+  unsigned c = s[0];
+  if (c < 0x80)
+    return p + 1;
+  if (c < 0xc2)
+    return NULL;
+  if (c < 0xe0)
+    return (n >= 2 && (s[1] ^ 0x80) < 0x40) ? p + 2 : NULL;
+  if (c < 0xf0)
+    {
+      if (n < 3 || (s[1] ^ 0x80) >= 0x40 || (s[2] ^ 0x80) >= 0x40
+	  || (c == 0xe0 && s[1] < 0xa0) || (c == 0xed && s[1] >= 0xa0))
+	return NULL;
+      return p + 3;
+    };
+  if (c < 0xf5)
+    {
+      if (n < 4 || (s[1] ^ 0x80) >= 0x40 || (s[2] ^ 0x80) >= 0x40
+	  || (s[3] ^ 0x80) >= 0x40
+	  || (c == 0xf0 && s[1] < 0x90) || (c == 0xf4 && s[1] >= 0x90))
+	return NULL;
+      return p + 4;
+    };
+  return NULL;
+}				/* end bwc_utf8_char */
+
+static const char *
+bwc_skip_malformed (const char *p, const char *end, long *pwidth)
+{
+  const char *nl = memchr (p, '\n', (size_t) (end - p));
+  *pwidth = -1;
+  return nl ? nl + 1 : end;
+}				/* end bwc_skip_malformed */
+
+/* Define a line scanning kernel Name whose ASCII fast path Prefix
+   returns how many leading bytes of a block of Blk bytes are ASCII
+   but not newlines; other bytes are checked one character at a time */
+#define BWC_DEFINE_SCAN(Name,Blk,Prefix,...)				\
+__VA_ARGS__ static const char *						\
+Name (const char *p, const char *end, long *pwidth)			\
+{									\
+  long width = 0;							\
+  while (p < end)							\
+    {									\
+      if (p + (Blk) <= end)						\
+	{								\
+	  unsigned n = Prefix (p);					\
+	  p += n;							\
+	  width += n;							\
+	  if (n == (Blk))						\
+	    continue;							\
+	};								\
+      unsigned char c = (unsigned char) *p;				\
+      width++;								\
+      if (c < 0x80)							\
+	{								\
+	  p++;								\
+	  if (c == '\n')						\
+	    break;							\
+	  continue;							\
+	};								\
+      const char *nx = bwc_utf8_char (p, end);				\
+      if (!nx)								\
+	return bwc_skip_malformed (p, end, pwidth);			\
+      p = nx;								\
+    };									\
+  *pwidth = width;							\
+  return p;								\
+}
+
+/// portable kernel, skipping 8 ASCII bytes at a time
+static inline unsigned
+bwc_ascii_prefix_scalar (const char *p)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  const uint64_t ones = UINT64_C (0x0101010101010101);
+  const uint64_t highs = UINT64_C (0x8080808080808080);
+  uint64_t w = 0;
+  memcpy (&w, p, sizeof (w));
+  uint64_t x = w ^ (ones * '\n');
+  uint64_t stop = (w & highs) | ((x - ones) & ~x & highs);
+  return stop ? (unsigned) __builtin_ctzll (stop) / 8 : 8;
+#else
+  return (unsigned char) *p < 0x80 && *p != '\n';
+#endif
+}				/* end bwc_ascii_prefix_scalar */
+
+BWC_DEFINE_SCAN (bwc_scan_scalar, 8, bwc_ascii_prefix_scalar)
+#ifdef BWC_X86
+/// SSE2 kernel, skipping 32 ASCII bytes at a time
+static inline unsigned
+bwc_ascii_prefix_sse (const char *p)
+{
+  const __m128i nl = _mm_set1_epi8 ('\n');
+  __m128i a = _mm_loadu_si128 ((const __m128i *) p);
+  __m128i b = _mm_loadu_si128 ((const __m128i *) (p + 16));
+  /// or-ing the newline comparison sets the high bit of newlines
+  a = _mm_or_si128 (a, _mm_cmpeq_epi8 (a, nl));
+  b = _mm_or_si128 (b, _mm_cmpeq_epi8 (b, nl));
+  uint32_t stop = (uint32_t) _mm_movemask_epi8 (a)
+    | ((uint32_t) _mm_movemask_epi8 (b) << 16);
+  return stop ? (unsigned) __builtin_ctz (stop) : 32;
+}				/* end bwc_ascii_prefix_sse */
+
+BWC_DEFINE_SCAN (bwc_scan_sse, 32, bwc_ascii_prefix_sse)
+/// AVX2 kernel, skipping 64 ASCII bytes at a time
+__attribute__((target ("avx2")))
+static inline unsigned
+bwc_ascii_prefix_avx2 (const char *p)
+{
+  const __m256i nl = _mm256_set1_epi8 ('\n');
+  __m256i a = _mm256_loadu_si256 ((const __m256i *) p);
+  __m256i b = _mm256_loadu_si256 ((const __m256i *) (p + 32));
+  a = _mm256_or_si256 (a, _mm256_cmpeq_epi8 (a, nl));
+  b = _mm256_or_si256 (b, _mm256_cmpeq_epi8 (b, nl));
+  uint64_t stop = (uint32_t) _mm256_movemask_epi8 (a)
+    | ((uint64_t) (uint32_t) _mm256_movemask_epi8 (b) << 32);
+  return stop ? (unsigned) __builtin_ctzll (stop) : 64;
+}				/* end bwc_ascii_prefix_avx2 */
+
+BWC_DEFINE_SCAN (bwc_scan_avx2, 64, bwc_ascii_prefix_avx2,
+		 __attribute__((target ("avx2"))))
+#endif /*BWC_X86 */
+
+/// the kernels selectable with --kernel=
+static const struct bwc_kernel
+{
+  const char *ke_name;
+  bwc_scan_sig_t *ke_scan;
+  const char *ke_cpu;		/// needed CPU feature, or NULL
+} bwc_kernels[] =
+{
+  {"scalar", bwc_scan_scalar, NULL},
+#ifdef BWC_X86
+  {"sse", bwc_scan_sse, "sse2"},
+  {"avx2", bwc_scan_avx2, "avx2"},
+#endif /*BWC_X86 */
+  {NULL, NULL, NULL}
+};
+
+static bool
+bwc_kernel_supported (const struct bwc_kernel *ke)
+{
+  if (!ke->ke_cpu)
+    return true;
+#ifdef BWC_X86
+  __builtin_cpu_init ();
+  /// __builtin_cpu_supports wants a string literal
+  if (!strcmp (ke->ke_cpu, "sse2"))
+    return __builtin_cpu_supports ("sse2");
+  if (!strcmp (ke->ke_cpu, "avx2"))
+    return __builtin_cpu_supports ("avx2");
+#endif /*BWC_X86 */
+  return false;
+}				/* end bwc_kernel_supported */
+
+/* select the named kernel, or the best supported one for a NULL name */
+static void
+bwc_select_kernel (const char *name)
+{
+  for (const struct bwc_kernel * ke = bwc_kernels; ke->ke_name; ke++)
+    {
+      if (name ? strcmp (name, ke->ke_name) != 0 : !bwc_kernel_supported (ke))
+	continue;
+      if (!bwc_kernel_supported (ke))
+	{
+	  fprintf (stderr, "%s: kernel %s unsupported by this CPU\n",
+		   progname, name);
+	  exit (EXIT_FAILURE);
+	};
+      bwc_scan_line = ke->ke_scan;
+      if (name)
+	return;
+    };
+  if (name)
+    {
+      fprintf (stderr, "%s: unknown kernel %s\n", progname, name);
+      exit (EXIT_FAILURE);
+    };
+}				/* end bwc_select_kernel */
+
+/* check every supported kernel against libunistring on nbtests fuzzed
+   lines, mixing ASCII, valid and malformed UTF8; return the number of
+   mismatches */
+static int
+bwc_selftest (int nbtests)
+{
+  static const char *const pieces[] = {
+    "a", "hello ", "\n", "\t", "\x7f", "\xc2\x80", "\xdf\xbf", "é",
+    "\xe0\xa0\x80", "\xed\x9f\xbf", "\xee\x80\x80", "\xef\xbf\xbf", "日本語",
+    "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf", "😀",
+    /// malformed: overlong, surrogate, too big, stray and truncated
+    "\xc0\xaf", "\xc1\xbf", "\xe0\x9f\xbf", "\xed\xa0\x80", "\xf0\x8f\xbf\xbf",
+    "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xff", "\x80", "\xbf",
+    "\xc3", "\xe2\x82", "\xf0\x9f\x98",
+  };
+  const int nbpieces = (int) (sizeof (pieces) / sizeof (pieces[0]));
+  int nberr = 0;
+  char buf[1024];
+  long seed = (long) time (NULL);
+  srand48 (seed);
+  printf ("%s: selftest of %d lines with seed %ld\n", progname, nbtests,
+	  seed);
+  for (int t = 0; t < nbtests; t++)
+    {
+      /// most lines are long ASCII runs to exercise the fast paths
+      int first = 1 + (int) (lrand48 () % 7);	/// misalign the start
+      int len = first;
+      int nbp = (int) (lrand48 () % 48);
+      for (int i = 0; i < nbp && len < (int) sizeof (buf) - 80; i++)
+	{
+	  long r = lrand48 () % 100;
+	  if (r < 30)
+	    {
+	      int n = 1 + (int) (lrand48 () % 70);
+	      memset (buf + len, 'a' + (int) (r % 26), n);
+	      len += n;
+	    }
+	  else if (r < 35)
+	    buf[len++] = (char) (lrand48 () & 0xff);
+	  else
+	    {
+	      const char *pc = pieces[lrand48 () % nbpieces];
+	      if (pc[0] == '\n' && lrand48 () % 4)
+		continue;
+	      memcpy (buf + len, pc, strlen (pc));
+	      len += (int) strlen (pc);
+	    }
+	};
+      const char *start = buf + first;
+      const char *end = buf + len;
+      const char *nl = memchr (start, '\n', (size_t) (end - start));
+      const char *expeol = nl ? nl + 1 : end;
+      size_t explen = (size_t) (expeol - start);
+      long expwidth = -1;
+      if (!u8_check ((const uint8_t *) start, explen))
+	expwidth = (long) u8_mbsnlen ((const uint8_t *) start, explen);
+      for (const struct bwc_kernel * ke = bwc_kernels; ke->ke_name; ke++)
+	{
+	  if (!bwc_kernel_supported (ke))
+	    continue;
+	  long width = -2;
+	  const char *eol = ke->ke_scan (start, end, &width);
+	  if (eol == expeol && width == expwidth)
+	    continue;
+	  nberr++;
+	  fprintf (stderr, "%s: kernel %s test#%d gave width %ld eol+%ld,"
+		   " expected width %ld eol+%ld, for bytes:",
+		   progname, ke->ke_name, t, width, (long) (eol - start),
+		   expwidth, (long) explen);
+	  for (const char *q = start; q < end; q++)
+	    fprintf (stderr, " %02x", (unsigned char) *q);
+	  fputc ('\n', stderr);
+	};
+    };
+  printf ("%s: selftest found %d errors\n", progname, nberr);
+  return nberr;
+}				/* end bwc_selftest */
+
+static void
+bwc_add_malformed (struct bwc_stats *st, long linum, long off)
+{
+  if (st->st_malfcnt >= st->st_malfdim)
+    bwc_grow ((void **) &st->st_malfarr, &st->st_malfdim,
+	      st->st_malfcnt, sizeof (struct bwc_malformed), "malfarr");
+  st->st_malfarr[st->st_malfcnt].mf_linum = linum;
+  st->st_malfarr[st->st_malfcnt].mf_off = off;
+  st->st_malfcnt++;
+}				/* end bwc_add_malformed */
+
+static void
+bwc_add_large (struct bwc_stats *st, long linum)
+{
+  if (st->st_largcnt >= st->st_largdim)
+    bwc_grow ((void **) &st->st_largarr, &st->st_largdim,
+	      st->st_largcnt, sizeof (long), "largarr");
+  st->st_largarr[st->st_largcnt++] = linum;
+}				/* end bwc_add_large */
+
+static inline int
+bwc_hist_index (long width)
+{
+  unsigned long v = (unsigned long) width;
+  int msb = 63 - __builtin_clzl (v | 1);
+  if (msb <= BWC_HIST_SUBBITS)
+    return (int) v;
+  int shift = msb - BWC_HIST_SUBBITS;
+  int ix = ((shift + 1) << BWC_HIST_SUBBITS)
+    | (int) ((v >> shift) & ((1u << BWC_HIST_SUBBITS) - 1));
+  return ix < BWC_HIST_BUCKETS ? ix : BWC_HIST_BUCKETS - 1;
+}				/* end bwc_hist_index */
+
+/// the smallest width of histogram bucket ix
+static inline long
+bwc_hist_low (int ix)
+{
+  if (ix < (2 << BWC_HIST_SUBBITS))
+    return ix;
+  int shift = (ix >> BWC_HIST_SUBBITS) - 1;
+  return (long) ((ix & ((1 << BWC_HIST_SUBBITS) - 1))
+		 | (1 << BWC_HIST_SUBBITS)) << shift;
+}				/* end bwc_hist_low */
+
+/// the biggest width of histogram bucket ix
+static inline long
+bwc_hist_high (int ix)
+{
+  if (ix < (2 << BWC_HIST_SUBBITS))
+    return ix;
+  int shift = (ix >> BWC_HIST_SUBBITS) - 1;
+  return bwc_hist_low (ix) + (1L << shift) - 1;
+}				/* end bwc_hist_high */
+
+static inline void
+bwc_hist_add (struct bwc_stats *st, long width)
+{
+  st->st_hist[bwc_hist_index (width)]++;
+  st->st_widthsum += width;
+}				/* end bwc_hist_add */
+
+static inline uint8_t *
+bwc_put_varint (uint8_t *p, uint64_t v)
+{
+  while (v >= 0x80)
+    {
+      *p++ = (uint8_t) (v | 0x80);
+      v >>= 7;
+    };
+  *p++ = (uint8_t) v;
+  return p;
+}				/* end bwc_put_varint */
+
+static inline const uint8_t *
+bwc_get_varint (const uint8_t *p, uint64_t *pv)
+{
+  uint64_t v = 0;
+  int sh = 0;
+  while (*p & 0x80)
+    {
+      v |= (uint64_t) (*p++ & 0x7f) << sh;
+      sh += 7;
+    };
+  v |= (uint64_t) (*p++) << sh;
+  *pv = v;
+  return p;
+}				/* end bwc_get_varint */
+
+/* encode the line just counted in st into its line index */
+static void
+bwc_index_line (struct bwc_stats *st, size_t linbytes, long off,
+		long linlen)
+{
+  if ((st->st_lincnt - 1) % BWC_INDEX_BLOCK == 0)
+    {
+      if (st->st_idxblkcnt >= st->st_idxblkdim)
+	bwc_grow ((void **) &st->st_idxblocks, &st->st_idxblkdim,
+		  st->st_idxblkcnt, sizeof (struct bwc_idxblock), "index");
+      struct bwc_idxblock *ib = st->st_idxblocks + st->st_idxblkcnt++;
+      ib->ib_firstline = st->st_lincnt - 1;
+      ib->ib_off = off;
+      ib->ib_streampos = (int64_t) st->st_idxlen;
+      ib->ib_maxwidth = -1;
+      ib->ib_nbmalformed = 0;
+    };
+  struct bwc_idxblock *ib = st->st_idxblocks + st->st_idxblkcnt - 1;
+  if (linlen < 0)
+    ib->ib_nbmalformed++;
+  else if (linlen > ib->ib_maxwidth)
+    ib->ib_maxwidth = linlen;
+  if (st->st_idxlen + 20 > st->st_idxsiz)
+    {
+      size_t newsiz = 2 * st->st_idxsiz + 4096;
+      uint8_t *newbuf = realloc (st->st_idxbuf, newsiz);
+      if (!newbuf)
+	{
+	  fprintf (stderr, "%s: realloc index (%zd bytes) failed - %s\n",
+		   progname, newsiz, strerror (errno));
+	  exit (EXIT_FAILURE);
+	};
+      st->st_idxbuf = newbuf;
+      st->st_idxsiz = newsiz;
+    };
+  uint8_t *p = st->st_idxbuf + st->st_idxlen;
+  p = bwc_put_varint (p, linbytes);
+  p = bwc_put_varint (p, (uint64_t) (linlen + 1));
+  st->st_idxlen = (size_t) (p - st->st_idxbuf);
+}				/* end bwc_index_line */
+
+/* account one line of linbytes bytes at byte offset off, of linlen
+   UTF8 glyphs or -1 if malformed; return false on a huge line, which
+   ends the scan */
+static bool
+bwc_account_line (struct bwc_stats *st, size_t linbytes, long off,
+		  long linlen)
+{
+  st->st_lincnt++;
+  if (st->st_indexing)
+    bwc_index_line (st, linbytes, off, linlen);
+  if (linlen < 0)
+    {
+      bwc_add_malformed (st, st->st_lincnt, off);
+      return true;
+    };
+  if (linbytes > BWC_HUGE_LINE)
+    {
+      st->st_hugelin = st->st_lincnt;
+      st->st_hugeoff = off;
+      st->st_hugebytes = (long) linbytes;
+      return false;
+    };
+  if (linlen > st->st_linwidth)
+    st->st_linwidth = linlen;
+  bwc_hist_add (st, linlen);
+  if (linlargelimit > 0 && linlen > linlargelimit)
+    bwc_add_large (st, st->st_lincnt);
+  return true;
+}				/* end bwc_account_line */
+
+/* the width at quantile q of a histogram of nbvalid lines, up to the
+   widest line */
+static long
+bwc_hist_quantile (const uint64_t *hist, long nbvalid, double q,
+		   long linwidth)
+{
+  uint64_t target = (uint64_t) (q * nbvalid + 0.999999);
+  uint64_t cum = 0;
+  if (target < 1)
+    target = 1;
+  for (int ix = 0; ix < BWC_HIST_BUCKETS; ix++)
+    {
+      cum += hist[ix];
+      if (cum >= target)
+	return bwc_hist_high (ix) < linwidth ? bwc_hist_high (ix) : linwidth;
+    };
+  return linwidth;
+}				/* end bwc_hist_quantile */
+
+static void
+bwc_json_string (const char *str)
+{
+  putchar ('"');
+  for (const unsigned char *p = (const unsigned char *) str; *p; p++)
+    {
+      if (*p == '"' || *p == '\\')
+	printf ("\\%c", *p);
+      else if (*p < 0x20)
+	printf ("\\u%04x", *p);
+      else
+	putchar (*p);
+    };
+  putchar ('"');
+}				/* end bwc_json_string */
+
+/* print the --stats record of a file, from its merged histogram */
+static void
+bwc_print_stats (const char *name, const uint64_t *hist, long lincnt,
+		 long nbmalformed, long linwidth, long widthsum, long nbytes,
+		 double cput, double realt)
+{
+  static bool csvheader;
+  long nbvalid = lincnt - nbmalformed;
+  long p50 = bwc_hist_quantile (hist, nbvalid, 0.50, linwidth);
+  long p90 = bwc_hist_quantile (hist, nbvalid, 0.90, linwidth);
+  long p99 = bwc_hist_quantile (hist, nbvalid, 0.99, linwidth);
+  double bytesperline = lincnt > 0 ? (double) nbytes / lincnt : 0.0;
+  double meanwidth = nbvalid > 0 ? (double) widthsum / nbvalid : 0.0;
+  if (!strcmp (bwc_statsformat, "json"))
+    {
+      /// one JSON object per line
+      printf ("{\"file\": ");
+      bwc_json_string (name);
+      printf (", \"lines\": %ld, \"bytes\": %ld, \"malformed\": %ld,"
+	      " \"bytes_per_line\": %.3f, \"mean_width\": %.3f,"
+	      " \"width_p50\": %ld, \"width_p90\": %ld,"
+	      " \"width_p99\": %ld, \"width_max\": %ld,"
+	      " \"cpu_sec\": %.6f, \"mb_per_sec\": %.1f, \"histogram\": [",
+	      lincnt, nbytes, nbmalformed, bytesperline, meanwidth,
+	      p50, p90, p99, linwidth, cput, (nbytes * 1.0e-6) / realt);
+      bool first = true;
+      for (int ix = 0; ix < BWC_HIST_BUCKETS; ix++)
+	if (hist[ix] > 0)
+	  {
+	    printf ("%s[%ld, %ld, %lu]", first ? "" : ", ",
+		    bwc_hist_low (ix), bwc_hist_high (ix),
+		    (unsigned long) hist[ix]);
+	    first = false;
+	  };
+      printf ("]}\n");
+    }
+  else if (!strcmp (bwc_statsformat, "csv"))
+    {
+      if (!csvheader)
+	printf ("file,lines,bytes,malformed,bytes_per_line,mean_width,"
+		"width_p50,width_p90,width_p99,width_max,cpu_sec,mb_per_sec\n");
+      csvheader = true;
+      putchar ('"');
+      for (const char *p = name; *p; p++)
+	{
+	  if (*p == '"')
+	    putchar ('"');
+	  putchar (*p);
+	};
+      printf ("\",%ld,%ld,%ld,%.3f,%.3f,%ld,%ld,%ld,%ld,%.6f,%.1f\n",
+	      lincnt, nbytes, nbmalformed, bytesperline, meanwidth,
+	      p50, p90, p99, linwidth, cput, (nbytes * 1.0e-6) / realt);
+    }
+  else
+    printf ("# %s widths: p50 %ld, p90 %ld, p99 %ld, max %ld;"
+	    " %.1f bytes/line, mean width %.1f\n",
+	    name, p50, p90, p99, linwidth, bytesperline, meanwidth);
+}				/* end bwc_print_stats */
+
+/* merge the statistics of nbst consecutive chunks of a file scanned
+   in cput cpu seconds and realt elapsed ones, print them and add them
+   to the totals; a huge line is fatal */
+static void
+bwc_report (const char *name, struct bwc_stats *starr, int nbst,
+	    long nbytes, double cput, double realt)
+{
+  long lincnt = 0;
+  long linwidth = 0;
+  long largcnt = 0;
+  long nbmalformed = 0;
+  long widthsum = 0;
+  uint64_t hist[BWC_HIST_BUCKETS];
+  memset (hist, 0, sizeof (hist));
+  for (int c = 0; c < nbst; c++)
+    {
+      struct bwc_stats *st = starr + c;
+      nbmalformed += st->st_malfcnt;
+      widthsum += st->st_widthsum;
+      for (int ix = 0; ix < BWC_HIST_BUCKETS; ix++)
+	hist[ix] += st->st_hist[ix];
+      for (int m = 0; m < st->st_malfcnt; m++)
+	fprintf (stderr,
+		 "%s:%ld is malformed UTF8 line (byte offset %ld)\n",
+		 name, lincnt + st->st_malfarr[m].mf_linum,
+		 st->st_malfarr[m].mf_off);
+      if (st->st_hugelin > 0)
+	{
+	  fprintf (stderr, "%s:%ld is huge (%ld bytes) at byte offset %ld\n",
+		   name, lincnt + st->st_hugelin, st->st_hugebytes,
+		   st->st_hugeoff);
+	  exit (EXIT_FAILURE);
+	};
+      lincnt += st->st_lincnt;
+      if (st->st_linwidth > linwidth)
+	linwidth = st->st_linwidth;
+      largcnt += st->st_largcnt;
+    };
+  bwc_totfiles++;
+  bwc_totlines += lincnt;
+  bwc_totbytes += nbytes;
+  if (bwc_silent)
+    return;
+  if (bwc_statsformat && strcmp (bwc_statsformat, "text"))
+    {
+      bwc_print_stats (name, hist, lincnt, nbmalformed, linwidth, widthsum,
+		       nbytes, cput, realt);
+      return;
+    };
+  printf
+    ("%s:: (%ld lines, width %ld, %ld bytes in %.5f cpu sec, %.3f µs/l,"
+     " %.1f MB/s)\n", name, lincnt, linwidth, nbytes, cput,
+     (cput * 1.0e6) / lincnt, (nbytes * 1.0e-6) / realt);
+  if (bwc_statsformat)
+    bwc_print_stats (name, hist, lincnt, nbmalformed, linwidth, widthsum,
+		     nbytes, cput, realt);
+  if (largcnt > 0)
+    {
+      printf ("# %s has %ld large lines:\n", name, largcnt);
+      long i = 0;
+      long prevcnt = 0;
+      for (int c = 0; c < nbst; c++)
+	{
+	  struct bwc_stats *st = starr + c;
+	  for (int l = 0; l < st->st_largcnt; l++, i++)
+	    {
+	      long linum = prevcnt + st->st_largarr[l];
+	      if (emacsout)
+		printf ("%s:%ld: LARGE\n", name, linum);
+	      else
+		{
+		  if ((i + 1) % 9 == 0)
+		    fputs ("\n ...", stdout);
+		  printf (" %ld", linum);
+		};
+	    };
+	  prevcnt += st->st_lincnt;
+	};
+      if (!emacsout)
+	{
+	  if (largcnt > 40)
+	    printf (" # large in %s\n", name);
+	  else
+	    fputc ('\n', stdout);
+	};
+      fflush (NULL);
+    };
+}				/* end bwc_report */
+
+static void
+bwc_index_path (char *buf, size_t bufsiz, const char *name)
+{
+  if (snprintf (buf, bufsiz, "%s%s", name, BWC_INDEX_SUFFIX)
+      >= (int) bufsiz)
+    {
+      fprintf (stderr, "%s: too long file name %s\n", progname, name);
+      exit (EXIT_FAILURE);
+    };
+}				/* end bwc_index_path */
+
+/* map the sidecar index of the file name of status st, and return
+   true if it is still valid for that file */
+static bool
+bwc_open_index (const char *name, const struct stat *st,
+		struct bwc_index *ix)
+{
+  char path[PATH_MAX];
+  struct stat ist = { 0 };
+  memset (ix, 0, sizeof (*ix));
+  bwc_index_path (path, sizeof (path), name);
+  int fd = open (path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  if (fstat (fd, &ist) < 0
+      || (size_t) ist.st_size < sizeof (struct bwc_idxhead))
+    {
+      close (fd);
+      return false;
+    };
+  void *map = mmap (NULL, ist.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    return false;
+  const struct bwc_idxhead *ih = map;
+  size_t blocksiz = 0;
+  if (memcmp (ih->ih_magic, BWC_INDEX_MAGIC, sizeof (BWC_INDEX_MAGIC))
+      || ih->ih_endian != 0x01020304
+      || ih->ih_blocklines != BWC_INDEX_BLOCK
+      || ih->ih_dev != (uint64_t) st->st_dev
+      || ih->ih_ino != (uint64_t) st->st_ino
+      || ih->ih_size != (int64_t) st->st_size
+      || ih->ih_mtime_sec != (int64_t) st->st_mtim.tv_sec
+      || ih->ih_mtime_nsec != (int64_t) st->st_mtim.tv_nsec
+      || ih->ih_nbblocks < 0 || ih->ih_streamsize < 0
+      || __builtin_mul_overflow ((size_t) ih->ih_nbblocks,
+				 sizeof (struct bwc_idxblock), &blocksiz)
+      || sizeof (struct bwc_idxhead) + blocksiz
+      + (size_t) ih->ih_streamsize != (size_t) ist.st_size)
+    {
+      munmap (map, ist.st_size);
+      return false;
+    };
+  ix->ix_map = map;
+  ix->ix_mapsize = ist.st_size;
+  ix->ix_head = ih;
+  ix->ix_blocks = (const struct bwc_idxblock *) (ih + 1);
+  ix->ix_stream = (const uint8_t *) (ix->ix_blocks + ih->ih_nbblocks);
+  return true;
+}				/* end bwc_open_index */
+
+static void
+bwc_close_index (struct bwc_index *ix)
+{
+  if (ix->ix_map)
+    munmap (ix->ix_map, ix->ix_mapsize);
+  memset (ix, 0, sizeof (*ix));
+}				/* end bwc_close_index */
+
+/* report a file from its valid index, decoding only the blocks having
+   large or malformed lines */
+static void
+bwc_report_index (const char *name, struct bwc_index *ix)
+{
+  struct bwc_timer ti;
+  struct bwc_stats st = { 0 };
+  const struct bwc_idxhead *ih = ix->ix_head;
+  double cput = 0.0, realt = 0.0;
+  bwc_start_timer (&ti);
+  for (int64_t b = 0; b < ih->ih_nbblocks; b++)
+    {
+      const struct bwc_idxblock *ib = ix->ix_blocks + b;
+      if (ib->ib_nbmalformed == 0 && !bwc_statsformat
+	  && (linlargelimit <= 0 || ib->ib_maxwidth <= linlargelimit))
+	continue;
+      int64_t lastline = (b + 1 < ih->ih_nbblocks)
+	? ib[1].ib_firstline : ih->ih_lincnt;
+      const uint8_t *p = ix->ix_stream + ib->ib_streampos;
+      long off = ib->ib_off;
+      for (int64_t l = ib->ib_firstline; l < lastline; l++)
+	{
+	  uint64_t linbytes = 0, width1 = 0;
+	  p = bwc_get_varint (p, &linbytes);
+	  p = bwc_get_varint (p, &width1);
+	  if (width1 == 0)
+	    {
+	      bwc_add_malformed (&st, l + 1, off);
+	      off += linbytes;
+	      continue;
+	    };
+	  bwc_hist_add (&st, (long) width1 - 1);
+	  if (linlargelimit > 0 && (long) width1 - 1 > linlargelimit)
+	    bwc_add_large (&st, l + 1);
+	  off += linbytes;
+	};
+    };
+  st.st_lincnt = ih->ih_lincnt;
+  st.st_linwidth = ih->ih_linwidth;
+  bwc_stop_timer (&ti, &cput, &realt);
+  bwc_report (name, &st, 1, ih->ih_size, cput, realt);
+  bwc_free_stats (&st);
+}				/* end bwc_report_index */
+
+/* write the sidecar index of the file name of status st from the
+   statistics of its nbst consecutive chunks; failures are only
+   warned about */
+static void
+bwc_write_index (const char *name, const struct stat *st,
+		 struct bwc_stats *starr, int nbst)
+{
+  char path[PATH_MAX];
+  char tmpath[PATH_MAX + 32];
+  struct bwc_idxhead ih;
+  memset (&ih, 0, sizeof (ih));
+  memcpy (ih.ih_magic, BWC_INDEX_MAGIC, sizeof (BWC_INDEX_MAGIC));
+  ih.ih_endian = 0x01020304;
+  ih.ih_blocklines = BWC_INDEX_BLOCK;
+  ih.ih_dev = st->st_dev;
+  ih.ih_ino = st->st_ino;
+  ih.ih_size = st->st_size;
+  ih.ih_mtime_sec = st->st_mtim.tv_sec;
+  ih.ih_mtime_nsec = st->st_mtim.tv_nsec;
+  for (int c = 0; c < nbst; c++)
+    {
+      ih.ih_lincnt += starr[c].st_lincnt;
+      if (starr[c].st_linwidth > ih.ih_linwidth)
+	ih.ih_linwidth = starr[c].st_linwidth;
+      ih.ih_nbblocks += starr[c].st_idxblkcnt;
+      ih.ih_streamsize += (int64_t) starr[c].st_idxlen;
+    };
+  bwc_index_path (path, sizeof (path), name);
+  snprintf (tmpath, sizeof (tmpath), "%s-%d.tmp", path, (int) getpid ());
+  FILE *f = fopen (tmpath, "w");
+  if (!f)
+    {
+      fprintf (stderr, "%s: cannot write index %s - %s\n",
+	       progname, tmpath, strerror (errno));
+      return;
+    };
+  bool ok = fwrite (&ih, sizeof (ih), 1, f) == 1;
+  int64_t prevlines = 0, prevpos = 0;
+  for (int c = 0; c < nbst && ok; c++)
+    {
+      for (int b = 0; b < starr[c].st_idxblkcnt && ok; b++)
+	{
+	  /// chunk relative blocks become file relative
+	  struct bwc_idxblock ib = starr[c].st_idxblocks[b];
+	  ib.ib_firstline += prevlines;
+	  ib.ib_streampos += prevpos;
+	  ok = fwrite (&ib, sizeof (ib), 1, f) == 1;
+	};
+      prevlines += starr[c].st_lincnt;
+      prevpos += (int64_t) starr[c].st_idxlen;
+    };
+  for (int c = 0; c < nbst && ok; c++)
+    if (starr[c].st_idxlen > 0)
+      ok = fwrite (starr[c].st_idxbuf, starr[c].st_idxlen, 1, f) == 1;
+  if (fclose (f) || !ok || rename (tmpath, path))
+    {
+      fprintf (stderr, "%s: failed to write index %s - %s\n",
+	       progname, path, strerror (errno));
+      unlink (tmpath);
+    };
+}				/* end bwc_write_index */
+
+/* print line linum of a file using its sidecar index */
+static void
+bwc_print_line (const char *name, long linum)
+{
+  struct stat st = { 0 };
+  struct bwc_index ix;
+  if (stat (name, &st) < 0 || !S_ISREG (st.st_mode))
+    {
+      fprintf (stderr, "%s: no line index for %s\n", progname, name);
+      return;
+    };
+  if (!bwc_open_index (name, &st, &ix))
+    {
+      fprintf (stderr, "%s: no valid line index for %s\n", progname, name);
+      return;
+    };
+  const struct bwc_idxhead *ih = ix.ix_head;
+  if (linum < 1 || linum > ih->ih_lincnt)
+    {
+      fprintf (stderr, "%s: %s has no line %ld, only %ld lines\n",
+	       progname, name, linum, (long) ih->ih_lincnt);
+      bwc_close_index (&ix);
+      return;
+    };
+  /// find the last block starting at or before that line
+  int64_t lo = 0, hi = ih->ih_nbblocks - 1;
+  while (lo < hi)
+    {
+      int64_t md = (lo + hi + 1) / 2;
+      if (ix.ix_blocks[md].ib_firstline <= linum - 1)
+	lo = md;
+      else
+	hi = md - 1;
+    };
+  const struct bwc_idxblock *ib = ix.ix_blocks + lo;
+  const uint8_t *p = ix.ix_stream + ib->ib_streampos;
+  long off = ib->ib_off;
+  uint64_t linbytes = 0, width1 = 0;
+  for (int64_t l = ib->ib_firstline; l < linum; l++)
+    {
+      p = bwc_get_varint (p, &linbytes);
+      p = bwc_get_varint (p, &width1);
+      if (l + 1 < linum)
+	off += linbytes;
+    };
+  bwc_close_index (&ix);
+  char *buf = malloc (linbytes + 1);
+  int fd = open (name, O_RDONLY);
+  if (!buf || fd < 0
+      || pread (fd, buf, linbytes, off) != (ssize_t) linbytes)
+    {
+      fprintf (stderr, "%s: failed to read line %ld of %s - %s\n",
+	       progname, linum, name, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  close (fd);
+  printf ("%s:%ld:", name, linum);
+  fwrite (buf, linbytes, 1, stdout);
+  if (linbytes == 0 || buf[linbytes - 1] != '\n')
+    putchar ('\n');
+  free (buf);
+}				/* end bwc_print_line */
+
 void
 count_lines (FILE *f, char *name)
 {
   size_t linsiz = 256;
-  int largdim = 32;
-  int largcnt = 0;
-  int *largarr = calloc (largdim, sizeof (int));
-  clock_t stc = clock ();
+  struct bwc_stats st = { 0 };
+  struct stat fst = { 0 };
+  struct bwc_timer ti;
+  if (bwc_indexing && !fstat (fileno (f), &fst) && S_ISREG (fst.st_mode))
+    {
+      struct bwc_index ix;
+      if (bwc_open_index (name, &fst, &ix))
+	{
+	  if (!bwc_silent)
+	    bwc_report_index (name, &ix);
+	  bwc_close_index (&ix);
+	  return;
+	};
+      st.st_indexing = true;
+    };
+  bwc_start_timer (&ti);
   char *linbuf = malloc (linsiz);
-  long lincnt = 0;
-  long linwidth = 0;
   long off = 0;
   if (!linbuf)
     {
       perror ("malloc linbuf");
       exit (EXIT_FAILURE);
     };
-  if (!largarr)
-    {
-      perror ("calloc largarr");
-      exit (EXIT_FAILURE);
-    };
   memset (linbuf, 0, linsiz);
   do
     {
-      long oldoff = -1;
-      off = ftell (f);
-      if (off>=0)
-	oldoff= off;
+      long oldoff = off;
       ssize_t linbytes = getline (&linbuf, &linsiz, f);
       if (linbytes < 0)
 	break;
-      lincnt++;
       off += linbytes;
-      if (!u8_check((const uint8_t*)linbuf, (size_t)linbytes)) {
-	fprintf(stderr,
-		"%s:%ld is malformed UTF8 line (byte offset %ld)\n",
-		name, lincnt, oldoff);
-	continue;
-      }
-      if (linbytes > (1 << 20))
+      long linlen = -1;
+      (void) bwc_scan_line (linbuf, linbuf + linbytes, &linlen);
+      if (!bwc_account_line (&st, (size_t) linbytes, oldoff, linlen))
+	break;
+    }
+  while (!feof (f));
+  double cput = 0.0, realt = 0.0;
+  bwc_stop_timer (&ti, &cput, &realt);
+  bwc_report (name, &st, 1, off, cput, realt);
+  if (st.st_indexing)
+    bwc_write_index (name, &fst, &st, 1);
+  bwc_free_stats (&st);
+  free (linbuf);
+}				/* end count_lines */
+
+/* scan a pipe, socket or terminal into st, read into a big buffer
+   which is compacted only when full: the only copied bytes are those
+   of the line crossing that refill boundary.  A line filling the
+   whole buffer is already huge, so the rest of it is validated and
+   counted as it is read, without buffering it; return the byte
+   count */
+static long
+bwc_stream_scan (int fd, const char *name, struct bwc_stats *st)
+{
+  const size_t bufsiz = BWC_STREAM_BUF;
+  char *buf = malloc (bufsiz);
+  size_t start = 0;		/// first unscanned byte in buf
+  size_t fill = 0;		/// end of read bytes in buf
+  long off = 0;			/// absolute offset of buf[start]
+  size_t hugebytes = 0;		/// already counted bytes of a huge line
+  long hugewidth = 0;		/// and their glyphs, or -1 if malformed
+  bool eof = false;
+  if (!buf)
+    {
+      perror ("malloc stream buffer");
+      exit (EXIT_FAILURE);
+    };
+#ifdef F_SETPIPE_SZ
+  /// fails harmlessly on non-pipes, or above /proc/sys/fs/pipe-max-size
+  (void) fcntl (fd, F_SETPIPE_SZ, BWC_PIPE_SIZE);
+#endif
+  for (;;)
+    {
+      while (start < fill)
 	{
-	  fprintf (stderr, "%s:%ld is huge (%ld bytes) at byte offset %ld\n",
-		   name, lincnt, linbytes, oldoff);
+	  long linlen = -1;
+	  const char *p = buf + start;
+	  const char *eol = bwc_scan_line (p, buf + fill, &linlen);
+	  if (eol[-1] != '\n' && !eof)
+	    break;		/// incomplete line, read more
+	  size_t linbytes = hugebytes + (size_t) (eol - p);
+	  if (hugebytes > 0)
+	    linlen = (hugewidth < 0 || linlen < 0) ? -1 : hugewidth + linlen;
+	  hugebytes = 0;
+	  hugewidth = 0;
+	  if (!bwc_account_line (st, linbytes, off, linlen))
+	    goto done;
+	  off += (long) linbytes;
+	  start = (size_t) (eol - buf);
+	};
+      if (eof)
+	break;
+      if (start == fill)
+	start = fill = 0;
+      else if (fill == bufsiz)
+	{
+	  if (start > 0)
+	    {
+	      memmove (buf, buf + start, fill - start);
+	      fill -= start;
+	      start = 0;
+	    }
+	  else
+	    {
+	      /// a line bigger than the buffer: scan and drop what is
+	      /// read of it, but keep a glyph cut by the buffer end
+	      size_t cut = fill;
+	      while (cut > fill - 4
+		     && ((unsigned char) buf[cut - 1] & 0xc0) == 0x80)
+		cut--;
+	      if (((unsigned char) buf[cut - 1] & 0xc0) == 0xc0)
+		cut--;
+	      else
+		cut = fill;
+	      long seglen = -1;
+	      (void) bwc_scan_line (buf, buf + cut, &seglen);
+	      if (seglen < 0 || hugewidth < 0)
+		hugewidth = -1;
+	      else
+		hugewidth += seglen;
+	      hugebytes += cut;
+	      memmove (buf, buf + cut, fill - cut);
+	      fill -= cut;
+	    };
+	};
+      ssize_t rd = read (fd, buf + fill, bufsiz - fill);
+      if (rd < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  perror (name);
 	  exit (EXIT_FAILURE);
 	};
-      size_t linlen =
-	u8_mbsnlen((const uint8_t*)linbuf, (size_t)linbytes);
-      if (linlargelimit > 0 && (int) linlen > linlargelimit)
+      if (rd == 0)
+	eof = true;
+      else
+	fill += (size_t) rd;
+    };
+done:
+  free (buf);
+  return off;
+}				/* end bwc_stream_scan */
+
+/* count the lines of a pipe, socket or terminal; fd is closed here */
+void
+count_streamed_lines (int fd, char *name)
+{
+  struct bwc_stats st = { 0 };
+  struct bwc_timer ti;
+  double cput = 0.0, realt = 0.0;
+  bwc_start_timer (&ti);
+  long nbytes = bwc_stream_scan (fd, name, &st);
+  bwc_stop_timer (&ti, &cput, &realt);
+  bwc_report (name, &st, 1, nbytes, cput, realt);
+  bwc_free_stats (&st);
+  close (fd);
+}				/* end count_streamed_lines */
+
+static void
+bwc_scan_chunk (struct bwc_chunk *ch)
+{
+  const char *p = ch->ch_base + ch->ch_start;
+  const char *end = ch->ch_base + ch->ch_end;
+  while (p < end)
+    {
+      long linlen = -1;
+      const char *eol = bwc_scan_line (p, end, &linlen);
+      if (!bwc_account_line (&ch->ch_stats, (size_t) (eol - p),
+			     (long) (p - ch->ch_base), linlen))
+	break;
+      p = eol;
+    };
+}				/* end bwc_scan_chunk */
+
+/* split a mmap-ed file of size bytes in nbchunks consecutive chunks,
+   each ending after a newline (or at the end of file) */
+static void
+bwc_split_chunks (const char *base, size_t size, int nbchunks,
+		  struct bwc_chunk *charr)
+{
+  size_t prevend = 0;
+  for (int c = 0; c < nbchunks; c++)
+    {
+      size_t cend = size;
+      if (c + 1 < nbchunks)
 	{
-	  if (largcnt > largdim)
+	  cend = (size / nbchunks) * (c + 1);
+	  if (cend < prevend)
+	    cend = prevend;
+	  if (cend > 0 && base[cend - 1] != '\n')
 	    {
-	      int newdim = ((largdim + largdim / 4 + 4) | 0xf) + 1;
-	      int *newarr = calloc (newdim, sizeof (int));
-	      if (!newarr)
-		{
-		  fprintf (stderr,
-			   "%s: calloc newarr (newdim=%d) failed - %s\n",
-			   progname, newdim, strerror (errno));
-		  exit (EXIT_FAILURE);
-		}
-	      memcpy (newarr, largarr, sizeof (int) * largcnt);
-	      int *oldarr = largarr;
-	      largarr = newarr;
-	      free (oldarr);
-	      largdim = newdim;
+	      const char *nl = memchr (base + cend, '\n', size - cend);
+	      cend = nl ? (size_t) (nl - base) + 1 : size;
 	    };
-	  largarr[largcnt++] = lincnt;
 	};
-    }
-  while (!feof (f));
-  clock_t stf = clock ();
-  double cput = (stf - stc) * 1.0e-6;
-  printf
-    ("%s:: (%ld lines, width %ld, %ld bytes in %.5f cpu sec, %.3f µs/l)\n",
-     name, lincnt, linwidth, off, cput, (cput * 1.0e6) / lincnt);
-  if (largcnt > 0)
+      charr[c].ch_base = base;
+      charr[c].ch_start = prevend;
+      charr[c].ch_end = cend;
+      prevend = cend;
+    };
+}				/* end bwc_split_chunks */
+
+/*** the -m work-stealing pool: every worker thread owns a deque of
+   tasks, taking its own at the tail and stealing others at the head.
+   Opening a file is a task which mmaps and splits it, then pushes its
+   chunks as tasks; streamed inputs are scanned by their opening task.
+   The main thread prints the reports in argv order once each file is
+   done, and only queues files within a bounded reorder window. ***/
+
+/// a file counted by the pool
+struct bwc_file
+{
+  char *fi_name;
+  int fi_errno;			/// failure of open or mmap
+  const char *fi_base;		/// mmap-ed content, or NULL
+  size_t fi_size;		/// its size
+  long fi_nbytes;		/// number of scanned bytes
+  int fi_nbchunks;
+  struct bwc_chunk *fi_chunks;
+  atomic_int fi_pending;	/// number of chunks still to scan
+  atomic_long fi_cpu_ns;	/// thread cpu time spent on the file
+  struct timespec fi_start, fi_end;
+  struct stat fi_stat;
+  bool fi_indexed;		/// when fi_index is valid
+  struct bwc_index fi_index;
+  bool fi_done;			/// under bwc_pool_mtx
+};
+
+/// a task opens file ta_file when ta_chunk is negative, or scans a chunk
+struct bwc_task
+{
+  int ta_file;
+  int ta_chunk;
+};
+
+struct bwc_deque
+{
+  pthread_mutex_t dq_mtx;
+  struct bwc_task *dq_arr;
+  int dq_head, dq_tail, dq_dim;
+};
+
+static struct bwc_file *bwc_files;
+static struct bwc_deque *bwc_deques;	/// one per worker thread
+static pthread_mutex_t bwc_pool_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bwc_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t bwc_done_cond = PTHREAD_COND_INITIALIZER;
+static atomic_int bwc_nbqueued;	/// tasks in all deques
+static bool bwc_pool_stop;	/// under bwc_pool_mtx
+
+static void
+bwc_push_task (int w, int filix, int chunkix)
+{
+  struct bwc_deque *dq = bwc_deques + w;
+  pthread_mutex_lock (&dq->dq_mtx);
+  if (dq->dq_tail >= dq->dq_dim)
     {
-      printf ("# %s has %d large lines:\n", name, largcnt);
-      if (emacsout) {
-        for (int i = 0; i < largcnt; i++)
-          printf("%s:%d: LARGE\n", name, largarr[i]);
-      } else {
-        for (int i = 0; i < largcnt; i++) {
-	     if ((i+1) % 9 == 0)
-	       fputs("\n ...", stdout);
-	     printf (" %d", largarr[i]);
-      }
-      if (largcnt > 40)
-	     printf(" # large in %s\n", name);
+      if (dq->dq_head > 0)
+	{
+	  memmove (dq->dq_arr, dq->dq_arr + dq->dq_head,
+		   (dq->dq_tail - dq->dq_head) * sizeof (struct bwc_task));
+	  dq->dq_tail -= dq->dq_head;
+	  dq->dq_head = 0;
+	}
       else
-	     fputc ('\n', stdout);
-      fflush (NULL);
+	bwc_grow ((void **) &dq->dq_arr, &dq->dq_dim, dq->dq_tail,
+		  sizeof (struct bwc_task), "deque");
     };
-  free (linbuf);
-  free (largarr);
-}				/* end count_lines */
+  dq->dq_arr[dq->dq_tail].ta_file = filix;
+  dq->dq_arr[dq->dq_tail].ta_chunk = chunkix;
+  dq->dq_tail++;
+  pthread_mutex_unlock (&dq->dq_mtx);
+  atomic_fetch_add (&bwc_nbqueued, 1);
+  pthread_mutex_lock (&bwc_pool_mtx);
+  pthread_cond_signal (&bwc_work_cond);
+  pthread_mutex_unlock (&bwc_pool_mtx);
+}				/* end bwc_push_task */
+
+/* pop a task from the tail of deque w, or steal one from the head of
+   another deque */
+static bool
+bwc_pop_task (int w, struct bwc_task *ta)
+{
+  for (int k = 0; k < nbthreads; k++)
+    {
+      struct bwc_deque *dq = bwc_deques + (w + k) % nbthreads;
+      bool got = false;
+      pthread_mutex_lock (&dq->dq_mtx);
+      if (dq->dq_head < dq->dq_tail)
+	{
+	  *ta = (k == 0) ? dq->dq_arr[--dq->dq_tail]
+	    : dq->dq_arr[dq->dq_head++];
+	  got = true;
+	};
+      pthread_mutex_unlock (&dq->dq_mtx);
+      if (got)
+	{
+	  atomic_fetch_sub (&bwc_nbqueued, 1);
+	  return true;
+	};
+    };
+  return false;
+}				/* end bwc_pop_task */
+
+static void
+bwc_file_done (struct bwc_file *fi)
+{
+  clock_gettime (CLOCK_MONOTONIC, &fi->fi_end);
+  pthread_mutex_lock (&bwc_pool_mtx);
+  fi->fi_done = true;
+  pthread_cond_broadcast (&bwc_done_cond);
+  pthread_mutex_unlock (&bwc_pool_mtx);
+}				/* end bwc_file_done */
+
+/* add the thread cpu time since *cpust to fi, before its last chunk
+   is declared done */
+static void
+bwc_file_cpu (struct bwc_file *fi, const struct timespec *cpust)
+{
+  struct timespec now = { 0, 0 };
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &now);
+  atomic_fetch_add (&fi->fi_cpu_ns,
+		    (now.tv_sec - cpust->tv_sec) * 1000000000L
+		    + (now.tv_nsec - cpust->tv_nsec));
+}				/* end bwc_file_cpu */
+
+static void
+bwc_open_task (int w, struct bwc_file *fi, int filix,
+	       const struct timespec *cpust)
+{
+  struct stat st = { 0 };
+  clock_gettime (CLOCK_MONOTONIC, &fi->fi_start);
+  int fd = strcmp (fi->fi_name, "-") ? open (fi->fi_name, O_RDONLY)
+    : dup (STDIN_FILENO);
+  if (fd < 0 || fstat (fd, &fi->fi_stat) < 0)
+    {
+      fi->fi_errno = errno;
+      if (fd >= 0)
+	close (fd);
+      bwc_file_cpu (fi, cpust);
+      bwc_file_done (fi);
+      return;
+    };
+  st = fi->fi_stat;
+  if (bwc_indexing && S_ISREG (st.st_mode) && st.st_size > 0
+      && bwc_open_index (fi->fi_name, &st, &fi->fi_index))
+    {
+      fi->fi_indexed = true;
+      close (fd);
+      bwc_file_cpu (fi, cpust);
+      bwc_file_done (fi);
+      return;
+    };
+  if (!S_ISREG (st.st_mode) || st.st_size == 0)
+    {
+      /// pipes and empty files cannot be mmap-ed
+      fi->fi_nbchunks = 1;
+      fi->fi_chunks = calloc (1, sizeof (struct bwc_chunk));
+      if (!fi->fi_chunks)
+	{
+	  perror ("calloc chunk");
+	  exit (EXIT_FAILURE);
+	};
+      fi->fi_nbytes = bwc_stream_scan (fd, fi->fi_name,
+				       &fi->fi_chunks[0].ch_stats);
+      close (fd);
+      bwc_file_cpu (fi, cpust);
+      bwc_file_done (fi);
+      return;
+    };
+  fi->fi_size = fi->fi_nbytes = st.st_size;
+  fi->fi_base = mmap (NULL, fi->fi_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (fi->fi_base == MAP_FAILED)
+    {
+      fi->fi_errno = errno;
+      fi->fi_base = NULL;
+      close (fd);
+      bwc_file_cpu (fi, cpust);
+      bwc_file_done (fi);
+      return;
+    };
+  close (fd);
+  (void) madvise ((void *) fi->fi_base, fi->fi_size, MADV_SEQUENTIAL);
+  int nbchunks = nbthreads * BWC_CHUNKS_PER_THREAD;
+  if ((size_t) nbchunks > fi->fi_size / BWC_MIN_CHUNK)
+    nbchunks = (int) (fi->fi_size / BWC_MIN_CHUNK);
+  if (nbchunks < 1)
+    nbchunks = 1;
+  fi->fi_chunks = calloc (nbchunks, sizeof (struct bwc_chunk));
+  if (!fi->fi_chunks)
+    {
+      perror ("calloc chunks");
+      exit (EXIT_FAILURE);
+    };
+  bwc_split_chunks (fi->fi_base, fi->fi_size, nbchunks, fi->fi_chunks);
+  for (int c = 0; c < nbchunks; c++)
+    fi->fi_chunks[c].ch_stats.st_indexing = bwc_indexing;
+  fi->fi_nbchunks = nbchunks;
+  atomic_store (&fi->fi_pending, nbchunks);
+  for (int c = nbchunks - 1; c > 0; c--)
+    bwc_push_task (w, filix, c);
+  bwc_scan_chunk (fi->fi_chunks + 0);
+  bwc_file_cpu (fi, cpust);
+  if (atomic_fetch_sub (&fi->fi_pending, 1) == 1)
+    bwc_file_done (fi);
+}				/* end bwc_open_task */
+
+static void *
+bwc_pool_worker (void *arg)
+{
+  int w = (int) (intptr_t) arg;
+  for (;;)
+    {
+      struct bwc_task ta = { 0, 0 };
+      if (bwc_pop_task (w, &ta))
+	{
+	  struct bwc_file *fi = bwc_files + ta.ta_file;
+	  struct timespec cpust = { 0, 0 };
+	  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &cpust);
+	  if (ta.ta_chunk < 0)
+	    bwc_open_task (w, fi, ta.ta_file, &cpust);
+	  else
+	    {
+	      bwc_scan_chunk (fi->fi_chunks + ta.ta_chunk);
+	      bwc_file_cpu (fi, &cpust);
+	      if (atomic_fetch_sub (&fi->fi_pending, 1) == 1)
+		bwc_file_done (fi);
+	    };
+	  continue;
+	};
+      bool stop = false;
+      pthread_mutex_lock (&bwc_pool_mtx);
+      while (atomic_load (&bwc_nbqueued) == 0 && !bwc_pool_stop)
+	pthread_cond_wait (&bwc_work_cond, &bwc_pool_mtx);
+      stop = bwc_pool_stop && atomic_load (&bwc_nbqueued) == 0;
+      pthread_mutex_unlock (&bwc_pool_mtx);
+      if (stop)
+	break;
+    };
+  return NULL;
+}				/* end bwc_pool_worker */
+
+/* count the lines of nbnames files with the work-stealing pool,
+   reporting them in order */
+void
+count_pooled_files (char **names, int nbnames)
+{
+  pthread_t *tharr = calloc (nbthreads, sizeof (pthread_t));
+  bwc_files = calloc (nbnames, sizeof (struct bwc_file));
+  bwc_deques = calloc (nbthreads, sizeof (struct bwc_deque));
+  if (!tharr || !bwc_files || !bwc_deques)
+    {
+      perror ("calloc pool");
+      exit (EXIT_FAILURE);
+    };
+  for (int i = 0; i < nbnames; i++)
+    bwc_files[i].fi_name = names[i];
+  for (int w = 0; w < nbthreads; w++)
+    pthread_mutex_init (&bwc_deques[w].dq_mtx, NULL);
+  int window = nbthreads * BWC_FILES_PER_THREAD;
+  if (window > nbnames)
+    window = nbnames;
+  for (int i = 0; i < window; i++)
+    bwc_push_task (i % nbthreads, i, -1);
+  for (int w = 0; w < nbthreads; w++)
+    {
+      int err = pthread_create (tharr + w, NULL, bwc_pool_worker,
+				(void *) (intptr_t) w);
+      if (err)
+	{
+	  fprintf (stderr, "%s: pthread_create failed - %s\n",
+		   progname, strerror (err));
+	  exit (EXIT_FAILURE);
+	};
+    };
+  for (int i = 0; i < nbnames; i++)
+    {
+      struct bwc_file *fi = bwc_files + i;
+      pthread_mutex_lock (&bwc_pool_mtx);
+      while (!fi->fi_done)
+	pthread_cond_wait (&bwc_done_cond, &bwc_pool_mtx);
+      pthread_mutex_unlock (&bwc_pool_mtx);
+      if (i + window < nbnames)
+	bwc_push_task (i % nbthreads, i + window, -1);
+      if (fi->fi_errno)
+	{
+	  fprintf (stderr, "%s: %s\n", fi->fi_name, strerror (fi->fi_errno));
+	  exit (EXIT_FAILURE);
+	};
+      if (fi->fi_indexed)
+	{
+	  if (!bwc_silent)
+	    bwc_report_index (fi->fi_name, &fi->fi_index);
+	  bwc_close_index (&fi->fi_index);
+	  continue;
+	};
+      struct bwc_stats *starr = calloc (fi->fi_nbchunks,
+					sizeof (struct bwc_stats));
+      if (!starr)
+	{
+	  perror ("calloc stats");
+	  exit (EXIT_FAILURE);
+	};
+      for (int c = 0; c < fi->fi_nbchunks; c++)
+	starr[c] = fi->fi_chunks[c].ch_stats;
+      double realt = (fi->fi_end.tv_sec - fi->fi_start.tv_sec)
+	+ 1.0e-9 * (fi->fi_end.tv_nsec - fi->fi_start.tv_nsec);
+      bwc_report (fi->fi_name, starr, fi->fi_nbchunks, fi->fi_nbytes,
+		  1.0e-9 * atomic_load (&fi->fi_cpu_ns), realt);
+      if (fi->fi_base && bwc_indexing)
+	bwc_write_index (fi->fi_name, &fi->fi_stat, starr, fi->fi_nbchunks);
+      for (int c = 0; c < fi->fi_nbchunks; c++)
+	bwc_free_stats (starr + c);
+      free (starr);
+      free (fi->fi_chunks);
+      fi->fi_chunks = NULL;
+      if (fi->fi_base)
+	munmap ((void *) fi->fi_base, fi->fi_size);
+      fi->fi_base = NULL;
+    };
+  pthread_mutex_lock (&bwc_pool_mtx);
+  bwc_pool_stop = true;
+  pthread_cond_broadcast (&bwc_work_cond);
+  pthread_mutex_unlock (&bwc_pool_mtx);
+  for (int w = 0; w < nbthreads; w++)
+    pthread_join (tharr[w], NULL);
+  for (int w = 0; w < nbthreads; w++)
+    {
+      pthread_mutex_destroy (&bwc_deques[w].dq_mtx);
+      free (bwc_deques[w].dq_arr);
+    };
+  free (bwc_deques);
+  bwc_deques = NULL;
+  free (bwc_files);
+  bwc_files = NULL;
+  free (tharr);
+}				/* end count_pooled_files */
 
 
 void
-usage(void)
-{
-  printf("usage: %s [ -m # mmap | -p # plain ]\n"
-	 "\t [ -l limit ]\n"
-	 "\t [ -e ]\n"
-	 "\t files... \n",
-	 progname);
-  printf("\t with -m use mmap(2); with -p dont\n");
-  printf("\t -l 80 is the default line length limit\n");
-  printf("\t -e for GNU emacs friendly output <file>:<line>\n");
-  printf("\t also with --version and --help\n");
-} /* end of usage */
+usage (void)
+{
+  printf ("usage: %s [ -m # mmap | -p # plain ]\n"
+	  "\t [ -j threads ]\n"
+	  "\t [ -l limit ]\n"
+	  "\t [ --kernel=scalar|sse|avx2 ]\n"
+	  "\t [ --index ] [ --line=N ]\n"
+	  "\t [ --stats=text|json|csv ]\n"
+	  "\t [ -e ]\n" "\t files... \n", progname);
+  printf ("\t with -m use mmap(2); with -p dont\n");
+  printf ("\t pipes, sockets and - (for stdin) are streamed with read(2)\n");
+  printf ("\t -j 4 scans files with a pool of 4 threads with -m,"
+	  " default is online CPUs\n");
+  printf ("\t reports are in argument order, with a total"
+	  " for several files\n");
+  printf ("\t -l 80 is the default line length limit\n");
+  printf ("\t --kernel= selects the UTF8 scanning kernel,"
+	  " default is the fastest\n");
+  printf ("\t --selftest[=count] checks the kernels against libunistring\n");
+  printf ("\t -e for GNU emacs friendly output <file>:<line>\n");
+  printf ("\t --index reuses or writes a <file>%s line index, so unchanged"
+	  " files are not rescanned\n", BWC_INDEX_SUFFIX);
+  printf ("\t --line=N prints line N of each file, using its line index\n");
+  printf ("\t --stats=text adds width percentiles to reports,"
+	  " json and csv replace them\n");
+  printf ("\t also with --version and --help\n");
+}				/* end of usage */
 
 int
 main (int argc, char **argv)
@@ -154,7 +1645,7 @@ main (int argc, char **argv)
   bool withmmap = false;
   if (argc < 2 || !strcmp (argv[1], "-h") || !strcmp (argv[1], "--help"))
     {
-      usage();
+      usage ();
       exit (EXIT_SUCCESS);
     };
   if (argc < 2 || !strcmp (argv[1], "-V") || !strcmp (argv[1], "--version"))
@@ -164,6 +1655,16 @@ main (int argc, char **argv)
       fflush (NULL);
       exit (EXIT_SUCCESS);
     }
+  bwc_select_kernel (NULL);
+  nbthreads = (int) sysconf (_SC_NPROCESSORS_ONLN);
+  /// options apply to all the files
+  char **names = calloc (argc, sizeof (char *));
+  int nbnames = 0;
+  if (!names)
+    {
+      perror ("calloc names");
+      exit (EXIT_FAILURE);
+    };
   for (int ix = 1; ix < argc; ix++)
     {
       if (!strcmp (argv[ix], "-m"))
@@ -183,18 +1684,103 @@ main (int argc, char **argv)
 	};
       if (!strcmp (argv[ix], "-l"))
 	{
-	  if (ix < argc + 1)
-	    linlargelimit = atoi (argv[ix + 1]);
+	  if (ix + 1 < argc)
+	    linlargelimit = atoi (argv[++ix]);
 	  continue;
 	};
-      FILE *f = fopen (argv[ix], withmmap ? "rm" : "r");
-      if (!f)
+      if (!strncmp (argv[ix], "--kernel=", 9))
 	{
-	  perror (argv[ix]);
-	  exit (EXIT_FAILURE);
+	  bwc_select_kernel (argv[ix] + 9);
+	  continue;
 	};
-      count_lines (f, argv[ix]);
-    }
+      if (!strncmp (argv[ix], "--selftest", 10))
+	{
+	  int nbtests = argv[ix][10] == '=' ? atoi (argv[ix] + 11) : 100000;
+	  exit (bwc_selftest (nbtests) ? EXIT_FAILURE : EXIT_SUCCESS);
+	};
+      if (!strncmp (argv[ix], "--stats=", 8))
+	{
+	  bwc_statsformat = argv[ix] + 8;
+	  if (strcmp (bwc_statsformat, "text")
+	      && strcmp (bwc_statsformat, "json")
+	      && strcmp (bwc_statsformat, "csv"))
+	    {
+	      fprintf (stderr, "%s: unknown --stats format %s\n",
+		       progname, bwc_statsformat);
+	      exit (EXIT_FAILURE);
+	    };
+	  continue;
+	};
+      if (!strcmp (argv[ix], "--index"))
+	{
+	  bwc_indexing = true;
+	  continue;
+	};
+      if (!strncmp (argv[ix], "--line=", 7))
+	{
+	  bwc_linequery = atol (argv[ix] + 7);
+	  bwc_indexing = bwc_silent = true;
+	  continue;
+	};
+      if (!strcmp (argv[ix], "-j"))
+	{
+	  if (ix + 1 < argc)
+	    nbthreads = atoi (argv[++ix]);
+	  continue;
+	};
+      names[nbnames++] = argv[ix];
+    };
+  if (nbthreads < 1)
+    nbthreads = 1;
+  else if (nbthreads > BWC_MAX_THREADS)
+    nbthreads = BWC_MAX_THREADS;
+  struct bwc_timer ti;
+  bwc_start_timer (&ti);
+  if (withmmap)
+    count_pooled_files (names, nbnames);
+  else
+    for (int i = 0; i < nbnames; i++)
+      {
+	if (!strcmp (names[i], "-"))
+	  {
+	    count_streamed_lines (dup (STDIN_FILENO), names[i]);
+	    continue;
+	  };
+	struct stat fst = { 0 };
+	if (!stat (names[i], &fst) && !S_ISREG (fst.st_mode))
+	  {
+	    int fd = open (names[i], O_RDONLY);
+	    if (fd < 0)
+	      {
+		perror (names[i]);
+		exit (EXIT_FAILURE);
+	      };
+	    count_streamed_lines (fd, names[i]);
+	    continue;
+	  };
+	FILE *f = fopen (names[i], "r");
+	if (!f)
+	  {
+	    perror (names[i]);
+	    exit (EXIT_FAILURE);
+	  };
+	count_lines (f, names[i]);
+	fclose (f);
+      };
+  if (bwc_linequery != 0)
+    for (int i = 0; i < nbnames; i++)
+      bwc_print_line (names[i], bwc_linequery);
+  if (bwc_totfiles > 1 && !bwc_silent
+      && (!bwc_statsformat || !strcmp (bwc_statsformat, "text")))
+    {
+      double cput = 0.0, realt = 0.0;
+      bwc_stop_timer (&ti, &cput, &realt);
+      printf ("# total: %d files, %ld lines, %ld bytes in %.5f cpu sec"
+	      " (%.3f elapsed), %.1f MB/s with %d threads\n",
+	      bwc_totfiles, bwc_totlines, bwc_totbytes, cput, realt,
+	      (bwc_totbytes * 1.0e-6) / realt, withmmap ? nbthreads : 1);
+    };
+  free (names);
   return EXIT_SUCCESS;
 }				/* end main */
 
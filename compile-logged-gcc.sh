@@ -5,11 +5,17 @@
 # © Copyright Basile Starynkevitch 2020 <basile@starynkevitch.net>
 export GITID=$(git log -1|awk '/commit/{printf ("%.12s\n", $2); }')
 export MYPACKAGES='openssl sqlite3'
+export MYDEFINES=''
+## the XXH3 source digest, when libxxhash is installed
+if pkg-config --exists libxxhash; then
+    MYPACKAGES="$MYPACKAGES libxxhash"
+    MYDEFINES="-DLOGGED_HAVE_XXHASH"
+fi
 [ -f logged-gcc ] && mv -v logged-gcc  logged-gcc~
 /usr/bin/g++ -o logged-gcc_$$ -Wall -Wextra -rdynamic \
 	     -L /usr/local/lib/ \
 	     $(pkg-config --cflags $MYPACKAGES) \
-	     -O1 -g3 -std=gnu++17 -DGITID=\"$GITID\" \
+	     -O1 -g3 -std=gnu++17 -DGITID=\"$GITID\" $MYDEFINES \
 	     logged-gcc.cc \
 	     $(pkg-config --libs $MYPACKAGES) -lstdc++ && /bin/mv -v  logged-gcc_$$ logged-gcc
 
@@ -20,8 +20,12 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <sstream>
 #include <chrono>
 #include <functional>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
 
 #include <unistd.h>
 #include <syslog.h>
@@ -35,9 +39,21 @@
 #include <sys/resource.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 #include <openssl/md5.h>
 #include <openssl/evp.h>
 #include <sqlite3.h>
+#ifdef LOGGED_HAVE_XXHASH
+#include <xxhash.h>
+#endif /*LOGGED_HAVE_XXHASH*/
 
 #ifndef GCC_EXEC
 #define GCC_EXEC "/usr/bin/gcc"
@@ -54,8 +70,28 @@ const char* mysqlitepath;
 const char* mysqliterequest;
 sqlite3* mysqlitedb;
 bool debug_enabled;
+bool daemon_mode;		// --daemon, collecting log records
+bool mydepsmode;		// --deps, capturing included files with -MD
+int myheadercosts;		// --header-costs=N, top included files by CPU
+const char* mycachedir;		// --cache=, the compilation result cache
+long mycachemaxmb = 2048;	// --cache-max-mb=, its size bound
+int mysamplems;			// --sample-ms=, resource sampling period, 0 disables
+bool myperfcounters;		// --perf, hardware counters of compilations
+const char* mycgroupdir;	// --cgroup=, parent of the transient cgroups
+int myresourcetop;		// --resource-report=N, worst compilations
+std::vector<std::string> myreports;	// --report=<name>, canned reports
+int myreporttop = 20;		// --report-top=N, their number of rows
+const char* mylogsocket;	// the Unix datagram socket of the daemon
+const char* mylogspool;		// its spool file, when it is absent
+int mybatchms = 250;		// milliseconds between daemon transactions
 int exitcode;
 EVP_MD_CTX* mymdctx;
+const char* myhashalgo;		// --hash=, xxh3 or some OpenSSL digest
+const EVP_MD* mymd;		// null for xxh3
+const char* myhashcachepath;	// --hash-cache=, persistent digest cache
+bool myhashcachedefault;	// myhashcachepath is the default one
+int myhashcount, myhashcached;	// hashed files, and those found in cache
+double myhashtime, myhashsaved;	// seconds spent, and saved by the cache
 
 #define DEBUGLOG_AT(Lin,Log) do {if (debug_enabled) \
       std::clog << "¤¤" <<__FILE__<< ":" << Lin << " " << Log << std::endl; } while(0)
@@ -91,6 +127,22 @@ double get_float_time(clockid_t cid)
     return NAN;
 }
 
+/// the default socket of the logging daemon, in $XDG_RUNTIME_DIR or /tmp
+const char*
+default_log_socket(void)
+{
+  static char sockbuf[sizeof(((struct sockaddr_un*)nullptr)->sun_path)];
+  if (!sockbuf[0])
+    {
+      const char*rundir = getenv("XDG_RUNTIME_DIR");
+      if (rundir && rundir[0] == '/' && strlen(rundir) + 20 < sizeof(sockbuf))
+        snprintf(sockbuf, sizeof(sockbuf), "%s/logged-gcc.sock", rundir);
+      else
+        snprintf(sockbuf, sizeof(sockbuf), "/tmp/logged-gcc-%d.sock", (int)getuid());
+    };
+  return sockbuf;
+} // end default_log_socket
+
 void
 say_usage(const char*progname)
 {
@@ -106,6 +158,21 @@ say_usage(const char*progname)
             << " --g++=<some-executable> #e.g. --g++=/usr/bin/g++-12, overridding $LOGGED_GXX" << std::endl
             << " --sqlite=<some-sqlite-file> #e.g. --sqlite=$HOME/l-gcc.sqlite, overridding $LOGGED_SQLITE" << std::endl
             << " --dosql=<some-sqlite-request> #e.g. --dosql='SELECT * FROM tb_sourcepath' for advanced users." << std::endl
+            << " --hash=<algorithm> #digest of sources, overridding $LOGGED_DIGEST" << std::endl
+            << " --hash-cache=<file> #persistent digest cache, overridding $LOGGED_HASH_CACHE" << std::endl
+            << " --cache=<dir> #serve object files (and -MD dependencies) of identical -c compilations from that cache, also $LOGGED_CACHE" << std::endl
+            << " --cache-max-mb=<megabytes> #size bound of that cache, default " << mycachemaxmb << std::endl
+            << " --deps #capture the included files of compilations with -MD, also if $LOGGED_DEPS is set" << std::endl
+            << " --header-costs[=N] #show the N included files whose compilations took most CPU time" << std::endl
+            << " --sample-ms=<milliseconds> #sample memory and CPU of each compilation, also $LOGGED_SAMPLE_MS" << std::endl
+            << " --cgroup=<cgroup-dir> #parent cgroup v2 of the sampled compilations, by default ours" << std::endl
+            << " --perf #also count instructions, cycles and cache misses of sampled compilations" << std::endl
+            << " --resource-report[=N] #show the N sampled compilations with the highest memory peak and lowest IPC" << std::endl
+            << " --report=<name> #run some canned report over the rollups, try --report=help" << std::endl
+            << " --report-top=<N> #number of rows of these reports, default " << myreporttop << std::endl
+            << " --daemon #run the logging daemon, storing records into the --sqlite database" << std::endl
+            << " --socket=<socket-path> #the logging daemon socket, overridding $LOGGED_SOCKET" << std::endl
+            << " --batch-ms=<milliseconds> #delay between database transactions of the daemon, default " << mybatchms << std::endl
             <<  "followed by program options passed to the GCC compiler..." << std::endl;
   std::clog << " Relevant environment variables are $LOGGED_GCC and $LOGGED_GXX for the compilers" << std::endl
             << "    (when --gcc=... or --g++=... is not given)." << std::endl
@@ -119,10 +186,16 @@ say_usage(const char*progname)
             << "which should have been initialized with a previous run" << std::endl
             << myprogname << " --sqlite=<sqlite-database-file>" << std::endl;
   std::clog << "If unset and $HOME/logged-gcc-db.sqlite exists it is used." << std::endl;
+  std::clog << "When the logging daemon socket (by default " << default_log_socket() << ") exists," << std::endl
+            << "records are sent to that daemon, or appended to the <socket>.spool file when it is not running." << std::endl;
   std::clog << "To dump that database, try probably some command like:" << std::endl
             << "    sqlite3 $HOME/logged-gcc-db.sqlite .dump" << std::endl << std::endl;
-  std::clog << "$LOGGED_DIGEST should probably be never set, using the default crypto digest " << (EVP_MD_CTX_get0_name(mymdctx)?:"??") << std::endl;
-#warning missing C++ code for crypto digest
+  std::clog << "Source digests are 128 bits " << myhashalgo << " hashes (--hash= or $LOGGED_DIGEST"
+#ifdef LOGGED_HAVE_XXHASH
+            << ", xxh3 or"
+#endif
+            << " an OpenSSL digest like md5 or blake2s256)," << std::endl
+            << "cached in " << (myhashcachepath?:"nothing") << " (--hash-cache= or $LOGGED_HASH_CACHE, none to disable)." << std::endl;
 } // end say_usage
 
 std::vector<const char*>
@@ -163,6 +236,93 @@ parse_logged_program_options(int &argc, char**argv,
           mysqlitepath=argv[ix]+strlen("--sqlite=");
           continue;
         }
+      else if (!strncmp(argv[ix],"--socket=", strlen ("--socket=")))
+        {
+          mylogsocket=argv[ix]+strlen("--socket=");
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--hash=", strlen ("--hash=")))
+        {
+          myhashalgo=argv[ix]+strlen("--hash=");
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--hash-cache=", strlen ("--hash-cache=")))
+        {
+          myhashcachepath=argv[ix]+strlen("--hash-cache=");
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--cache=", strlen ("--cache=")))
+        {
+          mycachedir=argv[ix]+strlen("--cache=");
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--cache-max-mb=", strlen ("--cache-max-mb=")))
+        {
+          mycachemaxmb = atol(argv[ix]+strlen("--cache-max-mb="));
+          if (mycachemaxmb < 1)
+            mycachemaxmb = 1;
+          continue;
+        }
+      else if (!strcmp(argv[ix],"--deps"))
+        {
+          mydepsmode = true;
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--header-costs", strlen ("--header-costs")))
+        {
+          myheadercosts = 20;
+          if (argv[ix][strlen("--header-costs")] == '=')
+            myheadercosts = atoi(argv[ix]+strlen("--header-costs="));
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--sample-ms=", strlen ("--sample-ms=")))
+        {
+          mysamplems = atoi(argv[ix]+strlen("--sample-ms="));
+          if (mysamplems < 0)
+            mysamplems = 0;
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--cgroup=", strlen ("--cgroup=")))
+        {
+          mycgroupdir = argv[ix]+strlen("--cgroup=");
+          continue;
+        }
+      else if (!strcmp(argv[ix],"--perf"))
+        {
+          myperfcounters = true;
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--resource-report", strlen ("--resource-report")))
+        {
+          myresourcetop = 20;
+          if (argv[ix][strlen("--resource-report")] == '=')
+            myresourcetop = atoi(argv[ix]+strlen("--resource-report="));
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--report=", strlen ("--report=")))
+        {
+          myreports.push_back(argv[ix]+strlen("--report="));
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--report-top=", strlen ("--report-top=")))
+        {
+          myreporttop = atoi(argv[ix]+strlen("--report-top="));
+          if (myreporttop < 1)
+            myreporttop = 1;
+          continue;
+        }
+      else if (!strcmp(argv[ix],"--daemon"))
+        {
+          daemon_mode = true;
+          continue;
+        }
+      else if (!strncmp(argv[ix],"--batch-ms=", strlen ("--batch-ms=")))
+        {
+          mybatchms = atoi(argv[ix]+strlen("--batch-ms="));
+          if (mybatchms < 1)
+            mybatchms = 1;
+          continue;
+        }
       else if (!strncmp(argv[ix],"--dosql=", strlen ("--dosql=")))
         {
           if (mysqliterequest != nullptr)
@@ -234,168 +394,1121 @@ parse_logged_program_options(int &argc, char**argv,
 } // end parse_logged_program_options
 
 
-/// return a serial in tb_sourcepath or 0 on failure
-std::int64_t
-register_sqlite_source_data(const char*realpath, const char*md5, long mtime, long size)
+/// A fixed-size binary log record.  Wrappers never write the Sqlite
+/// database themselves when a logging daemon socket is known: they
+/// send each record as one datagram to the daemon (see --daemon),
+/// or append it to the spool file when the daemon is absent or
+/// busy.  Records are 4096 bytes so each one is a single write(2).
+/// The low byte of the magic is the layout version, bumped on any
+/// change of the fields, so that a daemon ignores the records of
+/// wrappers built from another version; the first layout had 'c'.
+struct Logged_record
 {
-  char*msgerr = nullptr;
-  std::int64_t serialid= 0;
-  char *sqlreq= nullptr;
-  DEBUGLOG("register_sqlite_source_data start realpath:" << realpath << " md5:" << md5 << " mtime:" << mtime << " size:" << size);
-  sqlite3_str* str = sqlite3_str_new(mysqlitedb);
-  sqlite3_str_appendf(str, "BEGIN TRANSACTION;\n");
-  sqlite3_str_appendf(str, "INSERT OR IGNORE INTO tb_sourcepath(srcp_realpath) VALUES(%Q);", realpath);
-  sqlreq = sqlite3_str_value(str);
-  DEBUGLOG("register_sqlite_source_data realpath="
-           << realpath << " md5=" << md5
-           << " mtime=" << mtime << " size=" << size << " °sqlreq=" << sqlreq);
-  int r1 = sqlite3_exec(mysqlitedb, sqlreq, nullptr, nullptr, &msgerr);
-  if (r1 != SQLITE_OK)
-    {
-      syslog(LOG_ALERT, "register_sqlite_source_data (l¤%d) %s failure #%d: %s", __LINE__,
-             sqlreq, r1, msgerr?msgerr:"???");
-      return 0;
+  static constexpr std::uint32_t _lrec_version_ = 2;
+  static constexpr std::uint32_t _lrec_magic_ = 0x6c676300 | _lrec_version_; // "lgc" and version
+  enum kind_en : std::uint32_t
+  {
+    LREC_NONE,
+    LREC_SOURCE,		// a source file with its digest
+    LREC_COMPILATION,		// a successful compilation
+    LREC_INCLUDES,		// some files included by that compilation
+    LREC_RESOURCES,		// the resource series of that compilation
+  };
+  std::uint32_t lrec_magic;
+  std::uint32_t lrec_kind;
+  std::int32_t lrec_pid;
+  std::int32_t lrec_truncated;	// some string below was truncated
+  std::int64_t lrec_time;	// source mtime, or compilation start
+  std::int64_t lrec_size;	// source size
+  double lrec_elapsed, lrec_usercpu, lrec_syscpu;
+  std::int64_t lrec_maxrss, lrec_pageflt;
+  std::int32_t lrec_nbhashed, lrec_nbcachedhash;	// source digests
+  double lrec_hashtime, lrec_hashsaved;	// seconds spent, and saved by cache
+  std::int32_t lrec_cachestate;	// 0 without compilation cache, 1 miss, 2 hit
+  std::int32_t lrec_intervalms;	// of the resource series
+  std::int64_t lrec_counters[3];	// instructions, cycles, cache misses, or -1
+  char lrec_cachekey[40];
+  char lrec_hashalgo[16];
+  char lrec_digest[48];
+  char lrec_path[1024];		// the (first) source real path
+  char lrec_compiler[128];	// of a compilation, its argv[0]
+  char lrec_flagset[384];	// of a compilation, see compilation_flag_set
+  char lrec_command[2328];	// or newline separated included files,
+  // or the encoded resource series of lrec_size bytes
+  Logged_record(kind_en k=LREC_NONE)
+  {
+    memset((void*)this, 0, sizeof(*this));
+    lrec_magic = _lrec_magic_;
+    lrec_kind = k;
+    lrec_pid = (std::int32_t) getpid();
+  };
+  /// a logged-gcc record of another layout version
+  bool other_version() const
+  {
+    return (lrec_magic & ~0xffU) == (_lrec_magic_ & ~0xffU) && lrec_magic != _lrec_magic_;
+  };
+  bool valid() const
+  {
+    return lrec_magic == _lrec_magic_
+           && (lrec_kind == LREC_SOURCE || lrec_kind == LREC_COMPILATION
+               || lrec_kind == LREC_INCLUDES || lrec_kind == LREC_RESOURCES)
+           && lrec_cachekey[sizeof(lrec_cachekey)-1] == (char)0
+           && lrec_hashalgo[sizeof(lrec_hashalgo)-1] == (char)0
+           && lrec_digest[sizeof(lrec_digest)-1] == (char)0
+           && lrec_path[sizeof(lrec_path)-1] == (char)0
+           && lrec_compiler[sizeof(lrec_compiler)-1] == (char)0
+           && lrec_flagset[sizeof(lrec_flagset)-1] == (char)0
+           && lrec_command[sizeof(lrec_command)-1] == (char)0;
+  };
+  void put_string(char*dst, size_t siz, const char*src)
+  {
+    if (!src)
+      return;
+    size_t len = strlen(src);
+    if (len >= siz)
+      {
+        lrec_truncated = 1;
+        len = siz-1;
+      };
+    memcpy(dst, src, len);
+    dst[len] = (char)0;
+  };
+};				// end Logged_record
+static_assert(sizeof(Logged_record) == 4096, "Logged_record should be 4096 bytes");
+
+/// the records of this compilation, stored or sent at end of main
+std::vector<Logged_record> mylogrecords;
+
+/// append a LEB128 varint
+static inline void
+put_varint(std::string&blob, std::uint64_t val)
+{
+  do
+    {
+      unsigned char byte = val & 0x7f;
+      val >>= 7;
+      blob.push_back((char) (val ? (byte | 0x80) : byte));
+    }
+  while (val);
+} // end put_varint
+
+/// read a LEB128 varint, advancing pc
+static inline std::uint64_t
+get_varint(const unsigned char*&pc, const unsigned char*end)
+{
+  std::uint64_t val = 0;
+  int shift = 0;
+  while (pc < end)
+    {
+      unsigned char byte = *pc++;
+      val |= (std::uint64_t) (byte & 0x7f) << shift;
+      shift += 7;
+      if (!(byte & 0x80))
+        break;
+    }
+  return val;
+} // end get_varint
+
+/// Include sets are stored as compressed adjacency lists: the sorted
+/// interned ids of the included files, as LEB128 varints of their
+/// successive differences.
+std::string
+encode_include_ids(const std::vector<std::int64_t>&idvec)
+{
+  std::string blob;
+  std::int64_t previd = 0;
+  blob.reserve(2*idvec.size()+8);
+  for (std::int64_t id : idvec)
+    {
+      put_varint(blob, (std::uint64_t) (id - previd));
+      previd = id;
+    }
+  return blob;
+} // end encode_include_ids
+
+void
+decode_include_ids(const void*data, int size, std::vector<std::int64_t>&idvec)
+{
+  const unsigned char* pc = (const unsigned char*) data;
+  const unsigned char* end = pc + size;
+  std::int64_t previd = 0;
+  while (pc < end)
+    {
+      previd += (std::int64_t) get_varint(pc, end);
+      idvec.push_back(previd);
+    }
+} // end decode_include_ids
+
+/// Resource series are stored as two varints per sample: the zigzag
+/// encoded changes of resident kilobytes and of CPU microseconds.  At
+/// most maxbytes are used, dropping the last samples.
+std::string
+encode_resource_series(const std::vector<std::int64_t>&memvec,
+                       const std::vector<std::int64_t>&cpuvec, size_t maxbytes)
+{
+  std::string blob;
+  std::int64_t prevmem = 0, prevcpu = 0;
+  for (size_t ix = 0; ix < memvec.size() && ix < cpuvec.size(); ix++)
+    {
+      size_t oldsize = blob.size();
+      std::int64_t dmem = memvec[ix] - prevmem, dcpu = cpuvec[ix] - prevcpu;
+      put_varint(blob, ((std::uint64_t) dmem << 1) ^ (std::uint64_t) (dmem >> 63));
+      put_varint(blob, ((std::uint64_t) dcpu << 1) ^ (std::uint64_t) (dcpu >> 63));
+      if (blob.size() > maxbytes)
+        {
+          blob.resize(oldsize);
+          break;
+        };
+      prevmem = memvec[ix];
+      prevcpu = cpuvec[ix];
+    }
+  return blob;
+} // end encode_resource_series
+
+void
+decode_resource_series(const void*data, int size,
+                       std::vector<std::int64_t>&memvec, std::vector<std::int64_t>&cpuvec)
+{
+  const unsigned char* pc = (const unsigned char*) data;
+  const unsigned char* end = pc + size;
+  std::int64_t mem = 0, cpu = 0;
+  while (pc < end)
+    {
+      std::uint64_t zmem = get_varint(pc, end);
+      std::uint64_t zcpu = get_varint(pc, end);
+      mem += (std::int64_t) (zmem >> 1) ^ -(std::int64_t) (zmem & 1);
+      cpu += (std::int64_t) (zcpu >> 1) ^ -(std::int64_t) (zcpu & 1);
+      memvec.push_back(mem);
+      cpuvec.push_back(cpu);
+    }
+} // end decode_resource_series
+
+/// the compilations recently stored, by wrapper pid and start time,
+/// to attach their include records sent afterwards
+std::map<std::pair<std::int32_t,std::int64_t>,std::int64_t> recent_compilations;
+
+/// store a chunk of include paths of a compilation, merging it into
+/// its include set; return false on failure
+bool
+store_include_record(const Logged_record&rec)
+{
+  static sqlite3_stmt* stmt_incpath;	// intern an include path
+  static sqlite3_stmt* stmt_incid;	// get its id
+  static sqlite3_stmt* stmt_getincl;	// the include set of a compilation
+  static sqlite3_stmt* stmt_putincl;	// replace it
+  if (!stmt_incpath)
+    {
+      if (sqlite3_prepare_v3(mysqlitedb, "INSERT OR IGNORE INTO tb_includepath(incp_path) VALUES (?1)",
+                             -1, SQLITE_PREPARE_PERSISTENT, &stmt_incpath, nullptr) != SQLITE_OK
+          || sqlite3_prepare_v3(mysqlitedb, "SELECT incp_id FROM tb_includepath WHERE incp_path = ?1",
+                                -1, SQLITE_PREPARE_PERSISTENT, &stmt_incid, nullptr) != SQLITE_OK
+          || sqlite3_prepare_v3(mysqlitedb, "SELECT incl_ids FROM tb_compilation_includes WHERE incl_compil_id = ?1",
+                                -1, SQLITE_PREPARE_PERSISTENT, &stmt_getincl, nullptr) != SQLITE_OK
+          || sqlite3_prepare_v3(mysqlitedb, "INSERT OR REPLACE INTO tb_compilation_includes(incl_compil_id, incl_count, incl_ids)"
+                                " VALUES (?1, ?2, ?3)",
+                                -1, SQLITE_PREPARE_PERSISTENT, &stmt_putincl, nullptr) != SQLITE_OK)
+        {
+          syslog(LOG_ALERT, "store_include_record failed to prepare - %s", sqlite3_errmsg(mysqlitedb));
+          stmt_incpath = nullptr;
+          return false;
+        }
     };
-  serialid = sqlite3_last_insert_rowid(mysqlitedb);
-  sqlite3_str_reset(str);
-  DEBUGLOG("register_sqlite_source_data serialid=" << serialid);
-  sqlreq = nullptr;
-  sqlite3_str_appendf(str, "INSERT OR REPLACE INTO tb_sourcedata(srcd_path_serial, srcd_path_mtime, srcd_path_md5, srcd_path_size)"
-                      " VALUES (%lld, %ld, %Q, %ld);\n"
-                      "END TRANSACTION;",
-                      serialid, mtime, md5, size);
-  sqlreq = sqlite3_str_value(str);
-  DEBUGLOG("register_sqlite_source_data r2 °sqlreq=" << sqlreq);
-  int r2 = sqlite3_exec(mysqlitedb, sqlreq, nullptr, nullptr, &msgerr);
-  if (r2 != SQLITE_OK)
-    {
-      syslog(LOG_ALERT, "register_sqlite_source_data (l¤%d)  %s failure #%d: %s", __LINE__,
-             sqlreq, r2,  msgerr?msgerr:"???");
-      return 0;
+  auto it = recent_compilations.find({rec.lrec_pid, rec.lrec_time});
+  if (it == recent_compilations.end())
+    {
+      syslog(LOG_WARNING, "store_include_record no compilation of %s by pid %d", rec.lrec_path, (int)rec.lrec_pid);
+      return false;
+    };
+  std::int64_t compilid = it->second;
+  std::vector<std::int64_t> idvec;
+  sqlite3_bind_int64(stmt_getincl, 1, compilid);
+  if (sqlite3_step(stmt_getincl) == SQLITE_ROW)
+    decode_include_ids(sqlite3_column_blob(stmt_getincl, 0), sqlite3_column_bytes(stmt_getincl, 0), idvec);
+  sqlite3_reset(stmt_getincl);
+  for (const char*pc = rec.lrec_command; *pc; )
+    {
+      const char*eol = strchr(pc, '\n');
+      int len = eol ? (int)(eol-pc) : (int)strlen(pc);
+      sqlite3_bind_text(stmt_incpath, 1, pc, len, SQLITE_STATIC);
+      sqlite3_step(stmt_incpath);
+      sqlite3_reset(stmt_incpath);
+      sqlite3_bind_text(stmt_incid, 1, pc, len, SQLITE_STATIC);
+      if (sqlite3_step(stmt_incid) == SQLITE_ROW)
+        idvec.push_back(sqlite3_column_int64(stmt_incid, 0));
+      sqlite3_reset(stmt_incid);
+      pc += len;
+      if (*pc == '\n')
+        pc++;
     };
-  char*fbuf = sqlite3_str_finish(str);
-  sqlite3_free(fbuf);
-  DEBUGLOG("register_sqlite_source_data ending serialid=" << serialid
-           << " realpath=" << realpath << " md5=" << md5 << " mtime=" << mtime << " size=" << size);
-  return serialid;
-} // end register_sqlite_source_data
+  std::sort(idvec.begin(), idvec.end());
+  idvec.erase(std::unique(idvec.begin(), idvec.end()), idvec.end());
+  std::string blob = encode_include_ids(idvec);
+  sqlite3_bind_int64(stmt_putincl, 1, compilid);
+  sqlite3_bind_int(stmt_putincl, 2, (int) idvec.size());
+  sqlite3_bind_blob(stmt_putincl, 3, blob.data(), (int) blob.size(), SQLITE_STATIC);
+  int r = sqlite3_step(stmt_putincl);
+  sqlite3_reset(stmt_putincl);
+  return r == SQLITE_DONE;
+} // end store_include_record
 
+/// store the resource series of a compilation
+bool
+store_resource_record(const Logged_record&rec)
+{
+  static sqlite3_stmt* stmt_putres;
+  if (!stmt_putres
+      && sqlite3_prepare_v3(mysqlitedb, "INSERT OR REPLACE INTO tb_resource_series(rser_compil_id, rser_interval_ms,"
+                            " rser_nbsamples, rser_peak_kb, rser_instructions, rser_cycles, rser_cache_misses,"
+                            " rser_series) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8)",
+                            -1, SQLITE_PREPARE_PERSISTENT, &stmt_putres, nullptr) != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "store_resource_record failed to prepare - %s", sqlite3_errmsg(mysqlitedb));
+      stmt_putres = nullptr;
+      return false;
+    };
+  if (rec.lrec_size < 0 || rec.lrec_size >= (std::int64_t) sizeof(rec.lrec_command))
+    return false;
+  auto it = recent_compilations.find({rec.lrec_pid, rec.lrec_time});
+  if (it == recent_compilations.end())
+    {
+      syslog(LOG_WARNING, "store_resource_record no compilation of %s by pid %d", rec.lrec_path, (int)rec.lrec_pid);
+      return false;
+    };
+  std::vector<std::int64_t> memvec, cpuvec;
+  decode_resource_series(rec.lrec_command, (int) rec.lrec_size, memvec, cpuvec);
+  sqlite3_bind_int64(stmt_putres, 1, it->second);
+  sqlite3_bind_int(stmt_putres, 2, rec.lrec_intervalms);
+  sqlite3_bind_int(stmt_putres, 3, (int) memvec.size());
+  sqlite3_bind_int64(stmt_putres, 4, rec.lrec_maxrss);
+  for (int cix = 0; cix < 3; cix++)
+    {
+      if (rec.lrec_counters[cix] >= 0)
+        sqlite3_bind_int64(stmt_putres, 5+cix, rec.lrec_counters[cix]);
+      else
+        sqlite3_bind_null(stmt_putres, 5+cix);
+    };
+  sqlite3_bind_blob(stmt_putres, 8, rec.lrec_command, (int) rec.lrec_size, SQLITE_STATIC);
+  int r = sqlite3_step(stmt_putres);
+  sqlite3_reset(stmt_putres);
+  return r == SQLITE_DONE;
+} // end store_resource_record
+
+/// The flag set of a compilation, as rolled up, from its arguments
+/// after the compiler: its options without the output, include or
+/// library directories and dependency outputs.  Options carrying a
+/// per-file value are normalized so that the set of distinct flag
+/// sets stays small: -D and -U keep only the macro name, -Wl, -Wa,
+/// -Wp, become -Wl,* etc..., and an =value naming a file becomes =*
+std::string
+compilation_flag_set(const std::vector<std::string>&args)
+{
+  static const char*const skippedopts[] =
+  {
+    "-o", "-MF", "-MT", "-MQ", "-I", "-L", "-isystem", "-iquote", "-idirafter",
+    "-include", "-imacros", "-iprefix", "-iwithprefix", "-iwithprefixbefore",
+    "-isysroot", "-Xlinker", "-Xassembler", "-Xpreprocessor", nullptr
+  };
+  std::vector<std::string> flagvec;
+  for (size_t ix = 0; ix < args.size(); ix++)
+    {
+      std::string word = args[ix];
+      if (word.size() < 2 || word[0] != '-')
+        continue;
+      if (word == "-MD" || word == "-MMD" || word == "-MP")
+        continue;
+      bool skipped = false;
+      for (const char*const*ps = skippedopts; *ps && !skipped; ps++)
+        {
+          size_t len = strlen(*ps);
+          if (word.compare(0, len, *ps))
+            continue;
+          /// the value is either joined or the next argument
+          if (word.size() == len)
+            ix++;
+          skipped = true;
+        };
+      if (skipped)
+        continue;
+      if (!word.compare(0, 2, "-D") || !word.compare(0, 2, "-U"))
+        {
+          std::string macro = word.substr(2);
+          if (macro.empty() && ix+1 < args.size())
+            macro = args[++ix];
+          word = word.substr(0, 2) + macro.substr(0, macro.find_first_of("=("));
+        }
+      else if (!word.compare(0, 4, "-Wl,") || !word.compare(0, 4, "-Wa,") || !word.compare(0, 4, "-Wp,"))
+        word = word.substr(0, 4) + "*";
+      else if (word == "-x" && ix+1 < args.size())
+        word += args[++ix];
+      else
+        {
+          size_t eq = word.find('=');
+          if (eq != std::string::npos && word.find('/', eq) != std::string::npos)
+            word = word.substr(0, eq+1) + "*";
+        };
+      if (std::find(flagvec.begin(), flagvec.end(), word) == flagvec.end())
+        flagvec.push_back(word);
+    };
+  std::string flags;
+  for (const std::string& word: flagvec)
+    {
+      if (!flags.empty())
+        flags += ' ';
+      flags += word;
+    };
+  return flags;
+} // end compilation_flag_set
+
+/// begin an immediate write transaction, retrying a few times when
+/// the database stays busy beyond its busy timeout; false on failure
+bool
+begin_immediate_transaction(const char*who)
+{
+  int rc = SQLITE_BUSY;
+  for (int attempt = 0; attempt < 3; attempt++)
+    {
+      rc = sqlite3_exec(mysqlitedb, "BEGIN IMMEDIATE TRANSACTION", nullptr, nullptr, nullptr);
+      if (rc != SQLITE_BUSY && rc != SQLITE_LOCKED)
+        break;
+    };
+  if (rc != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "%s failed to begin a transaction on %s - %s",
+             who, mysqlitepath, sqlite3_errmsg(mysqlitedb));
+      return false;
+    };
+  return true;
+} // end begin_immediate_transaction
+
+/// Incrementally update the rollup tables with one compilation, in the
+/// current transaction: per source path, per day and source, per
+/// compiler, and per flag set.  Cache hits are not compilations and
+/// are left out, so that they do not dilute means.  Return false
+/// when the statements could not be prepared, then never retried.
+bool
+update_rollups(std::int64_t serial, const char*compiler, const char*flags,
+               std::int64_t startime, double elapsed, double cpu)
+{
+  static sqlite3_stmt* stmt_rlsource;
+  static sqlite3_stmt* stmt_rlday;
+  static sqlite3_stmt* stmt_rlcompiler;
+  static sqlite3_stmt* stmt_rlflags;
+  static bool preparefailed;
+  if (preparefailed)
+    return false;
+  if (!stmt_rlsource)
+    {
+      struct
+      {
+        sqlite3_stmt** pstmt;
+        const char* sql;
+      } prepatab[] =
+      {
+        {
+          &stmt_rlsource,
+          "INSERT INTO tb_rollup_source(rlsp_path_serial, rlsp_count, rlsp_elapsed, rlsp_cpu,"
+          " rlsp_max_elapsed, rlsp_last_time) VALUES (?1, 1, ?2, ?3, ?2, ?4)"
+          " ON CONFLICT(rlsp_path_serial) DO UPDATE SET rlsp_count = rlsp_count + 1,"
+          " rlsp_elapsed = rlsp_elapsed + ?2, rlsp_cpu = rlsp_cpu + ?3,"
+          " rlsp_max_elapsed = max(rlsp_max_elapsed, ?2), rlsp_last_time = max(rlsp_last_time, ?4)"
+        },
+        {
+          &stmt_rlday,
+          "INSERT INTO tb_rollup_day(rlday_day, rlday_path_serial, rlday_count, rlday_elapsed, rlday_cpu)"
+          " VALUES (?1, ?2, 1, ?3, ?4) ON CONFLICT(rlday_day, rlday_path_serial) DO UPDATE SET"
+          " rlday_count = rlday_count + 1, rlday_elapsed = rlday_elapsed + ?3, rlday_cpu = rlday_cpu + ?4"
+        },
+        {
+          &stmt_rlcompiler,
+          "INSERT INTO tb_rollup_compiler(rlcc_compiler, rlcc_count, rlcc_elapsed, rlcc_cpu)"
+          " VALUES (?1, 1, ?2, ?3) ON CONFLICT(rlcc_compiler) DO UPDATE SET"
+          " rlcc_count = rlcc_count + 1, rlcc_elapsed = rlcc_elapsed + ?2, rlcc_cpu = rlcc_cpu + ?3"
+        },
+        {
+          &stmt_rlflags,
+          "INSERT INTO tb_rollup_flags(rlfl_flags, rlfl_count, rlfl_elapsed, rlfl_cpu)"
+          " VALUES (?1, 1, ?2, ?3) ON CONFLICT(rlfl_flags) DO UPDATE SET"
+          " rlfl_count = rlfl_count + 1, rlfl_elapsed = rlfl_elapsed + ?2, rlfl_cpu = rlfl_cpu + ?3"
+        },
+      };
+      for (auto& prep: prepatab)
+        {
+          if (sqlite3_prepare_v3(mysqlitedb, prep.sql, -1, SQLITE_PREPARE_PERSISTENT,
+                                 prep.pstmt, nullptr) != SQLITE_OK)
+            {
+              syslog(LOG_ALERT, "update_rollups failed to prepare %s - %s",
+                     prep.sql, sqlite3_errmsg(mysqlitedb));
+              for (auto& fin: prepatab)
+                {
+                  sqlite3_finalize(*fin.pstmt);
+                  *fin.pstmt = nullptr;
+                };
+              preparefailed = true;
+              return false;
+            }
+        }
+    };
+  sqlite3_bind_int64(stmt_rlsource, 1, serial);
+  sqlite3_bind_double(stmt_rlsource, 2, elapsed);
+  sqlite3_bind_double(stmt_rlsource, 3, cpu);
+  sqlite3_bind_int64(stmt_rlsource, 4, startime);
+  sqlite3_step(stmt_rlsource);
+  sqlite3_reset(stmt_rlsource);
+  sqlite3_bind_int64(stmt_rlday, 1, startime / 86400);
+  sqlite3_bind_int64(stmt_rlday, 2, serial);
+  sqlite3_bind_double(stmt_rlday, 3, elapsed);
+  sqlite3_bind_double(stmt_rlday, 4, cpu);
+  sqlite3_step(stmt_rlday);
+  sqlite3_reset(stmt_rlday);
+  sqlite3_bind_text(stmt_rlcompiler, 1, compiler, -1, SQLITE_TRANSIENT);
+  sqlite3_bind_double(stmt_rlcompiler, 2, elapsed);
+  sqlite3_bind_double(stmt_rlcompiler, 3, cpu);
+  sqlite3_step(stmt_rlcompiler);
+  sqlite3_reset(stmt_rlcompiler);
+  sqlite3_bind_text(stmt_rlflags, 1, flags, -1, SQLITE_TRANSIENT);
+  sqlite3_bind_double(stmt_rlflags, 2, elapsed);
+  sqlite3_bind_double(stmt_rlflags, 3, cpu);
+  sqlite3_step(stmt_rlflags);
+  sqlite3_reset(stmt_rlflags);
+  return true;
+} // end update_rollups
+
+/// recompute all the rollups from the logged compilations, in the
+/// current transaction, exiting on failure
 void
-register_sqlite_compilation (std::int64_t firstserial, const char*firstmd5, const char*progstr,
-                             time_t startime, double elapsedtime,
-                             double usertime, double systime, long maxrss, long pageflt)
+fill_rollups(void)
 {
-  assert(mysqlitedb);
-  assert(firstserial>0);
+  sqlite3_stmt* stmt = nullptr;
+  long nbcompil = 0;
+  double startime = get_float_time(CLOCK_MONOTONIC);
+  if (sqlite3_exec(mysqlitedb, "DELETE FROM tb_rollup_source; DELETE FROM tb_rollup_day;"
+                   " DELETE FROM tb_rollup_compiler; DELETE FROM tb_rollup_flags;",
+                   nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "fill_rollups failed to clear - %s", sqlite3_errmsg(mysqlitedb));
+      exit(EXIT_FAILURE);
+    };
+  if (sqlite3_prepare_v2(mysqlitedb,
+                         "SELECT c.compil_firstsrc_id, c.compil_command, c.compil_start_time, c.compil_elapsed_time,"
+                         " c.compil_usercpu_time + c.compil_syscpu_time FROM tb_successful_compilation c"
+                         " LEFT JOIN tb_cache_event e ON e.cach_compil_id = c.compil_serial"
+                         " WHERE e.cach_hit IS NOT 1",
+                         -1, &stmt, nullptr) != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "fill_rollups failed to prepare - %s", sqlite3_errmsg(mysqlitedb));
+      exit(EXIT_FAILURE);
+    };
+  while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+      /// the logged command is its arguments joined by spaces, so
+      /// splitting it back is only an approximation of the argv,
+      /// which compilation_flag_set mostly absorbs
+      std::istringstream cmdin((const char*) sqlite3_column_text(stmt, 1));
+      std::vector<std::string> args;
+      std::string compiler, word;
+      cmdin >> compiler;
+      while (cmdin >> word)
+        args.push_back(word);
+      if (!update_rollups(sqlite3_column_int64(stmt, 0), compiler.c_str(),
+                          compilation_flag_set(args).c_str(),
+                          sqlite3_column_int64(stmt, 2), sqlite3_column_double(stmt, 3),
+                          sqlite3_column_double(stmt, 4)))
+        exit(EXIT_FAILURE);
+      nbcompil++;
+    };
+  sqlite3_finalize(stmt);
+  syslog(LOG_INFO, "rebuilt rollups of %ld compilations in %.3f seconds", nbcompil,
+         get_float_time(CLOCK_MONOTONIC) - startime);
+} // end fill_rollups
+
+/// recompute all the rollups in their own transaction, for
+/// --report=rebuild
+void
+rebuild_rollups(void)
+{
+  if (!begin_immediate_transaction("rebuild_rollups"))
+    exit(EXIT_FAILURE);
+  fill_rollups();
+  if (sqlite3_exec(mysqlitedb, "COMMIT TRANSACTION", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "rebuild_rollups failed to commit - %s", sqlite3_errmsg(mysqlitedb));
+      exit(EXIT_FAILURE);
+    };
+} // end rebuild_rollups
+
+/// store records in the database in one transaction with prepared
+/// statements, return the number of stored ones, or -1 when the
+/// transaction could not begin or commit so the batch may be retried
+int
+store_log_records(const Logged_record*recarr, int nbrec)
+{
+  static sqlite3_stmt* stmt_srcpath;	// insert the path
+  static sqlite3_stmt* stmt_srcserial;	// get its serial
+  static sqlite3_stmt* stmt_srcdata;	// insert or replace its data
+  static sqlite3_stmt* stmt_compil;	// insert the compilation
+  static sqlite3_stmt* stmt_lastcompil;	// update the path last compilation
+  static sqlite3_stmt* stmt_hashing;	// digest statistics of a compilation
+  static sqlite3_stmt* stmt_cacheevent;	// compilation cache hit or miss
+  int nbstored = 0;
+  assert (mysqlitedb != nullptr);
+  if (!stmt_srcpath)
+    {
+      struct
+      {
+        sqlite3_stmt** pstmt;
+        const char* sql;
+      } prepatab[] =
+      {
+        {
+          &stmt_srcpath,
+          "INSERT OR IGNORE INTO tb_sourcepath(srcp_realpath, srcp_last_compil_id, srcp_last_compil_time)"
+          " VALUES (?1, 0, ?2)"
+        },
+        {
+          &stmt_srcserial,
+          "SELECT srcp_serial FROM tb_sourcepath WHERE srcp_realpath = ?1"
+        },
+        {
+          &stmt_srcdata,
+          "INSERT OR REPLACE INTO tb_sourcedata(srcd_path_serial, srcd_path_mtime, srcd_path_md5, srcd_path_size)"
+          " VALUES (?1, ?2, ?3, ?4)"
+        },
+        {
+          &stmt_compil,
+          "INSERT INTO tb_successful_compilation"
+          " (compil_firstsrc_id, compil_firstsrc_md5, compil_command,"
+          "  compil_start_time, compil_elapsed_time, compil_usercpu_time, compil_syscpu_time,"
+          "  compil_page_faults, compil_max_rss)"
+          " VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9)"
+        },
+        {
+          &stmt_lastcompil,
+          "UPDATE tb_sourcepath SET srcp_last_compil_id = ?1, srcp_last_compil_time = ?2"
+          " WHERE srcp_serial = ?3"
+        },
+        {
+          &stmt_hashing,
+          "INSERT INTO tb_hashing(hash_compil_id, hash_algo, hash_nbfiles, hash_nbcached,"
+          " hash_time, hash_saved_time) VALUES (?1, ?2, ?3, ?4, ?5, ?6)"
+        },
+        {
+          &stmt_cacheevent,
+          "INSERT INTO tb_cache_event(cach_compil_id, cach_hit, cach_key) VALUES (?1, ?2, ?3)"
+        },
+      };
+      for (auto& prep: prepatab)
+        {
+          int r = sqlite3_prepare_v3(mysqlitedb, prep.sql, -1, SQLITE_PREPARE_PERSISTENT,
+                                     prep.pstmt, nullptr);
+          if (r != SQLITE_OK)
+            {
+              syslog(LOG_ALERT, "store_log_records (l¤%d) failed to prepare %s - %s", __LINE__,
+                     prep.sql, sqlite3_errmsg(mysqlitedb));
+              return 0;
+            }
+        }
+    };
+  if (!begin_immediate_transaction("store_log_records"))
+    return -1;
+  for (int rix=0; rix<nbrec; rix++)
+    {
+      const Logged_record& rec = recarr[rix];
+      std::int64_t serial = 0;
+      if (!rec.valid())
+        continue;
+      /// both kinds need the serial of their source path
+      sqlite3_bind_text(stmt_srcpath, 1, rec.lrec_path, -1, SQLITE_STATIC);
+      sqlite3_bind_int64(stmt_srcpath, 2, rec.lrec_time);
+      sqlite3_step(stmt_srcpath);
+      sqlite3_reset(stmt_srcpath);
+      sqlite3_bind_text(stmt_srcserial, 1, rec.lrec_path, -1, SQLITE_STATIC);
+      if (sqlite3_step(stmt_srcserial) == SQLITE_ROW)
+        serial = sqlite3_column_int64(stmt_srcserial, 0);
+      sqlite3_reset(stmt_srcserial);
+      if (serial <= 0)
+        {
+          syslog(LOG_WARNING, "store_log_records no serial for %s - %s",
+                 rec.lrec_path, sqlite3_errmsg(mysqlitedb));
+          continue;
+        };
+      if (rec.lrec_kind == Logged_record::LREC_INCLUDES)
+        {
+          if (store_include_record(rec))
+            nbstored++;
+          continue;
+        };
+      if (rec.lrec_kind == Logged_record::LREC_RESOURCES)
+        {
+          if (store_resource_record(rec))
+            nbstored++;
+          continue;
+        };
+      sqlite3_stmt* laststmt = nullptr;
+      if (rec.lrec_kind == Logged_record::LREC_SOURCE)
+        {
+          laststmt = stmt_srcdata;
+          sqlite3_bind_int64(stmt_srcdata, 1, serial);
+          sqlite3_bind_int64(stmt_srcdata, 2, rec.lrec_time);
+          sqlite3_bind_text(stmt_srcdata, 3, rec.lrec_digest, -1, SQLITE_STATIC);
+          sqlite3_bind_int64(stmt_srcdata, 4, rec.lrec_size);
+        }
+      else
+        {
+          laststmt = stmt_compil;
+          sqlite3_bind_int64(stmt_compil, 1, serial);
+          sqlite3_bind_text(stmt_compil, 2, rec.lrec_digest, -1, SQLITE_STATIC);
+          sqlite3_bind_text(stmt_compil, 3, rec.lrec_command, -1, SQLITE_STATIC);
+          sqlite3_bind_int64(stmt_compil, 4, rec.lrec_time);
+          sqlite3_bind_double(stmt_compil, 5, rec.lrec_elapsed);
+          sqlite3_bind_double(stmt_compil, 6, rec.lrec_usercpu);
+          sqlite3_bind_double(stmt_compil, 7, rec.lrec_syscpu);
+          sqlite3_bind_int64(stmt_compil, 8, rec.lrec_pageflt);
+          sqlite3_bind_int64(stmt_compil, 9, rec.lrec_maxrss);
+        };
+      int r = sqlite3_step(laststmt);
+      sqlite3_reset(laststmt);
+      if (r != SQLITE_DONE)
+        {
+          syslog(LOG_ALERT, "store_log_records (l¤%d) failed for %s - %s", __LINE__,
+                 rec.lrec_path, sqlite3_errmsg(mysqlitedb));
+          continue;
+        };
+      if (rec.lrec_kind == Logged_record::LREC_COMPILATION)
+        {
+          std::int64_t compilid = sqlite3_last_insert_rowid(mysqlitedb);
+          if (recent_compilations.size() > 65536)
+            recent_compilations.clear();
+          recent_compilations[ {rec.lrec_pid, rec.lrec_time}] = compilid;
+          sqlite3_bind_int64(stmt_lastcompil, 1, compilid);
+          sqlite3_bind_int64(stmt_lastcompil, 2, rec.lrec_time);
+          sqlite3_bind_int64(stmt_lastcompil, 3, serial);
+          sqlite3_step(stmt_lastcompil);
+          sqlite3_reset(stmt_lastcompil);
+          /// a compilation served by the result cache is not rolled up
+          if (rec.lrec_cachestate != 2)
+            update_rollups(serial, rec.lrec_compiler, rec.lrec_flagset, rec.lrec_time,
+                           rec.lrec_elapsed, rec.lrec_usercpu + rec.lrec_syscpu);
+          sqlite3_bind_int64(stmt_hashing, 1, compilid);
+          sqlite3_bind_text(stmt_hashing, 2, rec.lrec_hashalgo, -1, SQLITE_STATIC);
+          sqlite3_bind_int(stmt_hashing, 3, rec.lrec_nbhashed);
+          sqlite3_bind_int(stmt_hashing, 4, rec.lrec_nbcachedhash);
+          sqlite3_bind_double(stmt_hashing, 5, rec.lrec_hashtime);
+          sqlite3_bind_double(stmt_hashing, 6, rec.lrec_hashsaved);
+          sqlite3_step(stmt_hashing);
+          sqlite3_reset(stmt_hashing);
+          if (rec.lrec_cachestate > 0)
+            {
+              sqlite3_bind_int64(stmt_cacheevent, 1, compilid);
+              sqlite3_bind_int(stmt_cacheevent, 2, rec.lrec_cachestate == 2);
+              sqlite3_bind_text(stmt_cacheevent, 3, rec.lrec_cachekey, -1, SQLITE_STATIC);
+              sqlite3_step(stmt_cacheevent);
+              sqlite3_reset(stmt_cacheevent);
+            };
+        };
+      nbstored++;
+    };
+  int rc = sqlite3_exec(mysqlitedb, "COMMIT TRANSACTION", nullptr, nullptr, nullptr);
+  if (rc != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "store_log_records failed to commit %d records - %s",
+             nbrec, sqlite3_errmsg(mysqlitedb));
+      sqlite3_exec(mysqlitedb, "ROLLBACK TRANSACTION", nullptr, nullptr, nullptr);
+      return -1;
+    };
+  DEBUGLOG("store_log_records stored " << nbstored << " of " << nbrec << " records");
+  return nbstored;
+} // end store_log_records
+
+/// append a record to the spool file, which the daemon ingests later;
+/// O_APPEND makes concurrent wrappers safe without any lock
+void
+spool_log_record(const Logged_record&rec)
+{
+  assert (mylogspool != nullptr);
+  int fd = open(mylogspool, O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC, 0600);
+  if (fd < 0)
+    {
+      syslog(LOG_WARNING, "cannot open spool file %s - %m", mylogspool);
+      return;
+    };
+  if (write(fd, &rec, sizeof(rec)) != (ssize_t) sizeof(rec))
+    syslog(LOG_WARNING, "cannot write record to spool file %s - %m", mylogspool);
+  close(fd);
+} // end spool_log_record
+
+/// send a record to the logging daemon without ever blocking; fall
+/// back to the spool file and return false
+bool
+send_log_record(const Logged_record&rec)
+{
+  static int sockfd = -1;
+  struct sockaddr_un sun = {};
+  assert (mylogsocket != nullptr);
+  sun.sun_family = AF_UNIX;
+  strncpy(sun.sun_path, mylogsocket, sizeof(sun.sun_path)-1);
+  if (sockfd < 0)
+    sockfd = socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+  if (sockfd >= 0
+      && sendto(sockfd, &rec, sizeof(rec), MSG_DONTWAIT,
+                (struct sockaddr*)&sun, sizeof(sun)) == (ssize_t) sizeof(rec))
+    return true;
+  DEBUGLOG("send_log_record to " << mylogsocket << " failed: " << strerror(errno)
+           << ", spooling to " << mylogspool);
+  spool_log_record(rec);
+  return false;
+} // end send_log_record
+
+/// at end of the wrapper, send the records of this compilation to the
+/// daemon, or store them directly when there is no daemon socket
+void
+flush_log_records(void)
+{
+  if (mylogrecords.empty())
+    return;
+  if (mylogsocket)
+    {
+      /// after a failure, spool the others to keep their order
+      bool sent = true;
+      for (const Logged_record& rec : mylogrecords)
+        if (sent)
+          sent = send_log_record(rec);
+        else
+          spool_log_record(rec);
+    }
+  else if (mysqlitedb)
+    store_log_records(mylogrecords.data(), (int) mylogrecords.size());
+  mylogrecords.clear();
+} // end flush_log_records
+
+/// register a source file with its digest, return true on success
+bool
+register_source_data(const char*realpath, const char*md5, long mtime, long size)
+{
+  DEBUGLOG("register_source_data realpath:" << realpath << " md5:" << md5 << " mtime:" << mtime << " size:" << size);
+  if (!mysqlitedb && !mylogsocket)
+    return false;
+  Logged_record rec(Logged_record::LREC_SOURCE);
+  rec.put_string(rec.lrec_path, sizeof(rec.lrec_path), realpath);
+  rec.put_string(rec.lrec_digest, sizeof(rec.lrec_digest), md5);
+  rec.lrec_time = mtime;
+  rec.lrec_size = size;
+  mylogrecords.push_back(rec);
+  return true;
+} // end register_source_data
+
+void
+register_compilation (const char*firstpath, const char*firstmd5, const char*progstr,
+                      const std::vector<const char*>&progargvec, time_t startime, double elapsedtime,
+                      double usertime, double systime, long maxrss, long pageflt,
+                      int cachestate=0, const std::string&cachekey="")
+{
+  assert(firstpath!=nullptr);
   assert(firstmd5!=nullptr);
   assert(progstr!=nullptr);
   assert(startime>0);
-  char *sqlreq= nullptr;
-  char*msgerr=nullptr;
-  sqlite3_str* str = sqlite3_str_new(mysqlitedb);
-  sqlite3_str_appendf(str, "BEGIN TRANSACTION;");
-  sqlite3_str_appendf(str, "INSERT INTO tb_successful_compilation\n"
-                      " (compil_firstsrc_id, compil_firstsrc_md5, compil_command,\n"
-                      "  compil_start_time, compil_elapsed_time, compil_usercpu_time, compil_syscpu_time,\n"
-                      "  compil_page_faults, compil_max_rss)\n"
-                      " VALUES(%lld, %ld, %q, %q, %ld, %f, %f, %f, %ld, %d);\n",
-                      firstserial, firstmd5, progstr, startime, elapsedtime, usertime, systime, pageflt, maxrss);
-  sqlite3_str_appendf(str, "END TRANSACTION;\n");
-  sqlreq = sqlite3_str_value(str);
-  DEBUGLOG("register_sqlite_compilation successful r1 °sqlreq:" << sqlreq);
-  int r1 = sqlite3_exec(mysqlitedb, sqlreq, nullptr, nullptr, &msgerr);
-  if (r1 != SQLITE_OK)
-    {
-      syslog(LOG_ALERT, "register_sqlite_compilation (l¤%d) %s failure #%d: %s", __LINE__,
-             sqlreq, r1, msgerr?msgerr:"???");
-    };
-  char*fbuf = sqlite3_str_finish(str);
-  sqlite3_free(fbuf);
-} // end register_sqlite_compilation
-
-
-
-/// return a serial in sqlite database, or else 0, or -1 on failure
-std::int64_t
-register_show_md5_mtime(const char*path, time_t mtime, char*firstmd5)
+  Logged_record rec(Logged_record::LREC_COMPILATION);
+  rec.put_string(rec.lrec_path, sizeof(rec.lrec_path), firstpath);
+  rec.put_string(rec.lrec_digest, sizeof(rec.lrec_digest), firstmd5);
+  rec.put_string(rec.lrec_command, sizeof(rec.lrec_command), progstr);
+  if (!progargvec.empty() && progargvec[0])
+    {
+      std::vector<std::string> args;
+      for (size_t ix = 1; ix < progargvec.size() && progargvec[ix]; ix++)
+        args.push_back(progargvec[ix]);
+      rec.put_string(rec.lrec_compiler, sizeof(rec.lrec_compiler), progargvec[0]);
+      rec.put_string(rec.lrec_flagset, sizeof(rec.lrec_flagset), compilation_flag_set(args).c_str());
+    };
+  rec.lrec_time = startime;
+  rec.lrec_elapsed = elapsedtime;
+  rec.lrec_usercpu = usertime;
+  rec.lrec_syscpu = systime;
+  rec.lrec_maxrss = maxrss;
+  rec.lrec_pageflt = pageflt;
+  rec.lrec_nbhashed = myhashcount;
+  rec.lrec_nbcachedhash = myhashcached;
+  rec.lrec_hashtime = myhashtime;
+  rec.lrec_hashsaved = myhashsaved;
+  rec.put_string(rec.lrec_hashalgo, sizeof(rec.lrec_hashalgo), myhashalgo);
+  rec.lrec_cachestate = cachestate;
+  rec.put_string(rec.lrec_cachekey, sizeof(rec.lrec_cachekey), cachekey.c_str());
+  syslog(LOG_INFO, "hashed %d sources (%d cached) in %.4g seconds, the digest cache saved %.4g seconds",
+         myhashcount, myhashcached, myhashtime, myhashsaved);
+  DEBUGLOG("register_compilation " << firstpath << " truncated:" << rec.lrec_truncated);
+  mylogrecords.push_back(rec);
+} // end register_compilation
+
+
+
+/// an entry of the persistent digest cache, so unchanged sources are
+/// never hashed again; it is keyed by device, inode, modification
+/// time and size
+struct Hash_cache_entry
 {
-  char buf[1024];
-  unsigned char md5dig[MD5_DIGEST_LENGTH+4];
-  char md5buf[2*sizeof(md5dig)+16];
-  memset (md5dig, 0, sizeof(md5dig));
-  memset (md5buf, 0, sizeof(md5buf));
-  memset(buf, 0, sizeof(buf));
-  assert (path != nullptr && path[0] != (char)0);
-  assert (mtime != 0);
-  FILE* fil = fopen(path, "rm");
-  if (!fil)
+  std::uint64_t hce_dev, hce_ino;
+  std::int64_t hce_mtime_ns, hce_size;
+  std::int64_t hce_hash_ns;	// time spent hashing it once
+  std::uint32_t hce_algo;	// hash of the algorithm name
+  std::uint32_t hce_check;	// detects entries torn by concurrent writers
+  unsigned char hce_digest[16];
+};
+static_assert(sizeof(Hash_cache_entry) == 64, "Hash_cache_entry should be 64 bytes");
+#define HASH_CACHE_SLOTS 65536
+#define HASH_CACHE_PROBES 8
+
+static inline std::uint64_t
+mix_hash64(std::uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+} // end mix_hash64
+
+static std::uint32_t
+hash_cache_check(const Hash_cache_entry&e)
+{
+  std::uint64_t h = mix_hash64(e.hce_dev ^ 0x9e3779b97f4a7c15ULL);
+  h = mix_hash64(h ^ e.hce_ino);
+  h = mix_hash64(h ^ (std::uint64_t) e.hce_mtime_ns);
+  h = mix_hash64(h ^ (std::uint64_t) e.hce_size);
+  h = mix_hash64(h ^ (std::uint64_t) e.hce_hash_ns);
+  h = mix_hash64(h ^ e.hce_algo);
+  std::uint64_t d0, d1;
+  memcpy(&d0, e.hce_digest, 8);
+  memcpy(&d1, e.hce_digest+8, 8);
+  h = mix_hash64(h ^ d0);
+  h = mix_hash64(h ^ d1);
+  return (std::uint32_t) (h | 1);	// never 0, the value of empty slots
+} // end hash_cache_check
+
+/// create the missing parent directories of path, like mkdir -p
+void
+make_parent_directories(const char*path)
+{
+  std::string dir(path);
+  for (size_t slash = dir.find('/', 1); slash != std::string::npos; slash = dir.find('/', slash+1))
+    if (mkdir(dir.substr(0, slash).c_str(), 0755) && errno != EEXIST)
+      return;
+} // end make_parent_directories
+
+/// the shared mapping of the digest cache file, or null without a
+/// cache.  The default one goes silently without it, e.g. when $HOME
+/// is read-only in a container, while a given one warns.
+Hash_cache_entry*
+hash_cache_map(void)
+{
+  static Hash_cache_entry* cachemap;
+  static bool cachetried;
+  if (cachetried)
+    return cachemap;
+  cachetried = true;
+  if (!myhashcachepath || !strcmp(myhashcachepath, "none"))
+    return nullptr;
+  int fd = open(myhashcachepath, O_RDWR|O_CREAT|O_CLOEXEC, 0600);
+  if (fd < 0 && errno == ENOENT)
     {
-      syslog(LOG_WARNING, "register_show_md5_mtime cannot open %s - %m", path);
-      return -1;
+      make_parent_directories(myhashcachepath);
+      fd = open(myhashcachepath, O_RDWR|O_CREAT|O_CLOEXEC, 0600);
     };
-  MD5_CTX ctx;
-  memset (&ctx, 0, sizeof(ctx));
-  if (!MD5_Init(&ctx))
+  struct stat st = {};
+  const off_t cachesize = (off_t) HASH_CACHE_SLOTS * sizeof(Hash_cache_entry);
+  if (fd < 0 || fstat(fd, &st)
+      || (st.st_size < cachesize && ftruncate(fd, cachesize)))
     {
-      syslog(LOG_WARNING, "register_show_md5_mtime failed to MD5_Init @%p for %s - %m", (void*)&ctx, path);
-      return -1;
+      if (myhashcachedefault)
+        DEBUGLOG("hash_cache_map cannot use default digest cache " << myhashcachepath
+                 << " - " << strerror(errno));
+      else
+        syslog(LOG_WARNING, "cannot use digest cache %s - %m", myhashcachepath);
+      if (fd >= 0)
+        close(fd);
+      return nullptr;
     };
-  long off = 0;
-  do
+  void* ad = mmap(nullptr, cachesize, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ad == MAP_FAILED)
     {
-      memset(buf, 0, sizeof(buf));
-      off= ftell(fil);
-      ssize_t nb = fread(buf, 1, sizeof(buf), fil);
-      long newoff = ftell(fil);
-      if (nb < 0)
-        {
-          syslog(LOG_ALERT, "register_show_md5_mtime failed to fread %s at offset %ld - %m",
-                 path, off);
-          return -1;
-        };
-      if (nb==0)
+      syslog(LOG_WARNING, "cannot mmap digest cache %s - %m", myhashcachepath);
+      return nullptr;
+    };
+  cachemap = (Hash_cache_entry*) ad;
+  return cachemap;
+} // end hash_cache_map
+
+/// the 32 bits FNV-1a hash of the digest algorithm name
+std::uint32_t
+hash_algo_id(void)
+{
+  std::uint32_t h = 2166136261U;
+  for (const char*pc = myhashalgo; *pc; pc++)
+    h = (h ^ (unsigned char)*pc) * 16777619U;
+  return h;
+} // end hash_algo_id
+
+static Hash_cache_entry*
+hash_cache_lookup(const struct stat&st)
+{
+  Hash_cache_entry* cachemap = hash_cache_map();
+  if (!cachemap)
+    return nullptr;
+  std::uint64_t slot = mix_hash64(st.st_dev * 0x9e3779b97f4a7c15ULL ^ st.st_ino);
+  for (int p=0; p<HASH_CACHE_PROBES; p++)
+    {
+      Hash_cache_entry* e = cachemap + (slot + p) % HASH_CACHE_SLOTS;
+      if (e->hce_check == 0)
         break;
-      if (!MD5_Update(&ctx, buf, nb))
+      if (e->hce_dev == (std::uint64_t) st.st_dev && e->hce_ino == (std::uint64_t) st.st_ino
+          && e->hce_mtime_ns == st.st_mtim.tv_sec*1000000000LL + st.st_mtim.tv_nsec
+          && e->hce_size == st.st_size && e->hce_algo == hash_algo_id()
+          && e->hce_check == hash_cache_check(*e))
+        return e;
+    }
+  return nullptr;
+} // end hash_cache_lookup
+
+static void
+hash_cache_store(const struct stat&st, const unsigned char digest[16], std::int64_t hashns)
+{
+  Hash_cache_entry* cachemap = hash_cache_map();
+  if (!cachemap)
+    return;
+  Hash_cache_entry ent = {};
+  ent.hce_dev = st.st_dev;
+  ent.hce_ino = st.st_ino;
+  ent.hce_mtime_ns = st.st_mtim.tv_sec*1000000000LL + st.st_mtim.tv_nsec;
+  ent.hce_size = st.st_size;
+  ent.hce_hash_ns = hashns;
+  ent.hce_algo = hash_algo_id();
+  memcpy(ent.hce_digest, digest, sizeof(ent.hce_digest));
+  ent.hce_check = hash_cache_check(ent);
+  std::uint64_t slot = mix_hash64(st.st_dev * 0x9e3779b97f4a7c15ULL ^ st.st_ino);
+  /// reuse the slot of the same file or an empty one, else evict the first probed
+  Hash_cache_entry* victim = cachemap + slot % HASH_CACHE_SLOTS;
+  for (int p=0; p<HASH_CACHE_PROBES; p++)
+    {
+      Hash_cache_entry* e = cachemap + (slot + p) % HASH_CACHE_SLOTS;
+      if (e->hce_check == 0
+          || (e->hce_dev == ent.hce_dev && e->hce_ino == ent.hce_ino))
         {
-          syslog(LOG_ALERT, "register_show_md5_mtime failed to MD5_Update %s at offset %ld - %m",
-                 path, off);
-          return -1;
-        };
-      off = newoff;
+          victim = e;
+          break;
+        }
     }
-  while (!feof(fil));
-  fclose(fil);
-  if (!MD5_Final(md5dig, &ctx))
+  *victim = ent;
+} // end hash_cache_store
+
+/// compute the 128 bits digest of some memory, return false on failure
+bool
+digest_buffer(const void*data, size_t size, unsigned char digest[16])
+{
+#ifdef LOGGED_HAVE_XXHASH
+  if (!mymd)
     {
-      syslog(LOG_ALERT, "register_show_md5_mtime failed to MD5_Final %s at offset %ld - %m",
-             path, off);
-      return -1;
+      XXH128_canonical_t canon;
+      XXH128_canonicalFromHash(&canon, XXH3_128bits(data, size));
+      memcpy(digest, canon.digest, 16);
+      return true;
+    }
+#endif /*LOGGED_HAVE_XXHASH*/
+  unsigned char mdbuf[EVP_MAX_MD_SIZE];
+  unsigned mdlen = 0;
+  memset (mdbuf, 0, sizeof(mdbuf));
+  bool ok = EVP_DigestInit_ex(mymdctx, mymd, nullptr)
+            && EVP_DigestUpdate(mymdctx, data, size)
+            && EVP_DigestFinal_ex(mymdctx, mdbuf, &mdlen);
+  /// longer digests are truncated to 128 bits
+  memcpy(digest, mdbuf, 16);
+  return ok;
+} // end digest_buffer
+
+/// compute the 128 bits digest of a file by mmap-ing it, return false on failure
+bool
+compute_file_digest(const char*path, long size, unsigned char digest[16])
+{
+  int fd = open(path, O_RDONLY|O_CLOEXEC);
+  if (fd < 0)
+    {
+      syslog(LOG_WARNING, "compute_file_digest cannot open %s - %m", path);
+      return false;
+    };
+  const void* ad = nullptr;
+  if (size > 0)
+    {
+      ad = mmap(nullptr, size, PROT_READ, MAP_PRIVATE|MAP_POPULATE, fd, 0);
+      if (ad == MAP_FAILED)
+        {
+          syslog(LOG_WARNING, "compute_file_digest cannot mmap %s (%ld bytes) - %m", path, size);
+          close(fd);
+          return false;
+        }
     };
-  for (int ix=0; ix<MD5_DIGEST_LENGTH; ix++)
-    snprintf(md5buf+(2*ix), 3, "%02x", (unsigned)md5dig[ix]);
-  if (firstmd5)
-    strncpy(firstmd5, md5buf, 2*MD5_DIGEST_LENGTH);
-  syslog(LOG_INFO, "source file %s has %ld bytes; of md5 %s", path, off, md5buf);
-  DEBUGLOG("register_show_md5_mtime path=" << path << " off=" << off << " mtime=" << mtime << " md5buf=" << md5buf);
-  if (mysqlitedb)
-    {
-      std::int64_t serial = register_sqlite_source_data(path, md5buf, mtime, off);
-      DEBUGLOG("register_show_md5_mtime path=" << path << " mtime=" << mtime << " firstmd5=" << firstmd5
-               << " gives serial=" << serial);
-      return serial;
+  close(fd);
+  bool ok = digest_buffer(ad?:"", size, digest);
+  if (!ok)
+    syslog(LOG_ALERT, "compute_file_digest failed to digest %s with %s", path, myhashalgo);
+  if (ad)
+    munmap((void*)ad, size);
+  return ok;
+} // end compute_file_digest
+
+/// return 1 when registered for the database, or else 0, or -1 on failure
+std::int64_t
+register_show_digest_mtime(const char*path, const struct stat&st, char*firstmd5)
+{
+  unsigned char digest[16];
+  char md5buf[2*sizeof(digest)+16];
+  memset (digest, 0, sizeof(digest));
+  memset (md5buf, 0, sizeof(md5buf));
+  assert (path != nullptr && path[0] != (char)0);
+  time_t mtime = st.st_mtime;
+  long off = st.st_size;
+  const Hash_cache_entry* hce = hash_cache_lookup(st);
+  if (hce)
+    {
+      memcpy(digest, hce->hce_digest, sizeof(digest));
+      myhashcached++;
+      myhashsaved += 1.0e-9 * hce->hce_hash_ns;
     }
   else
     {
-      DEBUGLOG("register_show_md5_mtime path=" << path << " mtime=" << mtime << " firstmd5=" << firstmd5
+      double startime = get_float_time(CLOCK_MONOTONIC);
+      if (!compute_file_digest(path, off, digest))
+        return -1;
+      double hashtime = get_float_time(CLOCK_MONOTONIC) - startime;
+      myhashtime += hashtime;
+      hash_cache_store(st, digest, (std::int64_t) (hashtime*1.0e9));
+    };
+  myhashcount++;
+  for (int ix=0; ix<(int)sizeof(digest); ix++)
+    snprintf(md5buf+(2*ix), 3, "%02x", (unsigned)digest[ix]);
+  if (firstmd5 && !firstmd5[0])
+    strncpy(firstmd5, md5buf, 2*sizeof(digest));
+  syslog(LOG_INFO, "source file %s has %ld bytes; of %s %s%s", path, off, myhashalgo, md5buf,
+         hce?" (cached)":"");
+  DEBUGLOG("register_show_digest_mtime path=" << path << " off=" << off << " mtime=" << mtime << " md5buf=" << md5buf);
+  if (mysqlitedb || mylogsocket)
+    {
+      bool registered = register_source_data(path, md5buf, mtime, off);
+      DEBUGLOG("register_show_digest_mtime path=" << path << " mtime=" << mtime << " firstmd5=" << firstmd5
+               << " registered=" << registered);
+      return registered?1:-1;
+    }
+  else
+    {
+      DEBUGLOG("register_show_digest_mtime path=" << path << " mtime=" << mtime << " firstmd5=" << firstmd5
                << " done without sqlite");
       return 0;
     }
-} // end register_show_md5_mtime
+} // end register_show_digest_mtime
 
 
-/// measure with stat(2) the input source files. Return the serial (for sqlite) of the first one.
+/// measure with stat(2) the input source files. Return the
+/// registration (for sqlite) of the first one, whose real path goes
+/// into firstpath.
 std::int64_t
-stat_input_files(const std::vector<const char*>&progargvec, char*firstmd5)
+stat_input_files(const std::vector<const char*>&progargvec, char*firstmd5, std::string&firstpath, int&nbsources)
 {
   std::int64_t firstserial = 0;
   int nbargs = progargvec.size();
@@ -454,56 +1567,859 @@ stat_input_files(const std::vector<const char*>&progargvec, char*firstmd5)
             }
           if (isasrc)
             {
-              if (access(curarg, R_OK))
-                {
-                  syslog(LOG_WARNING, "cannot read access source %s: %m", curarg);
-                  continue;
-                }
-              for (const char*pc = curarg; *pc; pc++)
-                {
-                  if (isspace(*pc))
-                    {
-                      syslog(LOG_ALERT, "%s (%s git %s): source file %s cannot have space!",
-                             myprogname, __FILE__, GITID, curarg);
-                      exit(EXIT_FAILURE);
-                    }
-                }
-              struct stat st;
-              memset(&st, 0, sizeof(st));
-              if (stat (curarg, &st))
-                syslog(LOG_WARNING, "cannot stat source %s: %m", curarg);
-              else if ((st.st_mode & S_IFMT) != S_IFREG)
-                syslog(LOG_WARNING, "source %s is not a regular file", curarg);
-              else
-                {
-                  time_t mtim = st.st_mtime;
-                  struct tm mtimtm;
-                  memset(&mtimtm, 0, sizeof(mtimtm));
-                  localtime_r(&mtim, &mtimtm);
-                  char mtimbuf[64];
-                  memset(mtimbuf, 0, sizeof(mtimbuf));
-                  strftime(mtimbuf, sizeof(mtimbuf), "%c", &mtimtm);
-                  char*rp = realpath(curarg, nullptr);
-                  if (!rp)
-                    syslog(LOG_WARNING, "source %s failed realpath", curarg);
-                  else
-                    {
-                      syslog(LOG_INFO, "source %s, real %s, has %ld bytes, modified %s", curarg, rp, (long)st.st_size, mtimbuf);
-                      DEBUGLOG("stat_input_files registering rp:" << rp);
-                      std::int64_t serial = register_show_md5_mtime(rp, mtim, firstmd5);
-                      if (nbsrcfiles++ == 0)
-                        firstserial = serial;
-                      free(rp);
-                    }
-                }
+              if (access(curarg, R_OK))
+                {
+                  syslog(LOG_WARNING, "cannot read access source %s: %m", curarg);
+                  continue;
+                }
+              for (const char*pc = curarg; *pc; pc++)
+                {
+                  if (isspace(*pc))
+                    {
+                      syslog(LOG_ALERT, "%s (%s git %s): source file %s cannot have space!",
+                             myprogname, __FILE__, GITID, curarg);
+                      exit(EXIT_FAILURE);
+                    }
+                }
+              struct stat st;
+              memset(&st, 0, sizeof(st));
+              if (stat (curarg, &st))
+                syslog(LOG_WARNING, "cannot stat source %s: %m", curarg);
+              else if ((st.st_mode & S_IFMT) != S_IFREG)
+                syslog(LOG_WARNING, "source %s is not a regular file", curarg);
+              else
+                {
+                  time_t mtim = st.st_mtime;
+                  struct tm mtimtm;
+                  memset(&mtimtm, 0, sizeof(mtimtm));
+                  localtime_r(&mtim, &mtimtm);
+                  char mtimbuf[64];
+                  memset(mtimbuf, 0, sizeof(mtimbuf));
+                  strftime(mtimbuf, sizeof(mtimbuf), "%c", &mtimtm);
+                  char*rp = realpath(curarg, nullptr);
+                  if (!rp)
+                    syslog(LOG_WARNING, "source %s failed realpath", curarg);
+                  else
+                    {
+                      syslog(LOG_INFO, "source %s, real %s, has %ld bytes, modified %s", curarg, rp, (long)st.st_size, mtimbuf);
+                      DEBUGLOG("stat_input_files registering rp:" << rp);
+                      std::int64_t serial = register_show_digest_mtime(rp, st, firstmd5);
+                      if (nbsrcfiles++ == 0)
+                        {
+                          firstserial = serial;
+                          firstpath = rp;
+                        }
+                      free(rp);
+                    }
+                }
+            }
+        }
+    }
+  nbsources = nbsrcfiles;
+  DEBUGLOG("stat_input_files ending firstserial=" << firstserial << " nbsources=" << nbsources);
+  return firstserial;
+} // end stat_input_files
+
+
+
+/// register the files included by a compilation, in chunks of records
+void
+register_includes(const char*firstpath, time_t startime, const std::vector<std::string>&incvec)
+{
+  Logged_record rec(Logged_record::LREC_INCLUDES);
+  rec.put_string(rec.lrec_path, sizeof(rec.lrec_path), firstpath);
+  rec.lrec_time = startime;
+  size_t used = 0;
+  for (const std::string& inc : incvec)
+    {
+      if (inc.size() + 2 >= sizeof(rec.lrec_command))
+        continue;
+      if (used + inc.size() + 2 >= sizeof(rec.lrec_command))
+        {
+          mylogrecords.push_back(rec);
+          memset(rec.lrec_command, 0, sizeof(rec.lrec_command));
+          used = 0;
+        };
+      if (used > 0)
+        rec.lrec_command[used++] = '\n';
+      memcpy(rec.lrec_command+used, inc.data(), inc.size());
+      used += inc.size();
+      rec.lrec_size++;
+    };
+  if (used > 0)
+    mylogrecords.push_back(rec);
+  DEBUGLOG("register_includes " << firstpath << " with " << incvec.size() << " included files");
+} // end register_includes
+
+/// parse a make dependency file written by gcc -MD -MF, returning the
+/// real paths of its prerequisites except the compiled source
+std::vector<std::string>
+parse_depfile(const char*deppath, const std::string&firstpath)
+{
+  std::vector<std::string> incvec;
+  std::string dep;
+  bool intarget = true;
+  FILE* fil = fopen(deppath, "r");
+  if (!fil)
+    {
+      syslog(LOG_WARNING, "parse_depfile cannot open %s - %m", deppath);
+      return incvec;
+    };
+  auto end_word = [&]()
+  {
+    if (dep.empty())
+      return;
+    if (intarget)
+      {
+        if (dep.back() == ':')
+          intarget = false;
+      }
+    else
+      {
+        char*rp = realpath(dep.c_str(), nullptr);
+        if (rp && firstpath != rp)
+          incvec.push_back(rp);
+        free(rp);
+      }
+    dep.clear();
+  };
+  for (int c = getc(fil); c != EOF; c = getc(fil))
+    {
+      if (c == '\\')
+        {
+          int nc = getc(fil);
+          if (nc == '\n')
+            end_word();
+          else if (nc == ' ' || nc == '#' || nc == '\\')
+            dep.push_back((char)nc);
+          else
+            {
+              dep.push_back('\\');
+              if (nc != EOF)
+                ungetc(nc, fil);
+            }
+        }
+      else if (c == '$')
+        {
+          int nc = getc(fil);
+          dep.push_back('$');
+          if (nc != '$' && nc != EOF)
+            ungetc(nc, fil);
+        }
+      else if (c == ':' && intarget)
+        {
+          dep.push_back(':');
+          end_word();
+        }
+      else if (isspace(c))
+        end_word();
+      else
+        dep.push_back((char)c);
+    };
+  end_word();
+  fclose(fil);
+  return incvec;
+} // end parse_depfile
+
+/// with --deps, we can add -MD -MF to a compilation of one source
+/// which does not already ask for dependencies or only preprocesses
+bool
+can_capture_dependencies(const std::vector<const char*>&progargvec, int nbsources)
+{
+  bool compiling = false;
+  if (!mydepsmode || nbsources != 1)
+    return false;
+  for (const char* arg : progargvec)
+    {
+      if (!arg)
+        continue;
+      if (!strncmp(arg, "-M", 2) || !strcmp(arg, "-E") || !strncmp(arg, "-Wp,", 4))
+        return false;
+      if (!strcmp(arg, "-c") || !strcmp(arg, "-S"))
+        compiling = true;
+    };
+  return compiling;
+} // end can_capture_dependencies
+
+/// with --cache=<dir>, the result of a compilation of one source with
+/// -c is stored as one entry <dir>/<xy>/<key>.entry holding the object
+/// and the dependencies written with -MD or -MMD (or captured by
+/// --deps), without their target.  The 128 bits key hashes the
+/// preprocessed translation unit, the flags which are not only for the
+/// preprocessor, and the compiler identity.  Each of the 256 <xy>
+/// subdirectories is bounded to 1/256 of --cache-max-mb and evicted in
+/// least recently used order.
+struct Cache_outputs
+{
+  std::string co_objpath;	// from -o, or the source basename with .o
+  std::string co_deppath;	// with -MD or -MMD, from -MF or the object
+  std::string co_targets;	// of the dependencies, from -MT and -MQ
+};
+
+/// quote a make target like -MQ does
+static std::string
+quote_make_target(const char*target)
+{
+  std::string quoted;
+  for (const char*pc = target; *pc; pc++)
+    {
+      if (*pc == ' ' || *pc == '\t' || *pc == '#')
+        quoted += '\\';
+      else if (*pc == '$')
+        quoted += '$';
+      quoted += *pc;
+    };
+  return quoted;
+} // end quote_make_target
+
+bool
+can_use_cache(const std::vector<const char*>&progargvec, int nbsources,
+              const std::string&firstpath, Cache_outputs&outs)
+{
+  bool compiling = false, depending = false;
+  std::string depfile;
+  if (!mycachedir || nbsources != 1)
+    return false;
+  outs = Cache_outputs();
+  int nbargs = (int) progargvec.size();
+  for (int ix=1; ix<nbargs && progargvec[ix]; ix++)
+    {
+      const char* arg = progargvec[ix];
+      if (!strcmp(arg, "-c"))
+        compiling = true;
+      else if (!strcmp(arg, "-o") && ix+1 < nbargs && progargvec[ix+1])
+        outs.co_objpath = progargvec[++ix];
+      else if (!strcmp(arg, "-MD") || !strcmp(arg, "-MMD"))
+        depending = true;
+      else if (!strcmp(arg, "-MP"))
+        continue;
+      else if (!strncmp(arg, "-MF", 3) || !strncmp(arg, "-MT", 3) || !strncmp(arg, "-MQ", 3))
+        {
+          /// their value is joined or the next argument
+          const char* val = arg[3] ? arg+3 : (ix+1 < nbargs ? progargvec[++ix] : nullptr);
+          if (!val)
+            return false;
+          if (arg[2] == 'F')
+            depfile = val;
+          else
+            {
+              if (!outs.co_targets.empty())
+                outs.co_targets += ' ';
+              outs.co_targets += (arg[2] == 'Q') ? quote_make_target(val) : std::string(val);
+            }
+        }
+      else if (!strncmp(arg, "-M", 2) || !strcmp(arg, "-E") || !strcmp(arg, "-S")
+               || !strcmp(arg, "-") || !strncmp(arg, "-save-temps", 11)
+               || !strncmp(arg, "-fprofile-", 10) || !strcmp(arg, "-ftest-coverage")
+               || !strncmp(arg, "-Wp,", 4) || !strncmp(arg, "-x", 2))
+        return false;
+    };
+  if (!compiling)
+    return false;
+  if (outs.co_objpath.empty())
+    {
+      /// gcc -c dir/foo.c writes foo.o in the current directory
+      const char* base = strrchr(firstpath.c_str(), '/');
+      base = base ? base+1 : firstpath.c_str();
+      const char* dot = strrchr(base, '.');
+      outs.co_objpath = std::string(base, dot ? (size_t)(dot-base) : strlen(base)) + ".o";
+    };
+  if (depending)
+    {
+      if (depfile.empty())
+        {
+          /// like gcc, the object path with its suffix replaced by .d
+          depfile = outs.co_objpath;
+          size_t dot = depfile.rfind('.');
+          if (dot != std::string::npos && depfile.find('/', dot) == std::string::npos)
+            depfile.erase(dot);
+          depfile += ".d";
+        };
+      outs.co_deppath = depfile;
+      if (outs.co_targets.empty())
+        outs.co_targets = quote_make_target(outs.co_objpath.c_str());
+    }
+  else if (!depfile.empty() || !outs.co_targets.empty())
+    return false;
+  return true;
+} // end can_use_cache
+
+/// write a file thru a temporary one renamed at end, return false on failure
+bool
+write_file_atomically(const std::string&dstpath, const char*data, size_t size)
+{
+  std::string tmppath = dstpath + ".tmp" + std::to_string((int)getpid());
+  int dstfd = open(tmppath.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+  if (dstfd < 0)
+    return false;
+  bool ok = true;
+  while (size > 0 && ok)
+    {
+      ssize_t nb = write(dstfd, data, size);
+      if (nb < 0 && errno == EINTR)
+        continue;
+      ok = nb > 0;
+      if (ok)
+        {
+          data += nb;
+          size -= nb;
+        }
+    };
+  if (close(dstfd) || !ok || rename(tmppath.c_str(), dstpath.c_str()))
+    {
+      unlink(tmppath.c_str());
+      return false;
+    };
+  return true;
+} // end write_file_atomically
+
+/// read a whole file, return false on failure
+bool
+read_whole_file(const char*path, std::string&content)
+{
+  int fd = open(path, O_RDONLY|O_CLOEXEC);
+  struct stat st = {};
+  if (fd < 0)
+    return false;
+  if (fstat(fd, &st))
+    {
+      close(fd);
+      return false;
+    };
+  content.resize(st.st_size);
+  size_t done = 0;
+  while (done < content.size())
+    {
+      ssize_t nb = read(fd, &content[done], content.size() - done);
+      if (nb < 0 && errno == EINTR)
+        continue;
+      if (nb <= 0)
+        break;
+      done += nb;
+    };
+  close(fd);
+  content.resize(done);
+  return done == (size_t) st.st_size;
+} // end read_whole_file
+
+/// the hex cache key of a compilation, or an empty string when its
+/// preprocessing fails
+std::string
+compute_cache_key(const char*cmdname, const std::vector<const char*>&progargvec,
+                  const std::string&firstpath)
+{
+  std::vector<const char*> cppargvec;
+  std::string keymat = "logged-gcc-cache-2\n";
+  bool debugging = false;
+  char tupath[128];
+  memset (tupath, 0, sizeof(tupath));
+  /// the compiler identity
+  struct stat ccst = {};
+  char* ccrp = realpath(cmdname, nullptr);
+  if (!ccrp || stat(ccrp, &ccst))
+    {
+      free(ccrp);
+      return "";
+    };
+  keymat += std::string(ccrp) + " " + std::to_string((long long) ccst.st_size)
+            + " " + std::to_string((long long) ccst.st_mtime) + "\n";
+  free(ccrp);
+  /// the preprocessor command, and the flags which are not only for
+  /// the preprocessor
+  int nbargs = (int) progargvec.size();
+  cppargvec.push_back(progargvec[0]);
+  for (int ix=1; ix<nbargs && progargvec[ix]; ix++)
+    {
+      const char* arg = progargvec[ix];
+      if (!strcmp(arg, "-o"))
+        {
+          ix++;
+          continue;
+        };
+      if (!strcmp(arg, "-c"))
+        {
+          cppargvec.push_back("-E");
+          continue;
+        };
+      /// the dependency outputs are handled by cache_fetch, but
+      /// whether system headers are listed matters
+      if (!strncmp(arg, "-MF", 3) || !strncmp(arg, "-MT", 3) || !strncmp(arg, "-MQ", 3))
+        {
+          if (!arg[3])
+            ix++;
+          continue;
+        };
+      if (!strcmp(arg, "-MD") || !strcmp(arg, "-MMD") || !strcmp(arg, "-MP"))
+        {
+          keymat += arg;
+          keymat += '\x1f';
+          continue;
+        };
+      cppargvec.push_back(arg);
+      if (!strcmp(arg, "-I") || !strcmp(arg, "-D") || !strcmp(arg, "-U")
+          || !strcmp(arg, "-isystem") || !strcmp(arg, "-iquote") || !strcmp(arg, "-include")
+          || !strcmp(arg, "-idirafter"))
+        {
+          if (ix+1 < nbargs && progargvec[ix+1])
+            cppargvec.push_back(progargvec[++ix]);
+          continue;
+        };
+      if (!strncmp(arg, "-I", 2) || !strncmp(arg, "-D", 2) || !strncmp(arg, "-U", 2))
+        continue;
+      char* rp = (arg[0] != '-') ? realpath(arg, nullptr) : nullptr;
+      bool issource = rp && firstpath == rp;
+      free(rp);
+      if (issource)
+        continue;
+      if (!strncmp(arg, "-g", 2) && strcmp(arg, "-g0"))
+        debugging = true;
+      keymat += arg;
+      keymat += '\x1f';
+    };
+  keymat += '\n';
+  /// debug information contains the current directory
+  if (debugging)
+    {
+      char cwdbuf[512];
+      memset (cwdbuf, 0, sizeof(cwdbuf));
+      if (getcwd(cwdbuf, sizeof(cwdbuf)-1))
+        keymat += cwdbuf;
+      keymat += '\n';
+    };
+  snprintf(tupath, sizeof(tupath), "%s/logged-gcc-tu-XXXXXX", getenv("TMPDIR")?:"/tmp");
+  int tufd = mkstemp(tupath);
+  if (tufd < 0)
+    return "";
+  close(tufd);
+  cppargvec.push_back("-o");
+  cppargvec.push_back(tupath);
+  cppargvec.push_back(nullptr);
+  fflush(nullptr);
+  pid_t pid = fork();
+  if (pid == 0)
+    {
+      /// the compilation itself shows the diagnostics
+      int nullfd = open("/dev/null", O_WRONLY);
+      if (nullfd >= 0)
+        dup2(nullfd, STDERR_FILENO);
+      execv(cmdname, (char* const*) (cppargvec.data()));
+      _exit(EX_SOFTWARE);
+    };
+  int wst = -1;
+  if (pid < 0 || waitpid(pid, &wst, 0) != pid || wst != 0)
+    {
+      unlink(tupath);
+      return "";
+    };
+  struct stat tust = {};
+  unsigned char digest[16];
+  std::string key;
+  if (!stat(tupath, &tust) && compute_file_digest(tupath, tust.st_size, digest))
+    {
+      char hexbuf[2*sizeof(digest)+4];
+      for (int ix=0; ix<(int)sizeof(digest); ix++)
+        snprintf(hexbuf+2*ix, 3, "%02x", (unsigned)digest[ix]);
+      keymat += hexbuf;
+      if (digest_buffer(keymat.data(), keymat.size(), digest))
+        {
+          for (int ix=0; ix<(int)sizeof(digest); ix++)
+            snprintf(hexbuf+2*ix, 3, "%02x", (unsigned)digest[ix]);
+          key = hexbuf;
+        }
+    };
+  unlink(tupath);
+  DEBUGLOG("compute_cache_key key=" << key << " keymat=" << keymat);
+  return key;
+} // end compute_cache_key
+
+std::string
+cache_entry_path(const std::string&key, const char*suffix)
+{
+  return std::string(mycachedir) + "/" + key.substr(0,2) + "/" + key + suffix;
+} // end cache_entry_path
+
+/// serve a cached object, and its dependencies into deppath with
+/// the targets of outs, return true on a hit
+bool
+cache_fetch(const std::string&key, const Cache_outputs&outs, const char*deppath)
+{
+  std::string entpath = cache_entry_path(key, ".entry");
+  std::string content;
+  unsigned long objsize = 0, depsize = 0;
+  int hdrlen = 0;
+  if (!read_whole_file(entpath.c_str(), content)
+      || sscanf(content.c_str(), "logged-gcc-cache-2 %lu %lu\n%n", &objsize, &depsize, &hdrlen) < 2
+      || hdrlen <= 0 || (size_t) hdrlen + objsize + depsize != content.size())
+    return false;
+  if (deppath && deppath[0])
+    {
+      if (depsize == 0)
+        return false;
+      std::string dep = (outs.co_targets.empty() ? quote_make_target(outs.co_objpath.c_str()) : outs.co_targets)
+                        + ":" + content.substr(hdrlen + objsize);
+      if (!write_file_atomically(deppath, dep.data(), dep.size()))
+        return false;
+    };
+  if (!write_file_atomically(outs.co_objpath, content.data() + hdrlen, objsize))
+    return false;
+  /// the modification time orders the least recently used eviction
+  utimensat(AT_FDCWD, entpath.c_str(), nullptr, 0);
+  return true;
+} // end cache_fetch
+
+/// evict the least recently used entries of a cache subdirectory
+void
+cache_cleanup_subdir(const std::string&subdir)
+{
+  struct Cache_file
+  {
+    std::string cf_name;
+    struct timespec cf_mtim;
+    off_t cf_size;
+  };
+  std::vector<Cache_file> filevec;
+  off_t totsize = 0;
+  const off_t maxsize = (off_t) mycachemaxmb * 1024 * 1024 / 256;
+  DIR* dir = opendir(subdir.c_str());
+  if (!dir)
+    return;
+  for (struct dirent* de = readdir(dir); de; de = readdir(dir))
+    {
+      struct stat st = {};
+      /// skip the temporary files of concurrent stores
+      if (de->d_name[0] == '.' || strstr(de->d_name, ".tmp")
+          || fstatat(dirfd(dir), de->d_name, &st, 0))
+        continue;
+      filevec.push_back(Cache_file {de->d_name, st.st_mtim, st.st_size});
+      totsize += st.st_size;
+    };
+  if (totsize > maxsize)
+    {
+      std::sort(filevec.begin(), filevec.end(), [](const Cache_file&l, const Cache_file&r)
+      {
+        return l.cf_mtim.tv_sec < r.cf_mtim.tv_sec
+               || (l.cf_mtim.tv_sec == r.cf_mtim.tv_sec && l.cf_mtim.tv_nsec < r.cf_mtim.tv_nsec);
+      });
+      int nbevicted = 0;
+      for (const Cache_file& cf : filevec)
+        {
+          if (totsize <= maxsize * 9 / 10)
+            break;
+          if (!unlinkat(dirfd(dir), cf.cf_name.c_str(), 0))
+            {
+              totsize -= cf.cf_size;
+              nbevicted++;
+            }
+        };
+      syslog(LOG_INFO, "compilation cache %s evicted %d entries", subdir.c_str(), nbevicted);
+    };
+  closedir(dir);
+} // end cache_cleanup_subdir
+
+/// store a compiled object and its dependencies, without their
+/// targets, as one cache entry
+void
+cache_store(const std::string&key, const Cache_outputs&outs, const char*deppath)
+{
+  std::string subdir = std::string(mycachedir) + "/" + key.substr(0,2);
+  std::string obj, dep;
+  if (mkdir(mycachedir, 0755) && errno != EEXIST)
+    return;
+  if (mkdir(subdir.c_str(), 0755) && errno != EEXIST)
+    return;
+  if (!read_whole_file(outs.co_objpath.c_str(), obj))
+    {
+      syslog(LOG_WARNING, "cannot read %s for compilation cache %s - %m", outs.co_objpath.c_str(), mycachedir);
+      return;
+    };
+  if (deppath && deppath[0] && read_whole_file(deppath, dep))
+    {
+      /// drop the targets, up to the first unescaped colon
+      size_t pos = 0;
+      while (pos < dep.size() && dep[pos] != ':')
+        pos += (dep[pos] == '\\') ? 2 : 1;
+      dep = (pos < dep.size()) ? dep.substr(pos+1) : std::string();
+    };
+  std::string content = "logged-gcc-cache-2 " + std::to_string(obj.size())
+                        + " " + std::to_string(dep.size()) + "\n";
+  content += obj;
+  content += dep;
+  if (!write_file_atomically(cache_entry_path(key, ".entry"), content.data(), content.size()))
+    syslog(LOG_WARNING, "cannot store %s in compilation cache %s - %m", outs.co_objpath.c_str(), mycachedir);
+  cache_cleanup_subdir(subdir);
+} // end cache_store
+
+/// The resource samples of one compilation, with --sample-ms=.  The
+/// compiler runs in its own transient cgroup v2 when we may create
+/// one, so memory.current and cpu.stat cover all its processes;
+/// otherwise its process tree is walked in /proc.  When the series
+/// reaches rser_maxsamples it is halved, doubling its interval.
+struct Resource_series
+{
+  static constexpr int rser_maxsamples = 256;
+  std::string rser_cgroup;	// the transient cgroup, or empty
+  int rser_intervalms;		// between kept samples
+  int rser_stride;		// sampling ticks per kept sample
+  long rser_ticks;
+  std::vector<std::int64_t> rser_memkb;	// resident kilobytes
+  std::vector<std::int64_t> rser_cpuusec;	// cumulated CPU microseconds
+  std::int64_t rser_peakkb;
+  int rser_perffd[3];		// instructions, cycles, cache misses
+  std::int64_t rser_counters[3];	// their final values, or -1
+  Resource_series() : rser_intervalms(mysamplems), rser_stride(1), rser_ticks(0), rser_peakkb(0)
+  {
+    for (int cix = 0; cix < 3; cix++)
+      {
+        rser_perffd[cix] = -1;
+        rser_counters[cix] = -1;
+      }
+  };
+};				// end Resource_series
+
+/// the cgroup v2 directory under which compilations are placed, by
+/// default our own cgroup in the cgroup2 mount
+std::string
+resource_cgroup_parent(void)
+{
+  if (mycgroupdir)
+    return mycgroupdir;
+  std::string mountdir, owncg;
+  char linbuf[1024];
+  FILE* fil = fopen("/proc/mounts", "r");
+  while (fil && fgets(linbuf, sizeof(linbuf), fil))
+    {
+      char dev[256], mnt[512], typ[64];
+      if (sscanf(linbuf, "%255s %511s %63s", dev, mnt, typ) == 3 && !strcmp(typ, "cgroup2"))
+        mountdir = mnt;
+    };
+  if (fil)
+    fclose(fil);
+  fil = fopen("/proc/self/cgroup", "r");
+  while (fil && fgets(linbuf, sizeof(linbuf), fil))
+    {
+      if (!strncmp(linbuf, "0::", 3))
+        {
+          owncg = linbuf+3;
+          while (!owncg.empty() && owncg.back() == '\n')
+            owncg.pop_back();
+        }
+    };
+  if (fil)
+    fclose(fil);
+  if (mountdir.empty())
+    return mountdir;
+  if (owncg == "/")
+    owncg.clear();
+  return mountdir + owncg;
+} // end resource_cgroup_parent
+
+/// read a single number following some key in a small file, like
+/// usage_usec in cpu.stat, or its first number without key
+static std::int64_t
+read_keyed_number(const std::string&path, const char*key)
+{
+  std::int64_t val = -1;
+  char linbuf[256];
+  FILE* fil = fopen(path.c_str(), "r");
+  if (!fil)
+    return -1;
+  while (fgets(linbuf, sizeof(linbuf), fil))
+    {
+      size_t keylen = key ? strlen(key) : 0;
+      if (key && (strncmp(linbuf, key, keylen) || linbuf[keylen] != ' '))
+        continue;
+      val = atoll(linbuf + keylen);
+      break;
+    };
+  fclose(fil);
+  return val;
+} // end read_keyed_number
+
+/// add the resident kilobytes and CPU microseconds (including reaped
+/// children) of a process, and of its descendants if recursive
+static void
+add_process_usage(pid_t pid, bool recursive, std::int64_t&memkb, std::int64_t&cpuusec)
+{
+  static long pagekb = sysconf(_SC_PAGESIZE) / 1024;
+  static long clktck = sysconf(_SC_CLK_TCK);
+  char pathbuf[64];
+  char buf[1024];
+  snprintf(pathbuf, sizeof(pathbuf), "/proc/%d/statm", (int)pid);
+  FILE* fil = fopen(pathbuf, "r");
+  long size = 0, resident = 0;
+  if (!fil)
+    return;
+  if (fscanf(fil, "%ld %ld", &size, &resident) == 2)
+    memkb += resident * pagekb;
+  fclose(fil);
+  snprintf(pathbuf, sizeof(pathbuf), "/proc/%d/stat", (int)pid);
+  int fd = open(pathbuf, O_RDONLY|O_CLOEXEC);
+  ssize_t len = (fd >= 0) ? read(fd, buf, sizeof(buf)-1) : -1;
+  if (fd >= 0)
+    close(fd);
+  const char* rpar = (len > 0) ? (buf[len] = (char)0, strrchr(buf, ')')) : nullptr;
+  unsigned long utime = 0, stime = 0;
+  long cutime = 0, cstime = 0;
+  /// after the command come the state and ten fields before utime
+  if (rpar && sscanf(rpar+1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %ld %ld",
+                     &utime, &stime, &cutime, &cstime) == 4)
+    cpuusec += (std::int64_t) (utime + stime + cutime + cstime) * 1000000 / clktck;
+  if (!recursive)
+    return;
+  snprintf(pathbuf, sizeof(pathbuf), "/proc/%d/task/%d/children", (int)pid, (int)pid);
+  fil = fopen(pathbuf, "r");
+  int childpid = 0;
+  while (fil && fscanf(fil, "%d", &childpid) == 1)
+    add_process_usage((pid_t)childpid, true, memkb, cpuusec);
+  if (fil)
+    fclose(fil);
+} // end add_process_usage
+
+/// open a hardware counter of a process, enabled at its next exec and
+/// inherited by its children, like cc1 or as started by gcc
+static int
+open_perf_counter(pid_t pid, std::uint64_t config)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.enable_on_exec = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int) syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+} // end open_perf_counter
+
+/// called by the father while the forked child waits before its exec:
+/// move it to a transient cgroup and attach the counters
+void
+start_resource_sampling(Resource_series&series, pid_t pid)
+{
+  static int nbcgroup;
+  std::string parent = resource_cgroup_parent();
+  if (!parent.empty())
+    {
+      char namebuf[64];
+      snprintf(namebuf, sizeof(namebuf), "/logged-gcc-%d-%d", (int)getpid(), nbcgroup++);
+      std::string cgdir = parent + namebuf;
+      if (mkdir(cgdir.c_str(), 0755))
+        syslog(LOG_WARNING, "cannot create cgroup %s - %m", cgdir.c_str());
+      else
+        {
+          FILE* fil = fopen((cgdir + "/cgroup.procs").c_str(), "w");
+          bool moved = fil && fprintf(fil, "%d\n", (int)pid) > 0;
+          if (fil && fclose(fil))
+            moved = false;
+          if (moved)
+            series.rser_cgroup = cgdir;
+          else
+            {
+              syslog(LOG_WARNING, "cannot move pid %d into cgroup %s - %m", (int)pid, cgdir.c_str());
+              rmdir(cgdir.c_str());
             }
         }
+    };
+  if (myperfcounters)
+    {
+      static const std::uint64_t configs[3] =
+      {
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES
+      };
+      for (int cix = 0; cix < 3; cix++)
+        {
+          series.rser_perffd[cix] = open_perf_counter(pid, configs[cix]);
+          if (series.rser_perffd[cix] < 0)
+            syslog(LOG_WARNING, "perf_event_open of counter #%d for pid %d failed - %m", cix, (int)pid);
+        }
+    };
+  DEBUGLOG("start_resource_sampling pid " << (int)pid << " cgroup " << series.rser_cgroup);
+} // end start_resource_sampling
+
+/// take one sample of the running compilation
+void
+sample_resources(Resource_series&series, pid_t pid)
+{
+  std::int64_t memkb = 0, cpuusec = 0;
+  if (!series.rser_cgroup.empty())
+    {
+      std::int64_t membytes = read_keyed_number(series.rser_cgroup + "/memory.current", nullptr);
+      cpuusec = read_keyed_number(series.rser_cgroup + "/cpu.stat", "usage_usec");
+      if (membytes >= 0)
+        memkb = membytes / 1024;
+      else
+        {
+          /// without the memory controller, sum the group processes
+          FILE* fil = fopen((series.rser_cgroup + "/cgroup.procs").c_str(), "r");
+          int cgpid = 0;
+          std::int64_t unused = 0;
+          while (fil && fscanf(fil, "%d", &cgpid) == 1)
+            add_process_usage((pid_t)cgpid, false, memkb, unused);
+          if (fil)
+            fclose(fil);
+        }
     }
-  DEBUGLOG("stat_input_files ending firstserial=" << firstserial);
-  return firstserial;
-} // end stat_input_files
+  else
+    add_process_usage(pid, true, memkb, cpuusec);
+  if (memkb > series.rser_peakkb)
+    series.rser_peakkb = memkb;
+  if (series.rser_ticks++ % series.rser_stride)
+    return;
+  series.rser_memkb.push_back(memkb);
+  series.rser_cpuusec.push_back(cpuusec);
+  if ((int) series.rser_memkb.size() >= Resource_series::rser_maxsamples)
+    {
+      for (size_t ix = 0; 2*ix < series.rser_memkb.size(); ix++)
+        {
+          series.rser_memkb[ix] = series.rser_memkb[2*ix];
+          series.rser_cpuusec[ix] = series.rser_cpuusec[2*ix];
+        };
+      series.rser_memkb.resize((series.rser_memkb.size()+1)/2);
+      series.rser_cpuusec.resize(series.rser_memkb.size());
+      series.rser_stride *= 2;
+      series.rser_intervalms *= 2;
+    }
+} // end sample_resources
 
+/// after the compilation exited, read the counters and remove its cgroup
+void
+finish_resource_sampling(Resource_series&series)
+{
+  for (int cix = 0; cix < 3; cix++)
+    {
+      std::uint64_t count = 0;
+      if (series.rser_perffd[cix] < 0)
+        continue;
+      if (read(series.rser_perffd[cix], &count, sizeof(count)) == (ssize_t) sizeof(count))
+        series.rser_counters[cix] = (std::int64_t) count;
+      close(series.rser_perffd[cix]);
+      series.rser_perffd[cix] = -1;
+    };
+  if (!series.rser_cgroup.empty() && rmdir(series.rser_cgroup.c_str()))
+    syslog(LOG_WARNING, "cannot remove cgroup %s - %m", series.rser_cgroup.c_str());
+} // end finish_resource_sampling
 
+/// register the resource series of a compilation
+void
+register_resources(const char*firstpath, time_t startime, const Resource_series&series)
+{
+  Logged_record rec(Logged_record::LREC_RESOURCES);
+  rec.put_string(rec.lrec_path, sizeof(rec.lrec_path), firstpath);
+  rec.lrec_time = startime;
+  rec.lrec_intervalms = series.rser_intervalms;
+  rec.lrec_maxrss = series.rser_peakkb;
+  for (int cix = 0; cix < 3; cix++)
+    rec.lrec_counters[cix] = series.rser_counters[cix];
+  std::string blob = encode_resource_series(series.rser_memkb, series.rser_cpuusec,
+                     sizeof(rec.lrec_command)-1);
+  memcpy(rec.lrec_command, blob.data(), blob.size());
+  rec.lrec_size = (std::int64_t) blob.size();
+  mylogrecords.push_back(rec);
+  DEBUGLOG("register_resources " << firstpath << " with " << series.rser_memkb.size()
+           << " samples, peak " << series.rser_peakkb << " Kbytes");
+} // end register_resources
 
 void
 fork_log_child_process(const char*cmdname, std::string progcmd, double startelapsedtime, std::vector<const char*>progargvec, int lineno=0)
@@ -533,15 +2449,77 @@ fork_log_child_process(const char*cmdname, std::string progcmd, double startelap
   syslog(LOG_INFO,
          "(L¤%d) starting compilation %s of command %s with %d prog.arg", __LINE__,
          cmdname, progcmd.c_str(), (int)(progargvec.size()));
-  char firstmd5[MD5_DIGEST_LENGTH+4];
+  char firstmd5[2*MD5_DIGEST_LENGTH+4];
   memset(firstmd5, 0, sizeof(firstmd5));
-  std::int64_t firstserial = stat_input_files(progargvec, firstmd5);
+  std::string firstpath;
+  int nbsources = 0;
+  std::int64_t firstserial = stat_input_files(progargvec, firstmd5, firstpath, nbsources);
   time_t startime = time(nullptr);
+  /// the compilation cache key, computed before adding -MD
+  Cache_outputs cacheouts;
+  std::string cachekey;
+  if (can_use_cache(progargvec, nbsources, firstpath, cacheouts))
+    cachekey = compute_cache_key(cmdname, progargvec, firstpath);
+  /// the dependencies of the compiled source go to a temporary file
+  char deppath[128];
+  memset (deppath, 0, sizeof(deppath));
+  if (firstserial > 0 && can_capture_dependencies(progargvec, nbsources))
+    {
+      snprintf(deppath, sizeof(deppath), "%s/logged-gcc-deps-XXXXXX",
+               getenv("TMPDIR")?:"/tmp");
+      int depfd = mkstemp(deppath);
+      if (depfd < 0)
+        {
+          syslog(LOG_WARNING, "cannot create dependency file %s - %m", deppath);
+          deppath[0] = (char)0;
+        }
+      else
+        {
+          close(depfd);
+          assert (progargvec.back() == nullptr);
+          progargvec.pop_back();
+          progargvec.push_back("-MD");
+          progargvec.push_back("-MF");
+          progargvec.push_back(deppath);
+          progargvec.push_back(nullptr);
+        }
+    };
+  /// the dependencies kept with a cached object: those asked by -MD or
+  /// -MMD, or else those captured by --deps
+  const char* cachedeps = !cacheouts.co_deppath.empty() ? cacheouts.co_deppath.c_str() : deppath;
+  if (!cachekey.empty() && cache_fetch(cachekey, cacheouts, cachedeps))
+    {
+      /// a cache hit costs the preprocessing and the copy
+      double endelapsedtime= get_float_time(CLOCK_MONOTONIC);
+      struct rusage rus = {};
+      getrusage(RUSAGE_CHILDREN, &rus);
+      double usertime = 1.0*rus.ru_utime.tv_sec + 1.0e-6*rus.ru_utime.tv_usec;
+      double systime = 1.0*rus.ru_stime.tv_sec + 1.0e-6*rus.ru_stime.tv_usec;
+      syslog(LOG_INFO, "%s served compilation %s from cache %s key %s in %.4g elapsed seconds",
+             cmdname, progcmd.c_str(), mycachedir, cachekey.c_str(), endelapsedtime-startelapsedtime);
+      if (firstserial>0)
+        register_compilation (firstpath.c_str(), firstmd5, progcmd.c_str(), progargvec, startime, endelapsedtime-startelapsedtime,
+                              usertime, systime, rus.ru_maxrss, rus.ru_minflt + rus.ru_majflt,
+                              2, cachekey);
+      if (firstserial>0 && deppath[0])
+        register_includes (firstpath.c_str(), startime, parse_depfile(deppath, firstpath));
+      if (deppath[0])
+        unlink(deppath);
+      return;
+    };
   DEBUGLOG("fork_log_child_process startime=" << (long) startime << " before fork");
   std::clog << std::flush;
   std::cerr << std::flush;
   std::cout << std::flush;
   fflush(nullptr);
+  /// when sampling, the child waits on this pipe until it is set up
+  Resource_series series;
+  int syncpipe[2] = {-1, -1};
+  if (mysamplems > 0 && pipe2(syncpipe, O_CLOEXEC))
+    {
+      syslog(LOG_WARNING, "pipe for resource sampling failed - %m");
+      syncpipe[0] = syncpipe[1] = -1;
+    };
   auto pid = fork();
   if (pid<0)
     {
@@ -551,6 +2529,13 @@ fork_log_child_process(const char*cmdname, std::string progcmd, double startelap
   else if (pid==0)
     {
       // child process
+      if (syncpipe[0] >= 0)
+        {
+          char ch = 0;
+          close(syncpipe[1]);
+          while (read(syncpipe[0], &ch, 1) < 0 && errno == EINTR)
+            continue;
+        };
       execv(cmdname, (char* const*) (progargvec.data()));
       perror(cmdname);
       syslog(LOG_ALERT, "exec of %s failed for %s - %m", cmdname, progcmd.c_str());
@@ -560,15 +2545,46 @@ fork_log_child_process(const char*cmdname, std::string progcmd, double startelap
     {
       DEBUGLOG("fork_log_child_process from lineno:" << lineno << " cmdname=" << cmdname << " pid:" << (int)pid);
       fflush(nullptr);
+      bool sampling = syncpipe[0] >= 0;
+      if (sampling)
+        {
+          close(syncpipe[0]);
+          start_resource_sampling(series, pid);
+          close(syncpipe[1]);
+        };
       struct rusage rus = {};
       int wst = 0;
       memset (&rus, 0, sizeof(rus));
-      /// the below loop is likely to run once
+      /// when sampling, poll the pidfd of the child between samples,
+      /// so its exit is noticed at once and its elapsed time exact
+      int pidfd = sampling ? (int) syscall(SYS_pidfd_open, pid, 0) : -1;
+      double nextsample = 0.0;
+      /// the below loop is likely to run once, unless sampling
       for(;;)
         {
-          auto wpid = wait4(pid, &wst, WUNTRACED, &rus);
+          auto wpid = wait4(pid, &wst, WUNTRACED | (sampling ? WNOHANG : 0), &rus);
           if (wpid == pid)
             break;
+          if (wpid == 0)
+            {
+              double now = get_float_time(CLOCK_MONOTONIC);
+              if (now >= nextsample)
+                {
+                  sample_resources(series, pid);
+                  nextsample = now + 1.0e-3 * mysamplems;
+                };
+              int waitms = (int) ceil(1.0e3 * (nextsample - now));
+              if (waitms < 1)
+                waitms = 1;
+              if (pidfd >= 0)
+                {
+                  struct pollfd pfd = { pidfd, POLLIN, 0 };
+                  poll(&pfd, 1, waitms);
+                }
+              else		/* without pidfd_open, before Linux 5.3 */
+                poll(nullptr, 0, 1);
+              continue;
+            };
           if (wpid < 0)
             {
               syslog(LOG_ALERT,
@@ -579,10 +2595,22 @@ fork_log_child_process(const char*cmdname, std::string progcmd, double startelap
           usleep(10000);
         };
       double endelapsedtime= get_float_time(CLOCK_MONOTONIC);
+      if (pidfd >= 0)
+        close(pidfd);
       double usertime = 1.0*rus.ru_utime.tv_sec + 1.0e-6*rus.ru_utime.tv_usec;
       double systime = 1.0*rus.ru_stime.tv_sec + 1.0e-6*rus.ru_stime.tv_usec;
       long maxrss = rus.ru_maxrss; //kilobytes
       long pageflt = rus.ru_minflt + rus.ru_majflt;
+      if (sampling)
+        {
+          finish_resource_sampling(series);
+          if (series.rser_peakkb < maxrss)
+            series.rser_peakkb = maxrss;
+          syslog(LOG_INFO, "%s sampled %d times every %d ms, peak %ld Kbytes, %lld instructions, %lld cycles, %lld cache misses",
+                 cmdname, (int) series.rser_memkb.size(), series.rser_intervalms, (long) series.rser_peakkb,
+                 (long long) series.rser_counters[0], (long long) series.rser_counters[1],
+                 (long long) series.rser_counters[2]);
+        };
       DEBUGLOG("fork_log_child_process wst=" << wst
                << " endelapsedtime=" << endelapsedtime
                << " usertime=" << usertime
@@ -597,9 +2625,18 @@ fork_log_child_process(const char*cmdname, std::string progcmd, double startelap
                  cmdname, progcmd.c_str(), endelapsedtime-startelapsedtime,
                  usertime, systime, maxrss, pageflt,
                  (int)pid, lineno);
-          if (mysqlitedb && firstserial>0)
-            register_sqlite_compilation (firstserial, firstmd5, progcmd.c_str(), startime, endelapsedtime-startelapsedtime,
-                                         usertime, systime, maxrss, pageflt);
+          if (firstserial>0)
+            register_compilation (firstpath.c_str(), firstmd5, progcmd.c_str(), progargvec, startime, endelapsedtime-startelapsedtime,
+                                  usertime, systime, maxrss, pageflt,
+                                  cachekey.empty()?0:1, cachekey);
+          if (firstserial>0 && sampling)
+            register_resources (firstpath.c_str(), startime, series);
+          if (!cachekey.empty())
+            cache_store(cachekey, cacheouts, cachedeps);
+          if (firstserial>0 && deppath[0])
+            register_includes (firstpath.c_str(), startime, parse_depfile(deppath, firstpath));
+          if (deppath[0])
+            unlink(deppath);
           return;
         }
       /// GCC compilation failed somehow.....
@@ -637,6 +2674,8 @@ fork_log_child_process(const char*cmdname, std::string progcmd, double startelap
           exitcode = 127;
         }
     }
+  if (deppath[0])
+    unlink(deppath);
   DEBUGLOG("fork_log_child_process ending cmdname=" << cmdname << " from lineno:" << lineno);
 } // end fork_log_child_process
 
@@ -884,6 +2923,262 @@ run_sqlite_request(const char*sqlreq, int fromline)
     }
 } // end of run_sqlite_request
 
+/// with --header-costs=N, show the N included files whose
+/// compilations took the most CPU seconds, i.e. those whose change
+/// costs the most recompilation
+void
+report_header_costs(int nbtop)
+{
+  sqlite3_stmt* stmt = nullptr;
+  struct Header_cost
+  {
+    double hc_cpu;
+    long hc_count;
+  };
+  std::unordered_map<std::int64_t,Header_cost> costmap;
+  long nbcompil = 0;
+  double startime = get_float_time(CLOCK_MONOTONIC);
+  if (sqlite3_prepare_v2(mysqlitedb,
+                         "SELECT i.incl_ids, c.compil_usercpu_time + c.compil_syscpu_time"
+                         " FROM tb_compilation_includes i"
+                         " JOIN tb_successful_compilation c ON c.compil_serial = i.incl_compil_id",
+                         -1, &stmt, nullptr) != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "report_header_costs failed to prepare - %s", sqlite3_errmsg(mysqlitedb));
+      exit(EXIT_FAILURE);
+    };
+  std::vector<std::int64_t> idvec;
+  while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+      idvec.clear();
+      decode_include_ids(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0), idvec);
+      double cpu = sqlite3_column_double(stmt, 1);
+      for (std::int64_t id : idvec)
+        {
+          Header_cost& hc = costmap[id];
+          hc.hc_cpu += cpu;
+          hc.hc_count++;
+        }
+      nbcompil++;
+    };
+  sqlite3_finalize(stmt);
+  std::vector<std::pair<std::int64_t,Header_cost>> costvec(costmap.begin(), costmap.end());
+  std::sort(costvec.begin(), costvec.end(),
+            [](const std::pair<std::int64_t,Header_cost>&l, const std::pair<std::int64_t,Header_cost>&r)
+  {
+    return l.second.hc_cpu > r.second.hc_cpu;
+  });
+  if ((int) costvec.size() > nbtop)
+    costvec.resize(nbtop);
+  if (sqlite3_prepare_v2(mysqlitedb, "SELECT incp_path FROM tb_includepath WHERE incp_id = ?1",
+                         -1, &stmt, nullptr) != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "report_header_costs failed to prepare path query - %s", sqlite3_errmsg(mysqlitedb));
+      exit(EXIT_FAILURE);
+    };
+  printf("#- top %d included files by CPU seconds of their %ld compilations\n", nbtop, nbcompil);
+  printf("#|cpu_seconds\tcompilations\tpath\n");
+  for (auto& it : costvec)
+    {
+      sqlite3_bind_int64(stmt, 1, it.first);
+      const char* path = (sqlite3_step(stmt) == SQLITE_ROW)
+                         ? (const char*) sqlite3_column_text(stmt, 0) : "?";
+      printf("%.3f\t%ld\t%s\n", it.second.hc_cpu, it.second.hc_count, path);
+      sqlite3_reset(stmt);
+    };
+  sqlite3_finalize(stmt);
+  printf("#- %d rows in %.3f seconds\n\n", (int) costvec.size(),
+         get_float_time(CLOCK_MONOTONIC) - startime);
+  fflush(stdout);
+} // end report_header_costs
+
+/// with --resource-report=N, show the N sampled compilations using
+/// the most memory, with the time of that peak, and the N executing
+/// the fewest instructions per cycle
+void
+report_resource_usage(int nbtop)
+{
+  sqlite3_stmt* stmt = nullptr;
+  double startime = get_float_time(CLOCK_MONOTONIC);
+  const char* selcolumns =
+    "SELECT r.rser_peak_kb, r.rser_interval_ms, r.rser_series, c.compil_elapsed_time,"
+    " c.compil_usercpu_time + c.compil_syscpu_time,"
+    " CAST(r.rser_instructions AS REAL) / r.rser_cycles,"
+    " 1000.0 * r.rser_cache_misses / r.rser_instructions, p.srcp_realpath"
+    " FROM tb_resource_series r"
+    " JOIN tb_successful_compilation c ON c.compil_serial = r.rser_compil_id"
+    " JOIN tb_sourcepath p ON p.srcp_serial = c.compil_firstsrc_id";
+  struct
+  {
+    const char* title;
+    const char* tail;
+  } reptab[] =
+  {
+    { "highest memory peak", " ORDER BY r.rser_peak_kb DESC LIMIT ?1" },
+    { "lowest instructions per cycle", " WHERE r.rser_cycles > 0 ORDER BY 6 ASC LIMIT ?1" },
+  };
+  for (auto& rep: reptab)
+    {
+      std::string sql = std::string(selcolumns) + rep.tail;
+      int nbrows = 0;
+      if (sqlite3_prepare_v2(mysqlitedb, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        {
+          syslog(LOG_ALERT, "report_resource_usage failed to prepare - %s", sqlite3_errmsg(mysqlitedb));
+          exit(EXIT_FAILURE);
+        };
+      sqlite3_bind_int(stmt, 1, nbtop);
+      printf("#- top %d sampled compilations by %s\n", nbtop, rep.title);
+      printf("#|peak_MB\tpeak_at_s\telapsed_s\tcpu_s\tIPC\tmiss_per_Kinstr\tpath\n");
+      std::vector<std::int64_t> memvec, cpuvec;
+      while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+          memvec.clear();
+          cpuvec.clear();
+          decode_resource_series(sqlite3_column_blob(stmt, 2), sqlite3_column_bytes(stmt, 2), memvec, cpuvec);
+          size_t peakix = std::max_element(memvec.begin(), memvec.end()) - memvec.begin();
+          printf("%.1f\t%.2f\t%.3f\t%.3f\t", sqlite3_column_int64(stmt, 0) / 1024.0,
+                 1.0e-3 * sqlite3_column_int(stmt, 1) * peakix,
+                 sqlite3_column_double(stmt, 3), sqlite3_column_double(stmt, 4));
+          if (sqlite3_column_type(stmt, 5) == SQLITE_NULL)
+            printf("-\t");
+          else
+            printf("%.3f\t", sqlite3_column_double(stmt, 5));
+          if (sqlite3_column_type(stmt, 6) == SQLITE_NULL)
+            printf("-\t");
+          else
+            printf("%.2f\t", sqlite3_column_double(stmt, 6));
+          printf("%s\n", sqlite3_column_text(stmt, 7));
+          nbrows++;
+        };
+      sqlite3_finalize(stmt);
+      printf("#- %d rows in %.3f seconds\n\n", nbrows, get_float_time(CLOCK_MONOTONIC) - startime);
+    };
+  fflush(stdout);
+} // end report_resource_usage
+
+/// The canned reports of --report=<name>, answered from the rollup
+/// tables; ?1 is the number of rows and ?2 the current day.
+struct Canned_report
+{
+  const char* rep_name;
+  const char* rep_title;
+  const char* rep_sql;
+};
+
+static const Canned_report canned_reports[] =
+{
+  {
+    "slowest", "source files by mean elapsed seconds",
+    "SELECT r.rlsp_elapsed / r.rlsp_count AS mean_elapsed, r.rlsp_max_elapsed AS max_elapsed,"
+    " r.rlsp_count AS compilations, r.rlsp_cpu AS cpu_seconds, p.srcp_realpath AS path"
+    " FROM tb_rollup_source r JOIN tb_sourcepath p ON p.srcp_serial = r.rlsp_path_serial"
+    " ORDER BY r.rlsp_elapsed / r.rlsp_count DESC LIMIT ?1"
+  },
+  {
+    "regressions", "source files whose mean CPU seconds grew since the week before",
+    "SELECT newcpu / oldcpu AS ratio, newcpu AS mean_cpu_this_week, oldcpu AS mean_cpu_last_week,"
+    " nbnew AS compilations_this_week, p.srcp_realpath AS path FROM"
+    " (SELECT rlday_path_serial AS serial,"
+    "   SUM(CASE WHEN rlday_day > ?2 - 7 THEN rlday_count END) AS nbnew,"
+    "   SUM(CASE WHEN rlday_day > ?2 - 7 THEN rlday_cpu END)"
+    "    / SUM(CASE WHEN rlday_day > ?2 - 7 THEN rlday_count END) AS newcpu,"
+    "   SUM(CASE WHEN rlday_day <= ?2 - 7 THEN rlday_cpu END)"
+    "    / SUM(CASE WHEN rlday_day <= ?2 - 7 THEN rlday_count END) AS oldcpu"
+    "  FROM tb_rollup_day WHERE rlday_day > ?2 - 14 GROUP BY rlday_path_serial)"
+    " JOIN tb_sourcepath p ON p.srcp_serial = serial"
+    " WHERE oldcpu > 0 AND newcpu > oldcpu ORDER BY newcpu / oldcpu DESC LIMIT ?1"
+  },
+  {
+    "directories", "directories by CPU seconds",
+    "SELECT SUM(r.rlsp_cpu) AS cpu_seconds, SUM(r.rlsp_count) AS compilations,"
+    " COUNT(*) AS sources, rtrim(p.srcp_realpath, replace(p.srcp_realpath, '/', '')) AS directory"
+    " FROM tb_rollup_source r JOIN tb_sourcepath p ON p.srcp_serial = r.rlsp_path_serial"
+    " GROUP BY directory ORDER BY cpu_seconds DESC LIMIT ?1"
+  },
+  {
+    "compilers", "compilers by CPU seconds",
+    "SELECT rlcc_cpu AS cpu_seconds, rlcc_count AS compilations, rlcc_elapsed / rlcc_count AS mean_elapsed,"
+    " rlcc_compiler AS compiler FROM tb_rollup_compiler ORDER BY rlcc_cpu DESC LIMIT ?1"
+  },
+  {
+    "flags", "flag sets by CPU seconds",
+    "SELECT rlfl_cpu AS cpu_seconds, rlfl_count AS compilations, rlfl_elapsed / rlfl_count AS mean_elapsed,"
+    " rlfl_flags AS flags FROM tb_rollup_flags ORDER BY rlfl_cpu DESC LIMIT ?1"
+  },
+  {
+    "days", "last days",
+    "SELECT date(rlday_day * 86400, 'unixepoch') AS day, SUM(rlday_count) AS compilations,"
+    " SUM(rlday_elapsed) AS elapsed_seconds, SUM(rlday_cpu) AS cpu_seconds"
+    " FROM tb_rollup_day WHERE rlday_day > ?2 - ?1 GROUP BY rlday_day ORDER BY rlday_day DESC"
+  },
+};
+
+/// run the canned report of that name, or rebuild the rollups
+void
+run_canned_report(const char*name, int nbtop)
+{
+  sqlite3_stmt* stmt = nullptr;
+  double startime = get_float_time(CLOCK_MONOTONIC);
+  const Canned_report* report = nullptr;
+  if (!strcmp(name, "rebuild"))
+    {
+      rebuild_rollups();
+      return;
+    };
+  for (const Canned_report& rep: canned_reports)
+    if (!strcmp(name, rep.rep_name))
+      report = &rep;
+  if (!report)
+    {
+      std::clog << myprogname << " --report=<name> accepts:";
+      for (const Canned_report& rep: canned_reports)
+        std::clog << " " << rep.rep_name;
+      std::clog << " rebuild" << std::endl;
+      exit(strcmp(name, "help") ? EXIT_FAILURE : EXIT_SUCCESS);
+    };
+  if (sqlite3_prepare_v2(mysqlitedb, report->rep_sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "run_canned_report %s failed to prepare - %s", name, sqlite3_errmsg(mysqlitedb));
+      exit(EXIT_FAILURE);
+    };
+  sqlite3_bind_int(stmt, 1, nbtop);
+  sqlite3_bind_int64(stmt, 2, (std::int64_t) time(nullptr) / 86400);
+  printf("#- top %d %s\n#|", nbtop, report->rep_title);
+  int nbcol = sqlite3_column_count(stmt);
+  for (int cix=0; cix<nbcol; cix++)
+    printf("%s%s", cix ? "\t" : "", sqlite3_column_name(stmt, cix));
+  putchar('\n');
+  int nbrows = 0;
+  while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+      for (int cix=0; cix<nbcol; cix++)
+        {
+          if (cix>0)
+            putchar('\t');
+          switch (sqlite3_column_type(stmt, cix))
+            {
+            case SQLITE_INTEGER:
+              printf("%lld", (long long) sqlite3_column_int64(stmt, cix));
+              break;
+            case SQLITE_FLOAT:
+              printf("%.3f", sqlite3_column_double(stmt, cix));
+              break;
+            case SQLITE_NULL:
+              putchar('-');
+              break;
+            default:
+              fputs((const char*) sqlite3_column_text(stmt, cix), stdout);
+              break;
+            }
+        };
+      putchar('\n');
+      nbrows++;
+    };
+  sqlite3_finalize(stmt);
+  printf("#- %d rows in %.3f seconds\n\n", nbrows, get_float_time(CLOCK_MONOTONIC) - startime);
+  fflush(stdout);
+} // end run_canned_report
+
 void
 create_sqlite_database(void)
 {
@@ -991,6 +3286,130 @@ END TRANSACTION;
   DEBUGLOG("create_sqlite_database initialized database " << mysqlitepath);
 } // end create_sqlite_database
 
+/// true if the database has that table, read without any write lock
+bool
+sqlite_has_table(const char*name)
+{
+  bool found = false;
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(mysqlitedb, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?1",
+                         -1, &stmt, nullptr) == SQLITE_OK)
+    {
+      sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+      found = sqlite3_step(stmt) == SQLITE_ROW;
+      sqlite3_finalize(stmt);
+    };
+  return found;
+} // end sqlite_has_table
+
+/// add the tables of newer versions of logged-gcc to older databases
+void
+upgrade_sqlite_database(void)
+{
+  char *msgerr = nullptr;
+  /// every wrapper run opens the database, so the write lock is only
+  /// taken when some table of upgreq below is missing
+  static const char*const newtables[] =
+  {
+    "tb_includepath", "tb_compilation_includes", "tb_cache_event", "tb_resource_series",
+    "tb_rollup_source", "tb_rollup_day", "tb_rollup_compiler", "tb_rollup_flags",
+    "tb_hashing", nullptr
+  };
+  bool uptodate = true;
+  for (const char*const*pt = newtables; *pt && uptodate; pt++)
+    uptodate = sqlite_has_table(*pt);
+  if (uptodate)
+    return;
+  /// concurrent wrappers may upgrade the same database, so the new
+  /// tables and their first rollups are created in one transaction
+  if (!begin_immediate_transaction("upgrade_sqlite_database"))
+    exit(EXIT_FAILURE);
+  /// the rollups are filled when some of them appear on an older database
+  bool hadrollups = sqlite_has_table("tb_rollup_source") && sqlite_has_table("tb_rollup_day")
+                    && sqlite_has_table("tb_rollup_compiler") && sqlite_has_table("tb_rollup_flags");
+  const char* upgreq = R"!*(
+CREATE TABLE IF NOT EXISTS tb_includepath (
+  incp_id INTEGER PRIMARY KEY ASC AUTOINCREMENT,
+  incp_path VARCHAR(512) NOT NULL UNIQUE
+);
+CREATE TABLE IF NOT EXISTS tb_compilation_includes (
+  incl_compil_id INTEGER NOT NULL PRIMARY KEY,
+  incl_count INTEGER NOT NULL,
+  incl_ids BLOB NOT NULL
+);
+CREATE TABLE IF NOT EXISTS tb_cache_event (
+  cach_compil_id INTEGER NOT NULL PRIMARY KEY,
+  cach_hit INTEGER NOT NULL,
+  cach_key CHAR(32) NOT NULL
+);
+CREATE INDEX IF NOT EXISTS ix_cache_event_key ON tb_cache_event(cach_key);
+CREATE TABLE IF NOT EXISTS tb_resource_series (
+  rser_compil_id INTEGER NOT NULL PRIMARY KEY,
+  rser_interval_ms INTEGER NOT NULL,
+  rser_nbsamples INTEGER NOT NULL,
+  rser_peak_kb INTEGER NOT NULL,
+  rser_instructions INTEGER,
+  rser_cycles INTEGER,
+  rser_cache_misses INTEGER,
+  rser_series BLOB NOT NULL
+);
+CREATE INDEX IF NOT EXISTS ix_resource_peak ON tb_resource_series(rser_peak_kb);
+CREATE TABLE IF NOT EXISTS tb_rollup_source (
+  rlsp_path_serial INTEGER NOT NULL PRIMARY KEY,
+  rlsp_count INTEGER NOT NULL,
+  rlsp_elapsed DOUBLE NOT NULL,
+  rlsp_cpu DOUBLE NOT NULL,
+  rlsp_max_elapsed DOUBLE NOT NULL,
+  rlsp_last_time INTEGER NOT NULL
+);
+CREATE INDEX IF NOT EXISTS ix_rollup_source_mean
+  ON tb_rollup_source(rlsp_elapsed / rlsp_count, rlsp_count, rlsp_max_elapsed, rlsp_cpu);
+CREATE TABLE IF NOT EXISTS tb_rollup_day (
+  rlday_day INTEGER NOT NULL,
+  rlday_path_serial INTEGER NOT NULL,
+  rlday_count INTEGER NOT NULL,
+  rlday_elapsed DOUBLE NOT NULL,
+  rlday_cpu DOUBLE NOT NULL,
+  PRIMARY KEY (rlday_day, rlday_path_serial)
+) WITHOUT ROWID;
+CREATE TABLE IF NOT EXISTS tb_rollup_compiler (
+  rlcc_compiler VARCHAR(256) NOT NULL PRIMARY KEY,
+  rlcc_count INTEGER NOT NULL,
+  rlcc_elapsed DOUBLE NOT NULL,
+  rlcc_cpu DOUBLE NOT NULL
+) WITHOUT ROWID;
+CREATE TABLE IF NOT EXISTS tb_rollup_flags (
+  rlfl_flags TEXT NOT NULL PRIMARY KEY,
+  rlfl_count INTEGER NOT NULL,
+  rlfl_elapsed DOUBLE NOT NULL,
+  rlfl_cpu DOUBLE NOT NULL
+) WITHOUT ROWID;
+CREATE TABLE IF NOT EXISTS tb_hashing (
+  hash_compil_id INTEGER NOT NULL PRIMARY KEY,
+  hash_algo VARCHAR(16) NOT NULL,
+  hash_nbfiles INTEGER NOT NULL,
+  hash_nbcached INTEGER NOT NULL,
+  hash_time DOUBLE NOT NULL,
+  hash_saved_time DOUBLE NOT NULL
+);
+)!*";
+  DEBUGLOG("upgrade_sqlite_database °upgreq=" << upgreq);
+  int r = sqlite3_exec(mysqlitedb, upgreq, nullptr, nullptr, &msgerr);
+  if (r != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "upgrade_sqlite_database L¤%d (path %s) failure #%d : %s\n request was %s", __LINE__,
+             mysqlitepath, r, msgerr?msgerr:"???", upgreq);
+      exit(EXIT_FAILURE);
+    };
+  if (!hadrollups)
+    fill_rollups();
+  if (sqlite3_exec(mysqlitedb, "COMMIT TRANSACTION", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+      syslog(LOG_ALERT, "upgrade_sqlite_database failed to commit - %s", sqlite3_errmsg(mysqlitedb));
+      exit(EXIT_FAILURE);
+    };
+} // end upgrade_sqlite_database
+
 void
 initialize_sqlite(void)
 {
@@ -1008,15 +3427,174 @@ initialize_sqlite(void)
 	   mysqlitepath, mysqlitedb?sqlite3_errmsg(mysqlitedb):errbuf);
     exit(EXIT_FAILURE);
   }
+  /// concurrent wrappers storing directly wait for the write lock
+  sqlite3_busy_timeout(mysqlitedb, 10000);
   if (!oldsqlite)
     create_sqlite_database();
+  upgrade_sqlite_database();
   if (mysqliterequest) {
     DEBUGLOG("initialize_sqlite mysqliterequest=" << mysqliterequest);
     run_sqlite_request(mysqliterequest, __LINE__);
   }
+  if (myheadercosts > 0)
+    report_header_costs(myheadercosts);
+  if (myresourcetop > 0)
+    report_resource_usage(myresourcetop);
+  for (const std::string& repname : myreports)
+    run_canned_report(repname.c_str(), myreporttop);
   DEBUGLOG("initialize_sqlite done mysqlitepath=" << mysqlitepath);
 } // end of initialize_sqlite
 
+volatile sig_atomic_t daemon_stopping;
+
+void
+daemon_signal_handler(int)
+{
+  daemon_stopping = 1;
+} // end daemon_signal_handler
+
+/// Read the complete records of a spool file, then remove it.  The
+/// daemon first renames the spool to <spool>.ingest and only reads it
+/// at the next batch, so a wrapper which opened the spool just before
+/// the rename has finished its single write.
+void
+ingest_spool_file(std::vector<Logged_record>&recvec)
+{
+  std::string ingestpath = std::string(mylogspool) + ".ingest";
+  int fd = open(ingestpath.c_str(), O_RDONLY|O_CLOEXEC);
+  if (fd >= 0)
+    {
+      Logged_record rec;
+      long nbrec = 0, nbbad = 0, nbother = 0;
+      while (read(fd, &rec, sizeof(rec)) == (ssize_t) sizeof(rec))
+        {
+          if (rec.valid())
+            {
+              recvec.push_back(rec);
+              nbrec++;
+            }
+          else if (rec.other_version())
+            nbother++;
+          else
+            nbbad++;
+        };
+      close(fd);
+      unlink(ingestpath.c_str());
+      syslog(LOG_INFO, "logging daemon ingested %ld records (%ld invalid) from spool %s",
+             nbrec, nbbad, mylogspool);
+      if (nbother > 0)
+        syslog(LOG_WARNING, "logging daemon ignored %ld records of another logged-gcc version"
+               " (not %u) in spool %s", nbother, Logged_record::_lrec_version_, mylogspool);
+    };
+  if (access(ingestpath.c_str(), F_OK) && !access(mylogspool, F_OK))
+    rename(mylogspool, ingestpath.c_str());
+} // end ingest_spool_file
+
+/// The logging daemon: receive records from the wrappers on a Unix
+/// datagram socket, and store them every mybatchms milliseconds in a
+/// single transaction of the database in WAL mode.
+void
+run_logging_daemon(void)
+{
+  assert (mysqlitedb != nullptr);
+  assert (mylogsocket != nullptr && mylogspool != nullptr);
+  struct sockaddr_un sun = {};
+  if (strlen(mylogsocket) >= sizeof(sun.sun_path))
+    {
+      syslog(LOG_ALERT, "logging daemon socket path %s is too long", mylogsocket);
+      exit(EXIT_FAILURE);
+    };
+  sun.sun_family = AF_UNIX;
+  strcpy(sun.sun_path, mylogsocket);
+  int sockfd = socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+  if (sockfd < 0)
+    {
+      syslog(LOG_ALERT, "logging daemon failed to create socket - %m");
+      exit(EX_OSERR);
+    };
+  unlink(mylogsocket);
+  mode_t oldmask = umask(077);
+  if (bind(sockfd, (struct sockaddr*)&sun, sizeof(sun)))
+    {
+      syslog(LOG_ALERT, "logging daemon failed to bind %s - %m", mylogsocket);
+      exit(EX_OSERR);
+    };
+  umask(oldmask);
+  int rcvbuf = 256*sizeof(Logged_record);
+  setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  char*msgerr = nullptr;
+  if (sqlite3_exec(mysqlitedb, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;",
+                   nullptr, nullptr, &msgerr) != SQLITE_OK)
+    syslog(LOG_WARNING, "logging daemon cannot use WAL mode on %s: %s",
+           mysqlitepath, msgerr?msgerr:"???");
+  struct sigaction sa = {};
+  sa.sa_handler = daemon_signal_handler;
+  sigaction(SIGTERM, &sa, nullptr);
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGHUP, &sa, nullptr);
+  syslog(LOG_INFO, "logging daemon pid %d on socket %s for database %s every %d ms",
+         (int)getpid(), mylogsocket, mysqlitepath, mybatchms);
+  std::vector<Logged_record> pendvec;
+  long nbreceived = 0, nbstored = 0;
+  bool warnedversion = false;
+  double nextflush = get_float_time(CLOCK_MONOTONIC) + 1.0e-3*mybatchms;
+  ingest_spool_file(pendvec);
+  while (!daemon_stopping)
+    {
+      double now = get_float_time(CLOCK_MONOTONIC);
+      if (now >= nextflush)
+        {
+          ingest_spool_file(pendvec);
+          if (!pendvec.empty())
+            {
+              /// a busy database keeps the batch for the next flush
+              int nbnew = store_log_records(pendvec.data(), (int) pendvec.size());
+              if (nbnew >= 0)
+                {
+                  nbstored += nbnew;
+                  DEBUGLOG("run_logging_daemon stored " << pendvec.size()
+                           << " records, " << nbstored << " so far");
+                  pendvec.clear();
+                }
+            };
+          nextflush = now + 1.0e-3*mybatchms;
+        };
+      struct pollfd pfd = {};
+      pfd.fd = sockfd;
+      pfd.events = POLLIN;
+      if (poll(&pfd, 1, 1 + (int)(1.0e3*(nextflush-now))) <= 0)
+        continue;
+      Logged_record rec;
+      while (recv(sockfd, &rec, sizeof(rec), MSG_DONTWAIT) == (ssize_t) sizeof(rec))
+        {
+          if (rec.other_version() && !warnedversion)
+            {
+              syslog(LOG_WARNING, "logging daemon ignores records of logged-gcc version %u (not %u) from pid %d",
+                     rec.lrec_magic & 0xffU, Logged_record::_lrec_version_, (int) rec.lrec_pid);
+              warnedversion = true;
+            };
+          if (!rec.valid())
+            continue;
+          pendvec.push_back(rec);
+          nbreceived++;
+        }
+    };
+  close(sockfd);
+  unlink(mylogsocket);
+  /// records sent after the unlink go to the spool, ingested at restart
+  if (!pendvec.empty())
+    {
+      int nbnew = store_log_records(pendvec.data(), (int) pendvec.size());
+      if (nbnew >= 0)
+        nbstored += nbnew;
+      else
+        for (const Logged_record& rec : pendvec)
+          spool_log_record(rec);
+    };
+  syslog(LOG_INFO, "logging daemon pid %d stopping, received %ld and stored %ld records",
+         (int)getpid(), nbreceived, nbstored);
+} // end run_logging_daemon
+
 ////////////////////////////////////////////////////////////////
 int
 main(int argc, char**argv)
@@ -1030,12 +3608,33 @@ main(int argc, char**argv)
     };
   if (argc >= 2 && !strcmp(argv[1], "--debug"))
     debug_enabled = true;
-  OpenSSL_add_all_digests();
   mymdctx = EVP_MD_CTX_create();
   if (!mymdctx) {
     perror("EVP_MD_CTX_create");
     exit(EXIT_FAILURE);
   };
+  mydepsmode = getenv("LOGGED_DEPS") != nullptr;
+  mycachedir = getenv("LOGGED_CACHE");
+  if (getenv("LOGGED_SAMPLE_MS"))
+    mysamplems = atoi(getenv("LOGGED_SAMPLE_MS"));
+  myhashalgo = getenv("LOGGED_DIGEST");
+  if (!myhashalgo)
+#ifdef LOGGED_HAVE_XXHASH
+    myhashalgo = "xxh3";
+#else
+    myhashalgo = "md5";
+#endif
+  myhashcachepath = getenv("LOGGED_HASH_CACHE");
+  if (!myhashcachepath) {
+    static std::string cachestr;
+    if (getenv("XDG_CACHE_HOME"))
+      cachestr = std::string(getenv("XDG_CACHE_HOME")) + "/logged-gcc-digests";
+    else if (getenv("HOME"))
+      cachestr = std::string(getenv("HOME")) + "/.cache/logged-gcc-digests";
+    if (!cachestr.empty())
+      myhashcachepath = cachestr.c_str();
+    myhashcachedefault = true;
+  };
   openlog(argv[0], LOG_PERROR|LOG_PID, LOG_USER);
   std::string argstr;
   if (!mygcc)
@@ -1082,6 +3681,16 @@ main(int argc, char**argv)
   int nbgccarg=0;
   std::vector<const char*> argvec
     = parse_logged_program_options(argc, argv, argstr, nbgccarg);
+#ifdef LOGGED_HAVE_XXHASH
+  if (!strcmp(myhashalgo, "xxh3"))
+    mymd = nullptr;
+  else
+#endif /*LOGGED_HAVE_XXHASH*/
+  if (!(mymd = EVP_get_digestbyname(myhashalgo)) || strlen(myhashalgo) >= 16)
+    {
+      syslog (LOG_ALERT, "%s: unknown digest algorithm %s", myprogname, myhashalgo);
+      exit(EXIT_FAILURE);
+    };
   assert (argvec.size() > 0);
   if (!for_cxx && access(mygcc, X_OK))
     {
@@ -1097,6 +3706,18 @@ main(int argc, char**argv)
       mygcc = defgcc;
     };
   ///
+  if (!mylogsocket)
+    mylogsocket = getenv("LOGGED_SOCKET");
+  if (!mylogsocket && (daemon_mode || !access(default_log_socket(), F_OK)))
+    mylogsocket = default_log_socket();
+  if (mylogsocket) {
+    static std::string spoolstr;
+    mylogspool = getenv("LOGGED_SPOOL");
+    if (!mylogspool) {
+      spoolstr = std::string(mylogsocket) + ".spool";
+      mylogspool = spoolstr.c_str();
+    }
+  }
   if (!mysqlitepath) {
     static char sqlbuf[128];
     memset (sqlbuf, 0, sizeof(sqlbuf));
@@ -1106,7 +3727,10 @@ main(int argc, char**argv)
       mysqlitepath = sqlbuf;
     }
   }
-  if (mysqlitepath)
+  if (mylogsocket && !daemon_mode && !mysqliterequest && !myheadercosts && !myresourcetop
+      && myreports.empty())
+    DEBUGLOG("main sending records to the logging daemon at " << mylogsocket);
+  else if (mysqlitepath)
     initialize_sqlite();
   else {
       syslog (LOG_ALERT, "logged compilation %s (git %s) without given SQLITE database;\n"
@@ -1130,10 +3754,13 @@ main(int argc, char**argv)
       mygxx = defgxx;
     };
   auto linkflags = getenv("LOGGED_LINKFLAGS");
-  if (for_cxx && nbgccarg>0)
+  if (daemon_mode)
+    run_logging_daemon();
+  else if (for_cxx && nbgccarg>0)
     do_cxx_compilation (argvec, argstr, linkflags);
   else if (!for_cxx && nbgccarg>0)
     do_c_compilation (argvec, argstr, linkflags);
+  flush_log_records();
   if (mysqlitedb) {
     int err = sqlite3_close_v2(mysqlitedb);
     if (err != SQLITE_OK) {
@@ -43,6 +43,7 @@
  * _genf_N_O6.c et les greffons correspondants _genf_N_06.so
  ***/
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -59,6 +60,16 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <sys/utsname.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/mman.h>
+#include <linux/magic.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 #ifndef MANYDL_GIT
 #error missing MANYDL_GIT string as preprocessing flag
@@ -70,7 +81,14 @@ const char manydl_git[] = MANYDL_GIT;
 //€Français: le compilateur GCC
 const char manydl_gcc[] = MANYDL_GCC;
 #else
-const char manydl_gcc[] = "gcc"
+const char manydl_gcc[] = "gcc";
+#endif
+
+#ifdef MANYDL_GENF_CFLAGS
+// €Français: les options de compilation des greffons
+const char manydl_genf_cflags[] = MANYDL_GENF_CFLAGS;
+#else
+const char manydl_genf_cflags[] = "-O2 -g -fPIC -Wall";
 #endif
 #define NAME_BUFLEN 48
 // €Français: nombre de fichiers C et greffons générés. Tous les
@@ -90,6 +108,66 @@ int makenbjobs = 7;
 #define MINIMAL_NBJOBS 4
 #define MAXIMAL_NBJOBS 50
 
+// €Français: avec -P, nombre de fils d'exécution générant le code C,
+// qui est compilé au fur et à mesure sans make.
+// with -P <nbgenthreads>, the pipelined mode: generator threads feed
+// a bounded queue drained by a built-in job server spawning $CC
+int pipelined_nbthreads = 0;
+#define MAXIMAL_GENTHREADS 64
+
+// €Français: avec -b K, chaque greffon contient K fonctions générées,
+// accessibles par la table genf_table exportée du greffon.
+// with -b K, each plugin has K generated functions of its genf_table
+int batchsize = 1;
+#define MAXIMAL_BATCHSIZE 100000
+
+// €Français: avec -L, banc d'essai du chargement par plusieurs fils
+// with -L <nbthreads>, benchmark parallel dlopen and dlmopen
+int loader_nbthreads = 0;
+#define MAXIMAL_LOADER_THREADS 64
+#define HOST_SHIM_NAME "_genf_host"
+
+// €Français: avec -K, répertoire du cache des greffons compilés,
+// dont la taille est bornée par -M (en mégaoctets)
+// with -K <cachedir>, plugins are hard-linked from a compilation cache
+// keyed by the hash of their source, compiler and flags
+const char *cachedir = NULL;
+long cache_max_megabytes = 1024;
+
+// €Français: avec -D, banc d'essai des appels: chaque greffon a en
+// plus une petite fonction feuille genf_X_NN_leaf
+// with -D, each plugin also has a tiny leaf function, and the
+// dispatch benchmark compares ways of calling them
+bool dispatch_benchmark = false;
+#define CALLER_NAME "_genf_caller"
+
+// €Français: avec -U, nombre de tours de déchargement et rechargement
+// with -U <rounds>, the churn mode dlcloses a tenth of the plugins and
+// dlopens freshly generated replacements, at each round
+int churn_rounds = 0;
+
+// €Français: le rapport JSON écrit à la fin de chaque exécution
+// the JSON report written at the end of each run, see -J and --compare
+const char *reportpath = "_manydl_report.json";
+
+// €Français: avec -X, construction dans un tmpfs privé ou des memfd
+// with -X tmpfs, the run happens in a fresh directory of /dev/shm
+// removed at exit; with -X memfd, the sources and plugins are also
+// memfd_create(2) descriptors, compiled and dlopened thru /proc/self/fd
+enum builddir_en
+{
+  BUILDDIR_CWD,
+  BUILDDIR_TMPFS,
+  BUILDDIR_MEMFD
+} builddir_mode = BUILDDIR_CWD;
+const char *const builddir_names[] = { "cwd", "tmpfs", "memfd" };
+
+#define BUILDDIR_PARENT "/dev/shm"
+char builddir_path[256];
+char startcwd[256];
+int *memfd_src = NULL;          /* per plugin source descriptors */
+int *memfd_so = NULL;           /* per plugin shared object descriptors */
+
 // €Français: drapeau pour la verbosité à l'exécution.
 bool verbose = false;
 
@@ -132,6 +210,7 @@ char *progname;
 double start_elapsed_clock = NAN, start_cpu_clock = NAN;
 double generate_elapsed_clock = NAN, generate_cpu_clock = NAN;
 double compile_elapsed_clock = NAN, compile_cpu_clock = NAN;
+double compile_children_cpu = NAN;      /* included in compile_cpu_clock */
 double dlopen_elapsed_clock = NAN, dlopen_cpu_clock = NAN;
 double compute_elapsed_clock = NAN, compute_cpu_clock = NAN;
 double terminating_elapsed_clock = NAN, terminating_cpu_clock = NAN;
@@ -177,11 +256,166 @@ say_fun_a_b_c_d (const char *fun, int a, int b, int c, int d)
 double secpertick;
 clock_t firstclock;
 
-#define DICE(N) ((int)(lrand48 () % (N)))
+/* in pipelined mode, each generator thread has its own random state,
+   reseeded for each file from random_seed and the file index, so the
+   generated code does not depend on the thread scheduling */
+static __thread struct drand48_data *gen_randstate;
+
+static inline int
+dice (int n)
+{
+  long r = 0;
+  if (gen_randstate)
+    lrand48_r (gen_randstate, &r);
+  else
+    r = lrand48 ();
+  return (int) (r % n);
+}                               /* end dice */
+
+#define DICE(N) dice(N)
+
+/***** €Français: profils de génération (option -G) et distribution
+ * des tailles des fonctions (option -W).
+ *
+ * A profile weights the statement shapes of generate_function.  The
+ * first 16 shapes are the historical ones, equally likely in the
+ * default profile so its generated code is unchanged.
+ *****/
+
+enum genshape_en
+{
+  SHAPE_HISTORICAL = 16,        /* shapes 0 to 15 */
+  SHAPE_CALL = SHAPE_HISTORICAL,        /* calls to add_x_3_y and a helper */
+  SHAPE_TABLE,                  /* lookups in a large constant table */
+  SHAPE_NESTED_LOOPS,           /* deeply nested counted loops */
+  SHAPE_BIG_SWITCH,             /* switch with many cases */
+  SHAPE__LAST
+};
+
+struct genprofile_st
+{
+  const char *gp_name;
+  const char *gp_descr;
+  int gp_weights[SHAPE__LAST];
+  int gp_tablesize;             /* length of the constant tables */
+  int gp_loopdepth;             /* depth of nested loops */
+};
+
+/* historical shapes by kind: arithmetic ones are 0 1 3 5 7 8 11 12
+   14, goto ones are 6 9 10 15, loops are 4 13, and 2 sometimes has a
+   small switch */
+#define ARITH_WEIGHTS(W) [0] = W, [1] = W, [3] = W, [5] = W, [7] = W, \
+    [8] = W, [11] = W, [12] = W, [14] = W
+
+const struct genprofile_st genprofiles[] = {
+  {"default", "the historical mix",
+   {[0 ... SHAPE_HISTORICAL - 1] = 1}, 0, 0},
+  {"arith", "straight line arithmetic",
+   {ARITH_WEIGHTS (1)}, 0, 0},
+  {"switch", "switch heavy",
+   {ARITH_WEIGHTS (1),[2] = 4,[SHAPE_BIG_SWITCH] = 12}, 0, 0},
+  {"goto", "goto and label heavy",
+   {ARITH_WEIGHTS (1),[6] = 6,[9] = 6,[10] = 6,[15] = 6}, 0, 0},
+  {"call", "call heavy",
+   {ARITH_WEIGHTS (1),[SHAPE_CALL] = 16}, 0, 0},
+  {"table", "large constant tables",
+   {ARITH_WEIGHTS (1),[SHAPE_TABLE] = 12}, 4096, 0},
+  {"loops", "deeply nested loops",
+   {ARITH_WEIGHTS (1),[4] = 2,[13] = 2,[SHAPE_NESTED_LOOPS] = 8}, 0, 5},
+  {"mixed", "every shape",
+   {[0 ... SHAPE__LAST - 1] = 1}, 1024, 3},
+};
+
+#define NB_GENPROFILES (int) (sizeof (genprofiles) / sizeof (genprofiles[0]))
+
+const struct genprofile_st *genprofile = genprofiles;
+int genprofile_totweight = SHAPE_HISTORICAL;
+
+/// the random statement shape, following the profile weights
+static int
+random_shape (void)
+{
+  int w = DICE (genprofile_totweight);
+  int shape = 0;
+  while (w >= genprofile->gp_weights[shape])
+    w -= genprofile->gp_weights[shape++];
+  return shape;
+}                               /* end random_shape */
+
+// €Français: distribution des tailles des fonctions générées
+enum sizedist_en
+{
+  SIZEDIST_UNIFORM,             /* between meansize/2 and 3*meansize/2 */
+  SIZEDIST_FIXED,               /* always meansize */
+  SIZEDIST_BIMODAL,             /* mostly meansize/2, one in 8 is 4*meansize */
+};
+
+const char *const sizedist_names[] = { "uniform", "fixed", "bimodal" };
+
+enum sizedist_en sizedist = SIZEDIST_UNIFORM;
+
+static int
+random_function_length (void)
+{
+  switch (sizedist)
+    {
+    case SIZEDIST_FIXED:
+      return meansize;
+    case SIZEDIST_BIMODAL:
+      return DICE (8) ? meansize / 2 : 4 * meansize;
+    default:
+      return meansize / 2 + DICE (meansize);
+    };
+}                               /* end random_function_length */
 
 
 void compute_name_for_index (char name[static NAME_BUFLEN], int ix);
 
+// €Français: nombre de greffons, qui contiennent batchsize fonctions
+static inline int
+nb_plugins (void)
+{
+  return (maxcnt + batchsize - 1) / batchsize;
+}                               /* end nb_plugins */
+
+/// the number of generated functions in the plugin of index pix
+static inline int
+plugin_function_count (int pix)
+{
+  int rest = maxcnt - pix * batchsize;
+  return (rest < batchsize) ? rest : batchsize;
+}                               /* end plugin_function_count */
+
+/// the resident set size in kilobytes, from /proc/self/statm
+long
+current_rss_kb (void)
+{
+  long size = 0, resident = 0;
+  FILE *f = fopen ("/proc/self/statm", "r");
+  if (!f)
+    return -1;
+  if (fscanf (f, "%ld %ld", &size, &resident) < 2)
+    resident = -1;
+  fclose (f);
+  return (resident < 0) ? -1 : resident * (sysconf (_SC_PAGESIZE) / 1024);
+}                               /* end current_rss_kb */
+
+/// the number of memory mappings, i.e. of lines in /proc/self/maps
+int
+count_mappings (void)
+{
+  char line[512];
+  int nbmaps = 0;
+  FILE *f = fopen ("/proc/self/maps", "r");
+  if (!f)
+    return -1;
+  while (fgets (line, sizeof (line), f))
+    if (strchr (line, '\n'))
+      nbmaps++;
+  fclose (f);
+  return nbmaps;
+}                               /* end count_mappings */
+
 
 void
 compute_name_for_index (char name[static NAME_BUFLEN], int ix)
@@ -203,49 +437,211 @@ compute_name_for_index (char name[static NAME_BUFLEN], int ix)
 }                               /* end compute_name_for_index */
 
 
+/// the path of the generated C source of index ix
+static void
+source_path (char *buf, size_t siz, int ix)
+{
+  char curname[NAME_BUFLEN];
+  if (memfd_src)
+    {
+      snprintf (buf, siz, "/proc/self/fd/%d", memfd_src[ix]);
+      return;
+    };
+  compute_name_for_index (curname, ix);
+  snprintf (buf, siz, "%s.c", curname);
+}                               /* end source_path */
 
-/* generate a file containing one single randomly coded function
-   (named like the file, ie function foo in foo.c), using the lrand48
-   random number generator; return the size */
-int
-generate_file (const char *name)
+/// the path of the plugin of index ix, suitable for dlopen
+static void
+plugin_path (char *buf, size_t siz, int ix)
+{
+  char curname[NAME_BUFLEN];
+  if (memfd_so)
+    {
+      snprintf (buf, siz, "/proc/self/fd/%d", memfd_so[ix]);
+      return;
+    };
+  compute_name_for_index (curname, ix);
+  snprintf (buf, siz, "./%s%s", curname, pluginsuffix);
+}                               /* end plugin_path */
+
+/* with -X memfd, create fresh descriptors for the source and the
+   plugin of index ix, closing the previous ones.  They are
+   close-on-exec, so each compiler only inherits its own pair. */
+static void
+open_plugin_memfds (int ix)
+{
+  char curname[NAME_BUFLEN];
+  char memname[NAME_BUFLEN + 16];
+  compute_name_for_index (curname, ix);
+  if (memfd_src[ix] >= 0)
+    close (memfd_src[ix]);
+  if (memfd_so[ix] >= 0)
+    close (memfd_so[ix]);
+  snprintf (memname, sizeof (memname), "%s.c", curname);
+  memfd_src[ix] = memfd_create (memname, MFD_CLOEXEC);
+  snprintf (memname, sizeof (memname), "%s%s", curname, pluginsuffix);
+  memfd_so[ix] = memfd_create (memname, MFD_CLOEXEC);
+  if (memfd_src[ix] < 0 || memfd_so[ix] < 0)
+    {
+      fprintf (stderr, "%s: memfd_create for plugin#%d %s failed (%s)\n",
+               progname, ix, curname, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+}                               /* end open_plugin_memfds */
+
+/* Paths given relative to the starting directory stay meaningful
+   after the chdir into the build directory. */
+static const char *
+absolute_from_start (const char *path)
+{
+  if (!path || path[0] == '/')
+    return path;
+  char *abspath = NULL;
+  if (asprintf (&abspath, "%s/%s", startcwd, path) < 0)
+    {
+      fprintf (stderr, "%s: failed to make %s absolute (%s)\n",
+               progname, path, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  return abspath;
+}                               /* end absolute_from_start */
+
+/// remove the build directory and everything in it, at exit
+static void
+remove_build_directory (void)
+{
+  int nbremoved = 0;
+  if (!builddir_path[0] || chdir (startcwd))
+    return;
+  DIR *dir = opendir (builddir_path);
+  struct dirent *de = NULL;
+  while (dir && (de = readdir (dir)) != NULL)
+    if (!unlinkat (dirfd (dir), de->d_name, 0))
+      nbremoved++;
+  if (dir)
+    closedir (dir);
+  if (rmdir (builddir_path))
+    fprintf (stderr, "%s: failed to remove build directory %s (%s)\n",
+             progname, builddir_path, strerror (errno));
+  else if (verbose)
+    printf ("%s: removed build directory %s with %d files\n",
+            progname, builddir_path, nbremoved);
+}                               /* end remove_build_directory */
+
+// €Français: avec -X, on travaille dans un répertoire temporaire en
+// mémoire (tmpfs), supprimé à la fin
+/* With -X tmpfs or -X memfd, make a fresh directory under /dev/shm,
+   chdir into it and remove it at exit, so no I/O reaches the disk and
+   nothing needs cleaning up.  With memfd, only the helper files (host
+   shim, dispatch caller) live there. */
+void
+setup_build_directory (void)
+{
+  struct statfs sfs = { };
+  if (!getcwd (startcwd, sizeof (startcwd)))
+    {
+      fprintf (stderr, "%s: failed to getcwd (%s)\n", progname,
+               strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  if (builddir_mode == BUILDDIR_CWD)
+    return;
+  snprintf (builddir_path, sizeof (builddir_path),
+            BUILDDIR_PARENT "/manydl-%d-XXXXXX", (int) getpid ());
+  if (!mkdtemp (builddir_path))
+    {
+      fprintf (stderr, "%s: failed to make build directory %s (%s)\n",
+               progname, builddir_path, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  if (statfs (builddir_path, &sfs) || sfs.f_type != TMPFS_MAGIC)
+    fprintf (stderr, "%s: warning, build directory %s is not on tmpfs\n",
+             progname, builddir_path);
+  reportpath = absolute_from_start (reportpath);
+  cachedir = absolute_from_start (cachedir);
+  if (terminatingscript && strchr (terminatingscript, '/'))
+    terminatingscript = absolute_from_start (terminatingscript);
+  if (chdir (builddir_path))
+    {
+      fprintf (stderr, "%s: failed to chdir to %s (%s)\n",
+               progname, builddir_path, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  /* the compiler temporary files also stay in memory */
+  setenv ("TMPDIR", builddir_path, 1);
+  atexit (remove_build_directory);
+  if (builddir_mode == BUILDDIR_MEMFD)
+    {
+      int nbplugins = nb_plugins ();
+      struct rlimit rl = { };
+      /* two descriptors per plugin, kept open until exit */
+      if (!getrlimit (RLIMIT_NOFILE, &rl) && rl.rlim_cur < rl.rlim_max)
+        {
+          rl.rlim_cur = rl.rlim_max;
+          setrlimit (RLIMIT_NOFILE, &rl);
+        };
+      if (getrlimit (RLIMIT_NOFILE, &rl)
+          || rl.rlim_cur < (rlim_t) 2 * nbplugins + 64)
+        {
+          fprintf (stderr,
+                   "%s: -X memfd needs %d file descriptors, above the"
+                   " limit %ld\n", progname, 2 * nbplugins + 64,
+                   (long) rl.rlim_cur);
+          exit (EXIT_FAILURE);
+        };
+      memfd_src = calloc (nbplugins, sizeof (int));
+      memfd_so = calloc (nbplugins, sizeof (int));
+      if (!memfd_src || !memfd_so)
+        {
+          fprintf (stderr, "%s: failed to calloc memfd arrays (%s)\n",
+                   progname, strerror (errno));
+          exit (EXIT_FAILURE);
+        };
+      for (int ix = 0; ix < nbplugins; ix++)
+        memfd_src[ix] = memfd_so[ix] = -1;
+    };
+  printf ("%s: building in %s (%s)\n", progname, builddir_path,
+          builddir_names[builddir_mode]);
+}                               /* end setup_build_directory */
+
+
+
+/* generate into f one randomly coded function of l instructions,
+   named like name without its leading underscore, using the DICE
+   random number generator */
+static void
+generate_function (FILE *f, const char *name, int l)
 {
-  char pathsrc[100];
-  FILE *f = NULL;
-  int l = 0;
   int i = 0;
   int prevjmpix = 0;
 #define MAXLAB 32
   bool definedlab[MAXLAB];
   bool jumpedlab[MAXLAB];
-  memset (pathsrc, 0, sizeof (pathsrc));
   for (int il = 0; il < MAXLAB; il++)
     definedlab[il] = false;
   for (int il = 0; il < MAXLAB; il++)
     jumpedlab[il] = false;
-  snprintf (pathsrc, sizeof (pathsrc) - 1, "%s.c", name);
-  f = fopen (pathsrc, "w");
-  if (!f)
+  if (genprofile->gp_weights[SHAPE_CALL] > 0)
+    fprintf (f, "extern int add_x_3_y (int, int);\n"
+             "static int helper_%s (int x, int y)\n"
+             "{ return (x * %d + (y >> 2)) & 0xffff; }\n", name + 1,
+             3 + DICE (20));
+  if (genprofile->gp_weights[SHAPE_TABLE] > 0)
     {
-      perror (pathsrc);
-      exit (EXIT_FAILURE);
+      fprintf (f, "static const int ctab_%s[%d] = {", name + 1,
+               genprofile->gp_tablesize);
+      for (int t = 0; t < genprofile->gp_tablesize; t++)
+        fprintf (f, "%s%d,", (t % 10 == 0) ? "\n  " : " ", DICE (100000));
+      fprintf (f, "\n};\n");
     };
-  /* random length of generated function */
-  l = meansize / 2 + DICE (meansize);
-  fprintf (f, "/* generated file %s length %d meansize %d*/\n", pathsrc, l,
-           meansize);
-  fprintf (f, "extern long dynstep;\n" "extern int tab[%d];\n", MAXTAB);
-  fprintf (f,
-           "extern void say_fun_a_b_c_d(const char*fun, int a, int b, int c, int d);\n");
-  fprintf (f, "const char gentimestamp_%s[] = __DATE__ \"@\" __TIME__;\n",
-           name);
   fprintf (f, "int %s(int a, int b) {\n", name + 1);
   fputs ("  int c=0, d=1, e=2, f=3, g=4, h=5, i=6, j=7, k=8, l=a+b;\n", f);
   fputs ("  long initdynstep = dynstep;\n", f);
 #define RANVAR ('a'+DICE(12))
   for (i = 0; i < l; i++)
     {
-      switch (DICE (16))
+      switch (random_shape ())
         {
         case 0:
           fprintf (f, "// from %d\n", __LINE__);
@@ -459,7 +855,48 @@ generate_file (const char *name)
             jumpedlab[labrank] = true;
             break;
           };
-
+        case SHAPE_CALL:
+          fprintf (f, "// from %d\n", __LINE__);
+          fprintf (f, " %c = add_x_3_y (%c, %c & 0xfff) & 0xffffff;\n",
+                   RANVAR, RANVAR, RANVAR);
+          if (DICE (2) == 0)
+            fprintf (f, " %c = helper_%s (%c, %c);\n", RANVAR, name + 1,
+                     RANVAR, RANVAR);
+          break;
+        case SHAPE_TABLE:
+          fprintf (f, "// from %d\n", __LINE__);
+          fprintf (f, " %c = (%c + ctab_%s[(%c & 0x7fffffff) %% %d]) & 0xffffff;\n",
+                   RANVAR, RANVAR, name + 1, RANVAR,
+                   genprofile->gp_tablesize);
+          break;
+        case SHAPE_NESTED_LOOPS:
+          {
+            int depth = genprofile->gp_loopdepth;
+            fprintf (f, "// from %d\n", __LINE__);
+            fprintf (f, " {\n");
+            for (int d = 0; d < depth; d++)
+              fprintf (f, "  for (int n%d = 0; n%d < %d; n%d++)\n",
+                       d, d, 2 + DICE (3), d);
+            fprintf (f, "   { %c += (n0 * %d", RANVAR, 1 + DICE (9));
+            for (int d = 1; d < depth; d++)
+              fprintf (f, " + n%d", d);
+            fprintf (f, ") & 0xff; tab[(%c + n%d) & %#x]++; dynstep++; }\n",
+                     RANVAR, depth - 1, MAXTAB - 1);
+            fprintf (f, " }\n");
+          }
+          break;
+        case SHAPE_BIG_SWITCH:
+          {
+            int nbcas = 8 + DICE (56);
+            fprintf (f, "// from %d\n", __LINE__);
+            fprintf (f, " switch ((%c & 0xffff) %% %d) {\n", RANVAR, nbcas);
+            for (int ca = 0; ca < nbcas; ca++)
+              fprintf (f, "   case %d: %c %c= %d; break;\n", ca, RANVAR,
+                       "+-^"[DICE (3)], 1 + DICE (1000));
+            fprintf (f, "   default: %c--;\n } //end switch from %d\n",
+                     RANVAR, __LINE__);
+          }
+          break;
         };
       fprintf (f, " dynstep+=%d;\n", i - prevjmpix);
     };
@@ -484,6 +921,77 @@ generate_file (const char *name)
   fprintf (f, "end_%s:\n", name);
   fprintf (f, " say_fun_a_b_c_d(\"%s\", a, b, c, d);\n", name);
   fprintf (f, " return a;\n" "} /* end %s of %d instr */\n", name + 1, l);
+}                               /* end generate_function */
+
+
+/* generate a file containing nbfun randomly coded functions, using
+   the DICE random number generator; return their total size.  A
+   single function is named like the file, ie function genf_A_00 in
+   _genf_A_00.c; with several ones, they are genf_A_00_0, genf_A_00_1,
+   ... and the file exports their table genf_table of genf_table_size
+   functions.  When srcfd is not negative, the code goes into that
+   memfd descriptor instead of the file. */
+int
+generate_file (const char *name, int nbfun, int srcfd)
+{
+  char pathsrc[100];
+  FILE *f = NULL;
+  int l = 0;
+  int totl = 0;
+  memset (pathsrc, 0, sizeof (pathsrc));
+  snprintf (pathsrc, sizeof (pathsrc) - 1, "%s.c", name);
+  if (srcfd >= 0)
+    {
+      int fd = dup (srcfd);
+      f = (fd >= 0) ? fdopen (fd, "w") : NULL;
+    }
+  else
+    f = fopen (pathsrc, "w");
+  if (!f)
+    {
+      perror (pathsrc);
+      exit (EXIT_FAILURE);
+    };
+  if (nbfun <= 1 && batchsize <= 1)
+    {
+      /* random length of generated function */
+      l = random_function_length ();
+      fprintf (f, "/* generated file %s length %d meansize %d*/\n", pathsrc,
+               l, meansize);
+    }
+  else
+    fprintf (f, "/* generated file %s of %d functions meansize %d*/\n",
+             pathsrc, nbfun, meansize);
+  fprintf (f, "extern long dynstep;\n" "extern int tab[%d];\n", MAXTAB);
+  fprintf (f,
+           "extern void say_fun_a_b_c_d(const char*fun, int a, int b, int c, int d);\n");
+  fprintf (f, "const char gentimestamp_%s[] = __DATE__ \"@\" __TIME__;\n",
+           name);
+  if (nbfun <= 1 && batchsize <= 1)
+    {
+      generate_function (f, name, l);
+      totl = l;
+    }
+  else
+    {
+      char funame[NAME_BUFLEN + 16];
+      for (int k = 0; k < nbfun; k++)
+        {
+          l = random_function_length ();
+          snprintf (funame, sizeof (funame), "%s_%d", name, k);
+          fprintf (f, "\n");
+          generate_function (f, funame, l);
+          totl += l;
+        };
+      fprintf (f, "\n" "typedef int genf_fun_t (int, int);\n");
+      fprintf (f, "genf_fun_t *const genf_table[%d] = {\n", nbfun);
+      for (int k = 0; k < nbfun; k++)
+        fprintf (f, "  %s_%d,\n", name + 1, k);
+      fprintf (f, "};\n" "const int genf_table_size = %d;\n", nbfun);
+    };
+  if (dispatch_benchmark)
+    fprintf (f, "\nint %s_leaf (int a, int b)\n"
+             "{ return (a ^ (b * 3)) & 0xffff; }\n", name + 1);
   fprintf (f, "\n\n\n"
            "\n/* file %s was generated by " __FILE__ "*/\n", pathsrc);
   fprintf (f, "\n"              //
@@ -496,8 +1004,8 @@ generate_file (const char *name)
            " *******/\n", name, pluginsuffix);
   fflush (f);
   fclose (f);
-  /* run GNU indent on the generated C code */
-  if (!access (INDENT_PROGRAM, X_OK))
+  /* run GNU indent on the generated C code, it cannot rewrite a memfd */
+  if (srcfd < 0 && !access (INDENT_PROGRAM, X_OK))
     {
       // €Français: le code C généré est indenté par GNU indent.
       char indcmd[128];
@@ -515,7 +1023,7 @@ generate_file (const char *name)
           exit (EXIT_FAILURE);
         };
     }
-  return l;
+  return totl;
 }                               /* end generate_file */
 
 
@@ -556,6 +1064,27 @@ show_help (void)
   printf ("\t -j <job>         : number of jobs, passed to make,"
           " default is %d\n", makenbjobs);
   printf ("\t -m <maker>       : make program, default is %s\n", makeprog);
+  printf ("\t -b <batchsize>   : number of functions per plugin,"
+          " default is %d\n", batchsize);
+  printf ("\t -U <rounds>      : churn, dlclose then regenerate and dlopen\n"
+          "\t                    ... a tenth of the plugins at each round\n");
+  printf ("\t -D               : benchmark calls through pointers, packed\n"
+          "\t                    ... table, direct PLT calls and dlsym\n");
+  printf ("\t -G <profile>     : generator profile, default is %s, among\n",
+          genprofile->gp_name);
+  for (int p = 0; p < NB_GENPROFILES; p++)
+    printf ("\t                    ... %-8s %s\n", genprofiles[p].gp_name,
+            genprofiles[p].gp_descr);
+  printf ("\t -W <sizedist>    : function size distribution, uniform (default),\n"
+          "\t                    ... fixed or bimodal\n");
+  printf ("\t -K <cachedir>    : cache of compiled plugins, by source hash\n");
+  printf ("\t -M <megabytes>   : cache size limit, default is %ld\n",
+          cache_max_megabytes);
+  printf ("\t -L <nbthreads>   : benchmark loading plugins from threads,\n"
+          "\t                    ... RTLD_NOW and RTLD_LAZY, dlopen and dlmopen\n");
+  printf ("\t -P <nbthreads>   : pipelined mode, generate with threads and\n"
+          "\t                    ... compile each file as it appears\n"
+          "\t                    ... with -j jobs and without make\n");
   printf
     ("\t -R <randomseed>  : seed passed to srand48, default is unique\n");
   printf ("\t -S <p.suffix>    : plugin suffix, default is %s\n",
@@ -563,7 +1092,13 @@ show_help (void)
   printf ("\t -T <script>      : terminating popen-ed script\n");
   printf ("\t                    (could be some external analyzer,\n"
           "\t                       ... getting names of generated C files)\n");
+  printf ("\t -X <builddir>    : tmpfs to run in a fresh directory of %s,\n"
+          "\t                    ... memfd to also keep sources and plugins\n"
+          "\t                    ... in memfd_create descriptors\n",
+          BUILDDIR_PARENT);
   printf ("\t -C               : clean up the mess (old _genf_* files)\n");
+  printf ("\t -J <report.json> : JSON report, default is %s\n", reportpath);
+  printf ("\t --compare <old.json> <new.json> : compare two JSON reports\n");
 }                               /* end of show_help */
 
 void
@@ -576,6 +1111,21 @@ show_version (void)
 }                               /* end of show_version */
 
 
+/* the helper files generated besides plugins, like _genf_host.c or
+   _genf_caller.so */
+static bool
+is_helper_file_name (const char *name)
+{
+  static const char *const helpers[] = { HOST_SHIM_NAME, CALLER_NAME };
+  for (unsigned i = 0; i < sizeof (helpers) / sizeof (helpers[0]); i++)
+    {
+      size_t len = strlen (helpers[i]);
+      if (!strncmp (name, helpers[i], len) && name[len] == '.')
+        return true;
+    };
+  return false;
+}                               /* end is_helper_file_name */
+
 void
 cleanup_the_mess (void)
 {
@@ -619,9 +1169,12 @@ cleanup_the_mess (void)
         continue;
       if (curent->d_name[0] == '_'
           && !strncmp (curent->d_name, "_genf_", 6)
-          && sscanf (curent->d_name, "_genf_%c_%d%n", &c, &ix, &pos) >= 2
-          && ix >= 0
-          && pos > 0 && curent->d_name[pos] == '.' && c >= 'A' && c <= 'Z')
+          && ((sscanf (curent->d_name, "_genf_%c_%d%n", &c, &ix, &pos) >= 2
+               && ix >= 0
+               && pos > 0 && curent->d_name[pos] == '.' && c >= 'A'
+               && c <= 'Z')
+              /* helper files like _genf_host.c or _genf_caller.so */
+              || is_helper_file_name (curent->d_name)))
         {
           if (oldnbnames + 1 >= oldnamsiz)
             {                   // should grow oldnamarr
@@ -681,7 +1234,7 @@ get_options (int argc, char **argv)
 {
   bool seeded = false;
   int opt = 0;
-  while ((opt = getopt (argc, argv, "hVCFvn:s:j:m:S:R:T:")) > 0)
+  while ((opt = getopt (argc, argv, "hVCDFvn:s:b:j:G:J:K:L:m:M:P:S:R:T:U:W:X:")) > 0)
     {
       switch (opt)
         {
@@ -694,6 +1247,19 @@ get_options (int argc, char **argv)
         case 'v':               /* verbose */
           verbose = true;
           break;
+        case 'U':               /* churn rounds */
+          churn_rounds = atoi (optarg);
+          if (churn_rounds < 2)
+            {
+              fprintf (stderr,
+                       "%s: churn rounds given by -U should be at least 2\n",
+                       progname);
+              exit (EXIT_FAILURE);
+            };
+          break;
+        case 'D':               /* dispatch benchmark */
+          dispatch_benchmark = true;
+          break;
         case 'F':               /* fake run */
           fakerun = true;
           break;
@@ -724,6 +1290,16 @@ get_options (int argc, char **argv)
               exit (EXIT_FAILURE);
             }
           break;
+        case 'b':               /* batch size */
+          batchsize = atoi (optarg);
+          if (batchsize < 1 || batchsize > MAXIMAL_BATCHSIZE)
+            {
+              fprintf (stderr,
+                       "%s: batch size given by -b should be between 1 and %d\n",
+                       progname, MAXIMAL_BATCHSIZE);
+              exit (EXIT_FAILURE);
+            }
+          break;
         case 'm':               /* make program */
           if (strlen (optarg) < 3 || optarg[0] == '.')
             {
@@ -744,6 +1320,89 @@ get_options (int argc, char **argv)
             }
           pluginsuffix = optarg;
           break;
+        case 'G':               /* generator profile */
+          {
+            int p = 0;
+            while (p < NB_GENPROFILES && strcmp (genprofiles[p].gp_name, optarg))
+              p++;
+            if (p >= NB_GENPROFILES)
+              {
+                fprintf (stderr, "%s: unknown generator profile -G %s\n",
+                         progname, optarg);
+                exit (EXIT_FAILURE);
+              };
+            genprofile = genprofiles + p;
+            genprofile_totweight = 0;
+            for (int sh = 0; sh < SHAPE__LAST; sh++)
+              genprofile_totweight += genprofile->gp_weights[sh];
+          }
+          break;
+        case 'W':               /* size distribution */
+          if (!strcmp (optarg, "uniform"))
+            sizedist = SIZEDIST_UNIFORM;
+          else if (!strcmp (optarg, "fixed"))
+            sizedist = SIZEDIST_FIXED;
+          else if (!strcmp (optarg, "bimodal"))
+            sizedist = SIZEDIST_BIMODAL;
+          else
+            {
+              fprintf (stderr, "%s: unknown size distribution -W %s\n",
+                       progname, optarg);
+              exit (EXIT_FAILURE);
+            };
+          break;
+        case 'X':               /* build directory */
+          if (!strcmp (optarg, "tmpfs"))
+            builddir_mode = BUILDDIR_TMPFS;
+          else if (!strcmp (optarg, "memfd"))
+            builddir_mode = BUILDDIR_MEMFD;
+          else
+            {
+              fprintf (stderr, "%s: unknown build directory -X %s\n",
+                       progname, optarg);
+              exit (EXIT_FAILURE);
+            };
+          break;
+        case 'J':               /* JSON report */
+          reportpath = optarg;
+          break;
+        case 'K':               /* compilation cache */
+          cachedir = optarg;
+          break;
+        case 'M':               /* cache size limit */
+          cache_max_megabytes = atol (optarg);
+          if (cache_max_megabytes < 1)
+            {
+              fprintf (stderr,
+                       "%s: cache size given by -M should be positive\n",
+                       progname);
+              exit (EXIT_FAILURE);
+            };
+          break;
+        case 'L':               /* loader benchmark */
+          loader_nbthreads = atoi (optarg);
+          if (loader_nbthreads < 1
+              || loader_nbthreads > MAXIMAL_LOADER_THREADS)
+            {
+              fprintf (stderr,
+                       "%s: loader threads given by -L %s should be"
+                       " between 1 and %d\n", progname, optarg,
+                       MAXIMAL_LOADER_THREADS);
+              exit (EXIT_FAILURE);
+            };
+          break;
+        case 'P':               /* pipelined mode */
+          pipelined_nbthreads = atoi (optarg);
+          if (pipelined_nbthreads < 1
+              || pipelined_nbthreads > MAXIMAL_GENTHREADS)
+            {
+              fprintf (stderr,
+                       "%s: generator threads given by -P %s should be"
+                       " between 1 and %d\n", progname, optarg,
+                       MAXIMAL_GENTHREADS);
+              exit (EXIT_FAILURE);
+            };
+          break;
         case 'R':
           random_seed = atol (optarg);
           seeded = true;
@@ -764,6 +1423,24 @@ get_options (int argc, char **argv)
           exit (EXIT_FAILURE);
         }
     };
+  if (builddir_mode == BUILDDIR_MEMFD)
+    {
+      /* memfd plugins are compiled without make, and not hard-linked */
+      if (cachedir)
+        {
+          fprintf (stderr, "%s: -X memfd is incompatible with -K\n",
+                   progname);
+          exit (EXIT_FAILURE);
+        };
+      if (terminatingscript)
+        {
+          fprintf (stderr, "%s: -X memfd leaves no files for -T\n",
+                   progname);
+          exit (EXIT_FAILURE);
+        };
+      if (pipelined_nbthreads == 0)
+        pipelined_nbthreads = 1;
+    };
   if (seeded)
     srand48 (random_seed);
   else
@@ -773,6 +1450,7 @@ get_options (int argc, char **argv)
         perror ("time");
       long l = ((long) getpid ()) ^ ((long) t);
       srand48 (l);
+      random_seed = l;
     }
 }                               /* end get_options */
 
@@ -786,124 +1464,860 @@ generate_all_c_files (void)
   double startcpuclock = my_clock (CLOCK_PROCESS_CPUTIME_ID);
   printf
     ("%s (git %s, pid %d on %s) start generating %d C files of mean size %d\n",
-     progname, MANYDL_GIT, (int) getpid (), myhostname, maxcnt, meansize);
+     progname, MANYDL_GIT, (int) getpid (), myhostname, nb_plugins (),
+     meansize);
   fflush (NULL);
-  int p = 1 + (((int) sqrt (maxcnt + maxcnt / 8)) | 0x1f);
-  for (int ix = 0; ix < maxcnt; ix++)
+  int nbplugins = nb_plugins ();
+  int p = 1 + (((int) sqrt (nbplugins + nbplugins / 8)) | 0x1f);
+  for (int ix = 0; ix < nbplugins; ix++)
     {
       char curname[64];
       memset (curname, 0, sizeof (curname));
       compute_name_for_index (curname, ix);
-      generate_file (curname);
+      generate_file (curname, plugin_function_count (ix), -1);
       if (verbose && ix % p == 0 && ix > 10)
         {
           double curelapsedclock = my_clock (CLOCK_MONOTONIC);
           double curcpuclock = my_clock (CLOCK_PROCESS_CPUTIME_ID);
           printf
             ("%s: %d generated C files out of %d (so %.2f %%) in %.3f elapsed, %.3f cpu sec\n",
-             progname, ix, maxcnt, (100.0 * ix) / maxcnt,
+             progname, ix, nbplugins, (100.0 * ix) / nbplugins,
              curelapsedclock - startelapsedclock,
              curcpuclock - startcpuclock);
           fflush (NULL);
-          sync ();
+          if (builddir_mode == BUILDDIR_CWD)
+            sync ();
         };
     }
   generate_elapsed_clock = my_clock (CLOCK_MONOTONIC);
   generate_cpu_clock = my_clock (CLOCK_PROCESS_CPUTIME_ID);
   printf ("%s generated %d C files in %.3f elapsed sec (%.4f / file)\n",
-          progname, maxcnt, generate_elapsed_clock - start_elapsed_clock,
-          (generate_elapsed_clock - start_elapsed_clock) / (double) maxcnt);
+          progname, nbplugins, generate_elapsed_clock - start_elapsed_clock,
+          (generate_elapsed_clock - start_elapsed_clock) / (double) nbplugins);
   printf ("%s generated %d C files in %.3f CPU sec (%.4f / file)\n",
-          progname, maxcnt, generate_cpu_clock - start_cpu_clock,
-          (generate_cpu_clock - start_cpu_clock) / (double) maxcnt);
+          progname, nbplugins, generate_cpu_clock - start_cpu_clock,
+          (generate_cpu_clock - start_cpu_clock) / (double) nbplugins);
   fflush (NULL);
 }                               /* end generate_all_c_files */
 
-// €Français: compilation parallèle en des greffons de tous les
-// fichiers C générés _genf*.c
-void
-compile_all_plugins (void)
+/***** €Français: cache des greffons compilés (option -K).
+ *
+ * A plugin is cached as <cachedir>/<key><pluginsuffix> where the key
+ * is the 128 bits FNV-1a hash of its generated source, of the
+ * compiler identity and of GENF_CFLAGS.  A hit hard-links the cached
+ * plugin in place and touches it, so its modification time is its
+ * last use for the LRU trimming done at exit.
+ *****/
+
+typedef unsigned __int128 cachekey_t;
+
+#define FNV128_OFFSET \
+  (((cachekey_t) 0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL)
+#define FNV128_PRIME (((cachekey_t) 1 << 88) | 0x13b)
+
+cachekey_t *cache_keys;         /* by plugin index */
+cachekey_t cache_compiler_key;  /* hash of compiler and flags */
+long cache_nbhits, cache_nbmisses, cache_nbstored, cache_nbevicted;
+
+static cachekey_t
+fnv128_update (cachekey_t h, const void *data, size_t len)
 {
-  char buildcmd[256];
-  struct rusage uscompil = { };
-  double childcpuclock = 0.0;
-  memset (buildcmd, 0, sizeof (buildcmd));
-  snprintf (buildcmd, sizeof (buildcmd) - 2,
-            "%s -j%d CC='%s' manydl-plugins",
-            makeprog, makenbjobs, manydl_gcc);
-  printf ("%s start compiling %d plugins\n", progname, maxcnt);
-  fflush (NULL);
-  printf ("%s will do for %d plugins: %s\n", progname, maxcnt, buildcmd);
-  fflush (NULL);
-  int buildcode = system (buildcmd);
-  if (buildcode > 0)
+  const unsigned char *p = data;
+  for (size_t i = 0; i < len; i++)
     {
-      fprintf (stderr, "%s failed to run: %s (%d)\n",
-               progname, buildcmd, buildcode);
+      h ^= p[i];
+      h *= FNV128_PRIME;
     };
-  if (!getrusage (RUSAGE_CHILDREN, &uscompil))
-    {
-      childcpuclock =
-        ((double) uscompil.ru_utime.tv_sec +
-         1.0e-6 * uscompil.ru_utime.tv_usec) +
-        ((double) uscompil.ru_stime.tv_sec +
-         1.0e-6 * uscompil.ru_stime.tv_usec);
-    }
-  compile_elapsed_clock = my_clock (CLOCK_MONOTONIC);
-  compile_cpu_clock = my_clock (CLOCK_PROCESS_CPUTIME_ID) + childcpuclock;
-  printf ("%s compiled %d C files in %.3f elapsed sec (%.4f / file)\n",
-          progname, maxcnt, compile_elapsed_clock - generate_elapsed_clock,
-          (compile_elapsed_clock - generate_elapsed_clock) / (double) maxcnt);
-  printf ("%s compiled %d C files in %.3f CPU sec (%.4f / file)\n",
-          progname, maxcnt, compile_cpu_clock - generate_cpu_clock,
-          (compile_cpu_clock - generate_cpu_clock) / (double) maxcnt);
-}                               /* end compile_all_plugins */
+  return h;
+}                               /* end fnv128_update */
 
-
-
-// €Français: chargement des tous les greffons _genf_*.so; pour le
-// fichier généré _genf_D_52.c on charge dynamiquement _genf_D_52.so
-// contenant la fonction int genf_D_52(int a, int b)
-void
-dlopen_all_plugins (void)
+/* the compiler identity is its name, the size and modification time
+   of its executable found in $PATH, and the flags */
+static void
+cache_initialize (void)
 {
-  double startelapsedclock = my_clock (CLOCK_MONOTONIC);
-  double startcpuclock = my_clock (CLOCK_PROCESS_CPUTIME_ID);
-  hdlarr = calloc ((size_t) maxcnt, sizeof (void *));
-  if (!hdlarr)
+  char ident[512];
+  struct stat st = { };
+  const char *path = getenv ("PATH");
+  if (mkdir (cachedir, 0750) && errno != EEXIST)
     {
-      fprintf (stderr, "%s: failed to calloc hdlarr for %d plugins (%s)\n",
-               progname, maxcnt, strerror (errno));
+      fprintf (stderr, "%s: cannot create cache directory %s (%s)\n",
+               progname, cachedir, strerror (errno));
       exit (EXIT_FAILURE);
     };
-  namarr = calloc ((size_t) maxcnt, sizeof (char *));
-  if (!namarr)
+  if (strchr (manydl_gcc, '/'))
+    stat (manydl_gcc, &st);
+  else
+    while (path && *path)
+      {
+        const char *colon = strchr (path, ':');
+        int len = colon ? (int) (colon - path) : (int) strlen (path);
+        snprintf (ident, sizeof (ident), "%.*s/%s", len, path, manydl_gcc);
+        if (!stat (ident, &st))
+          break;
+        path = colon ? colon + 1 : NULL;
+      };
+  snprintf (ident, sizeof (ident), "%s:%ld:%ld:%s:%s", manydl_gcc,
+            (long) st.st_size, (long) st.st_mtime, manydl_genf_cflags,
+            pluginsuffix);
+  cache_compiler_key = fnv128_update (FNV128_OFFSET, ident, strlen (ident));
+  cache_keys = calloc (nb_plugins (), sizeof (cachekey_t));
+  if (!cache_keys)
     {
-      fprintf (stderr, "%s: failed to calloc namarr for %d plugins (%s)\n",
-               progname, maxcnt, strerror (errno));
+      fprintf (stderr, "%s: failed to calloc %d cache keys (%s)\n",
+               progname, nb_plugins (), strerror (errno));
       exit (EXIT_FAILURE);
-    }
-  funarr = calloc ((size_t) maxcnt, sizeof (funptr_t));
-  if (!funarr)
+    };
+}                               /* end cache_initialize */
+
+static void
+cache_path (char *buf, size_t siz, cachekey_t key)
+{
+  snprintf (buf, siz, "%s/%016llx%016llx%s", cachedir,
+            (unsigned long long) (key >> 64), (unsigned long long) key,
+            pluginsuffix);
+}                               /* end cache_path */
+
+/// copy a file, when hard links are impossible across file systems
+static int
+copy_file (const char *src, const char *dst)
+{
+  char buf[16384];
+  ssize_t n = 0;
+  int ok = 0;
+  int fdin = open (src, O_RDONLY);
+  if (fdin < 0)
+    return -1;
+  int fdout = open (dst, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+  if (fdout < 0)
     {
-      fprintf (stderr,
-               "%s: failed to calloc funarr for %d function pointers (%s)\n",
-               progname, maxcnt, strerror (errno));
-      exit (EXIT_FAILURE);
-    }
-  printf ("%s start dlopen-ing %d plugins\n", progname, maxcnt);
-  fflush (NULL);
-  fflush (NULL);
-  for (int ix = 0; ix < maxcnt; ix++)
+      close (fdin);
+      return -1;
+    };
+  while ((n = read (fdin, buf, sizeof (buf))) > 0)
+    if (write (fdout, buf, n) != n)
+      {
+        ok = -1;
+        break;
+      };
+  if (n < 0)
+    ok = -1;
+  close (fdin);
+  if (close (fdout))
+    ok = -1;
+  return ok;
+}                               /* end copy_file */
+
+/* compute the cache key of the generated file of index ix, and on a
+   hit put the cached plugin in place; return true on hits.  Called
+   from generator threads. */
+bool
+cache_lookup_plugin (int ix)
+{
+  char curname[NAME_BUFLEN];
+  char srcpath[NAME_BUFLEN + 8];
+  char sopath[NAME_BUFLEN + 16];
+  char cachedpath[512];
+  char buf[16384];
+  ssize_t n = 0;
+  cachekey_t key = cache_compiler_key;
+  compute_name_for_index (curname, ix);
+  snprintf (srcpath, sizeof (srcpath), "%s.c", curname);
+  snprintf (sopath, sizeof (sopath), "%s%s", curname, pluginsuffix);
+  int fd = open (srcpath, O_RDONLY);
+  if (fd < 0)
     {
-      char curname[64];
-      memset (curname, 0, sizeof (curname));
-      char pluginpath[96];
-      memset (pluginpath, 0, sizeof (pluginpath));
+      fprintf (stderr, "%s: cannot open %s for the cache (%s)\n",
+               progname, srcpath, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  while ((n = read (fd, buf, sizeof (buf))) > 0)
+    key = fnv128_update (key, buf, n);
+  close (fd);
+  cache_keys[ix] = key;
+  cache_path (cachedpath, sizeof (cachedpath), key);
+  if (access (cachedpath, R_OK))
+    {
+      __atomic_fetch_add (&cache_nbmisses, 1, __ATOMIC_RELAXED);
+      return false;
+    };
+  unlink (sopath);
+  if (link (cachedpath, sopath) && copy_file (cachedpath, sopath))
+    {
+      __atomic_fetch_add (&cache_nbmisses, 1, __ATOMIC_RELAXED);
+      return false;
+    };
+  /// the cached plugin is now the most recently used, and newer than
+  /// its source for make
+  utimensat (AT_FDCWD, cachedpath, NULL, 0);
+  utimensat (AT_FDCWD, sopath, NULL, 0);
+  __atomic_fetch_add (&cache_nbhits, 1, __ATOMIC_RELAXED);
+  return true;
+}                               /* end cache_lookup_plugin */
+
+/// store into the cache the freshly compiled plugin of index ix
+void
+cache_store_plugin (int ix)
+{
+  char curname[NAME_BUFLEN];
+  char sopath[NAME_BUFLEN + 16];
+  char cachedpath[512];
+  char tmppath[600];
+  compute_name_for_index (curname, ix);
+  snprintf (sopath, sizeof (sopath), "%s%s", curname, pluginsuffix);
+  cache_path (cachedpath, sizeof (cachedpath), cache_keys[ix]);
+  if (!link (sopath, cachedpath) || errno == EEXIST)
+    {
+      cache_nbstored++;
+      return;
+    };
+  snprintf (tmppath, sizeof (tmppath), "%s.tmp%d", cachedpath,
+            (int) getpid ());
+  if (copy_file (sopath, tmppath) || rename (tmppath, cachedpath))
+    {
+      fprintf (stderr, "%s: failed to cache %s as %s (%s)\n",
+               progname, sopath, cachedpath, strerror (errno));
+      unlink (tmppath);
+      return;
+    };
+  cache_nbstored++;
+}                               /* end cache_store_plugin */
+
+struct cachent_st
+{
+  char *ce_name;
+  off_t ce_size;
+  double ce_mtime;
+};
+
+static int
+cmp_cachent_mtime (const void *p1, const void *p2)
+{
+  const struct cachent_st *e1 = p1, *e2 = p2;
+  return (e1->ce_mtime > e2->ce_mtime) - (e1->ce_mtime < e2->ce_mtime);
+}                               /* end cmp_cachent_mtime */
+
+/* remove the least recently used cached plugins above the size cap,
+   and print the cache statistics */
+void
+cache_trim (void)
+{
+  struct cachent_st *ents = NULL;
+  int nbents = 0, sizents = 0;
+  long long totsize = 0;
+  long long maxsize = (long long) cache_max_megabytes << 20;
+  char path[600];
+  struct dirent *de = NULL;
+  DIR *dir = opendir (cachedir);
+  if (!dir)
+    return;
+  while ((de = readdir (dir)) != NULL)
+    {
+      struct stat st = { };
+      size_t len = strlen (de->d_name);
+      size_t suflen = strlen (pluginsuffix);
+      if (de->d_name[0] == '.' || len <= suflen
+          || strcmp (de->d_name + len - suflen, pluginsuffix))
+        continue;
+      snprintf (path, sizeof (path), "%s/%s", cachedir, de->d_name);
+      if (stat (path, &st) || !S_ISREG (st.st_mode))
+        continue;
+      if (nbents >= sizents)
+        {
+          sizents = 2 * sizents + 64;
+          ents = realloc (ents, sizents * sizeof (struct cachent_st));
+          if (!ents)
+            {
+              fprintf (stderr, "%s: failed to grow cache entries (%s)\n",
+                       progname, strerror (errno));
+              exit (EXIT_FAILURE);
+            };
+        };
+      ents[nbents].ce_name = strdup (de->d_name);
+      ents[nbents].ce_size = st.st_size;
+      ents[nbents].ce_mtime = st.st_mtim.tv_sec + 1.0e-9 * st.st_mtim.tv_nsec;
+      totsize += st.st_size;
+      nbents++;
+    };
+  closedir (dir);
+  qsort (ents, nbents, sizeof (struct cachent_st), cmp_cachent_mtime);
+  for (int e = 0; e < nbents; e++)
+    {
+      if (totsize > maxsize)
+        {
+          snprintf (path, sizeof (path), "%s/%s", cachedir, ents[e].ce_name);
+          if (!unlink (path))
+            {
+              totsize -= ents[e].ce_size;
+              cache_nbevicted++;
+            };
+        };
+      free (ents[e].ce_name);
+    };
+  free (ents);
+  printf ("%s: cache %s has %lld kB after %ld hits, %ld misses,"
+          " %ld stored, %ld evicted (hit rate %.1f %%)\n",
+          progname, cachedir, totsize >> 10, cache_nbhits, cache_nbmisses,
+          cache_nbstored, cache_nbevicted,
+          (cache_nbhits + cache_nbmisses) > 0
+          ? 100.0 * cache_nbhits / (cache_nbhits + cache_nbmisses) : 0.0);
+  fflush (NULL);
+}                               /* end cache_trim */
+
+// €Français: compilation parallèle en des greffons de tous les
+// fichiers C générés _genf*.c
+void
+compile_all_plugins (void)
+{
+  char buildcmd[256 + sizeof (startcwd)];
+  struct rusage uscompil = { };
+  double childcpuclock = 0.0;
+  int nbplugins = nb_plugins ();
+  memset (buildcmd, 0, sizeof (buildcmd));
+  if (builddir_mode == BUILDDIR_CWD)
+    snprintf (buildcmd, sizeof (buildcmd) - 2,
+              "%s -j%d CC='%s' manydl-plugins",
+              makeprog, makenbjobs, manydl_gcc);
+  else                          /* the GNUmakefile stayed in startcwd */
+    snprintf (buildcmd, sizeof (buildcmd) - 2,
+              "%s -f '%s/GNUmakefile' -j%d CC='%s' manydl-plugins",
+              makeprog, startcwd, makenbjobs, manydl_gcc);
+  bool *cached = NULL;
+  printf ("%s start compiling %d plugins\n", progname, nbplugins);
+  fflush (NULL);
+  if (cachedir)
+    {
+      cached = calloc (nbplugins, sizeof (bool));
+      if (!cached)
+        {
+          fprintf (stderr, "%s: failed to calloc cache flags (%s)\n",
+                   progname, strerror (errno));
+          exit (EXIT_FAILURE);
+        };
+      for (int ix = 0; ix < nbplugins; ix++)
+        cached[ix] = cache_lookup_plugin (ix);
+    };
+  printf ("%s will do for %d plugins: %s\n", progname, nbplugins, buildcmd);
+  fflush (NULL);
+  int buildcode = system (buildcmd);
+  if (buildcode > 0)
+    {
+      fprintf (stderr, "%s failed to run: %s (%d)\n",
+               progname, buildcmd, buildcode);
+    };
+  if (cachedir)
+    {
+      for (int ix = 0; ix < nbplugins; ix++)
+        if (!cached[ix])
+          cache_store_plugin (ix);
+      free (cached);
+    };
+  if (!getrusage (RUSAGE_CHILDREN, &uscompil))
+    {
+      childcpuclock =
+        ((double) uscompil.ru_utime.tv_sec +
+         1.0e-6 * uscompil.ru_utime.tv_usec) +
+        ((double) uscompil.ru_stime.tv_sec +
+         1.0e-6 * uscompil.ru_stime.tv_usec);
+    }
+  compile_elapsed_clock = my_clock (CLOCK_MONOTONIC);
+  compile_cpu_clock = my_clock (CLOCK_PROCESS_CPUTIME_ID) + childcpuclock;
+  compile_children_cpu = childcpuclock;
+  printf ("%s compiled %d C files in %.3f elapsed sec (%.4f / file)\n",
+          progname, nbplugins, compile_elapsed_clock - generate_elapsed_clock,
+          (compile_elapsed_clock -
+           generate_elapsed_clock) / (double) nbplugins);
+  printf ("%s compiled %d C files in %.3f CPU sec (%.4f / file)\n",
+          progname, nbplugins, compile_cpu_clock - generate_cpu_clock,
+          (compile_cpu_clock - generate_cpu_clock) / (double) nbplugins);
+}                               /* end compile_all_plugins */
+
+
+
+/***** €Français: temps de compilation de chaque greffon, mesuré par
+ * le serveur de tâches du mode en pipeline.
+ *
+ * The generated size (number of statements) and the compilation
+ * time of each plugin show which profiles make the compiler
+ * superlinear: the exponent of the least squares fit of log(cpu)
+ * against log(size) is 1 for linear compilation.
+ *****/
+
+struct plugstat_st
+{
+  int ps_gensize;               /* generated statements */
+  double ps_compile_elapsed;
+  double ps_compile_cpu;        /* from the rusage of wait4 */
+};
+
+struct plugstat_st *plugin_stats;       /* by plugin index, with -P */
+double compile_size_exponent = NAN;
+
+#define COMPILE_SCALING_BUCKETS 5
+
+static int
+cmp_plugstat_size (const void *p1, const void *p2)
+{
+  const struct plugstat_st *s1 = p1, *s2 = p2;
+  return (s1->ps_gensize > s2->ps_gensize) - (s1->ps_gensize < s2->ps_gensize);
+}                               /* end cmp_plugstat_size */
+
+// €Français: coût de compilation selon la taille du code généré
+void
+report_compile_scaling (void)
+{
+  int nbplugins = nb_plugins ();
+  int nbstat = 0;
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  struct plugstat_st *sorted = calloc (nbplugins, sizeof (*sorted));
+  if (!sorted)
+    return;
+  /// compiled plugins only, cached ones have no compilation time
+  for (int ix = 0; ix < nbplugins; ix++)
+    if (plugin_stats[ix].ps_compile_cpu > 0.0
+        && plugin_stats[ix].ps_gensize > 0)
+      sorted[nbstat++] = plugin_stats[ix];
+  if (nbstat < 2)
+    {
+      free (sorted);
+      return;
+    };
+  for (int i = 0; i < nbstat; i++)
+    {
+      double x = log (sorted[i].ps_gensize);
+      double y = log (sorted[i].ps_compile_cpu);
+      sx += x, sy += y, sxx += x * x, sxy += x * y;
+    };
+  if (nbstat * sxx - sx * sx > 0.0)
+    compile_size_exponent = (nbstat * sxy - sx * sy)
+      / (nbstat * sxx - sx * sx);
+  qsort (sorted, nbstat, sizeof (*sorted), cmp_plugstat_size);
+  printf ("%s compilation with profile %s and %s sizes of %d plugins:"
+          " cpu ~ size^%.2f\n", progname, genprofile->gp_name,
+          sizedist_names[sizedist], nbstat, compile_size_exponent);
+  printf ("# %9s %12s %12s %12s\n", "size", "cpu ms", "elapsed ms",
+          "cpu µs/stmt");
+  for (int b = 0; b < COMPILE_SCALING_BUCKETS; b++)
+    {
+      int lo = (int) ((long) nbstat * b / COMPILE_SCALING_BUCKETS);
+      int hi = (int) ((long) nbstat * (b + 1) / COMPILE_SCALING_BUCKETS);
+      double size = 0, cpu = 0, elapsed = 0;
+      if (hi <= lo)
+        continue;
+      for (int i = lo; i < hi; i++)
+        {
+          size += sorted[i].ps_gensize;
+          cpu += sorted[i].ps_compile_cpu;
+          elapsed += sorted[i].ps_compile_elapsed;
+        };
+      printf ("  %9.0f %12.2f %12.2f %12.2f\n", size / (hi - lo),
+              1.0e3 * cpu / (hi - lo), 1.0e3 * elapsed / (hi - lo),
+              1.0e6 * cpu / size);
+    };
+  fflush (NULL);
+  free (sorted);
+}                               /* end report_compile_scaling */
+
+
+/***** €Français: mode en pipeline (option -P), la génération et la
+ * compilation se recouvrent.
+ *
+ * In pipelined mode, generator threads claim the next file index,
+ * generate its C file and push the index into a bounded queue.  The
+ * main thread is a job server popping indexes and spawning at most
+ * makenbjobs compilations with posix_spawnp, without make or system.
+ *****/
+
+struct genqueue_st
+{
+  pthread_mutex_t gq_mtx;
+  pthread_cond_t gq_notfull;
+  pthread_cond_t gq_notempty;
+  int *gq_ring;                 /* ring buffer of file indexes */
+  int gq_size, gq_head, gq_count;
+  int gq_nextix;                /* next file index to generate */
+  int gq_nbgenerated;
+  int gq_nbcached;              /* plugins found in the cache */
+  int gq_nbgenthreads;          /* still running generator threads */
+  double gq_firstgen, gq_lastgen;       /* elapsed clocks */
+};
+
+struct genqueue_st genqueue = {
+  .gq_mtx = PTHREAD_MUTEX_INITIALIZER,
+  .gq_notfull = PTHREAD_COND_INITIALIZER,
+  .gq_notempty = PTHREAD_COND_INITIALIZER,
+};
+
+/// a running compilation of the job server
+struct genjob_st
+{
+  pid_t gj_pid;
+  int gj_ix;
+  double gj_start;
+};
+
+/// the program environment, for posix_spawnp
+extern char **environ;
+
+static void *
+pipelined_generator (void *arg)
+{
+  struct drand48_data randstate;
+  (void) arg;
+  gen_randstate = &randstate;
+  for (;;)
+    {
+      char curname[NAME_BUFLEN];
+      int ix = __atomic_fetch_add (&genqueue.gq_nextix, 1, __ATOMIC_RELAXED);
+      if (ix >= nb_plugins ())
+        break;
+      memset (&randstate, 0, sizeof (randstate));
+      srand48_r (random_seed * 1000003L + ix, &randstate);
       compute_name_for_index (curname, ix);
+      if (builddir_mode == BUILDDIR_MEMFD)
+        open_plugin_memfds (ix);
+      plugin_stats[ix].ps_gensize =
+        generate_file (curname, plugin_function_count (ix),
+                       memfd_src ? memfd_src[ix] : -1);
+      if (cachedir && cache_lookup_plugin (ix))
+        {
+          pthread_mutex_lock (&genqueue.gq_mtx);
+          genqueue.gq_nbgenerated++;
+          genqueue.gq_nbcached++;
+          genqueue.gq_lastgen = my_clock (CLOCK_MONOTONIC);
+          pthread_cond_signal (&genqueue.gq_notempty);
+          pthread_mutex_unlock (&genqueue.gq_mtx);
+          continue;
+        };
+      pthread_mutex_lock (&genqueue.gq_mtx);
+      while (genqueue.gq_count >= genqueue.gq_size)
+        pthread_cond_wait (&genqueue.gq_notfull, &genqueue.gq_mtx);
+      genqueue.gq_ring[(genqueue.gq_head + genqueue.gq_count)
+                       % genqueue.gq_size] = ix;
+      genqueue.gq_count++;
+      genqueue.gq_nbgenerated++;
+      genqueue.gq_lastgen = my_clock (CLOCK_MONOTONIC);
+      pthread_cond_signal (&genqueue.gq_notempty);
+      pthread_mutex_unlock (&genqueue.gq_mtx);
+    };
+  pthread_mutex_lock (&genqueue.gq_mtx);
+  genqueue.gq_nbgenthreads--;
+  pthread_cond_signal (&genqueue.gq_notempty);
+  pthread_mutex_unlock (&genqueue.gq_mtx);
+  return NULL;
+}                               /* end pipelined_generator */
+
+/* spawn "$CC $GENF_CFLAGS -shared -o sopath srcpath", return its
+   pid.  When srcfd and sofd are memfd descriptors, the paths are
+   their /proc/self/fd/ names and the child inherits them. */
+static pid_t
+spawn_compilation (const char *srcpath, const char *sopath,
+                   int srcfd, int sofd)
+{
+  char cflags[sizeof (manydl_genf_cflags)];
+  char *args[32];
+  int nbargs = 0;
+  pid_t pid = 0;
+  posix_spawn_file_actions_t fileacts;
+  posix_spawn_file_actions_t *pfileacts = NULL;
+  if (srcfd >= 0 && sofd >= 0)
+    {
+      /* a dup2 onto itself clears the close-on-exec flag in the child */
+      posix_spawn_file_actions_init (&fileacts);
+      posix_spawn_file_actions_adddup2 (&fileacts, srcfd, srcfd);
+      posix_spawn_file_actions_adddup2 (&fileacts, sofd, sofd);
+      pfileacts = &fileacts;
+    };
+  memcpy (cflags, manydl_genf_cflags, sizeof (cflags));
+  args[nbargs++] = (char *) manydl_gcc;
+  for (char *sav = NULL, *tok = strtok_r (cflags, " \t", &sav);
+       tok != NULL && nbargs < 26; tok = strtok_r (NULL, " \t", &sav))
+    args[nbargs++] = tok;
+  args[nbargs++] = "-shared";
+  args[nbargs++] = "-o";
+  args[nbargs++] = (char *) sopath;
+  if (pfileacts)
+    {
+      /* no .c suffix in /proc/self/fd/N */
+      args[nbargs++] = "-x";
+      args[nbargs++] = "c";
+    };
+  args[nbargs++] = (char *) srcpath;
+  args[nbargs] = NULL;
+  int err = posix_spawnp (&pid, manydl_gcc, pfileacts, NULL, args, environ);
+  if (pfileacts)
+    posix_spawn_file_actions_destroy (pfileacts);
+  if (err)
+    {
+      fprintf (stderr, "%s: failed to spawn %s for %s (%s)\n",
+               progname, manydl_gcc, srcpath, strerror (err));
+      exit (EXIT_FAILURE);
+    };
+  if (verbose)
+    printf ("%s: spawned %s for %s as pid %d\n", progname, manydl_gcc,
+            srcpath, (int) pid);
+  return pid;
+}                               /* end spawn_compilation */
+
+/* spawn the compilation of the generated file of index ix into its
+   plugin */
+static pid_t
+spawn_plugin_compilation (int ix)
+{
+  char srcpath[NAME_BUFLEN + 8];
+  char sopath[NAME_BUFLEN + 16];
+  source_path (srcpath, sizeof (srcpath), ix);
+  plugin_path (sopath, sizeof (sopath), ix);
+  if (memfd_src)
+    return spawn_compilation (srcpath, sopath, memfd_src[ix], memfd_so[ix]);
+  return spawn_compilation (srcpath, sopath, -1, -1);
+}                               /* end spawn_plugin_compilation */
+
+// €Français: génération et compilation en pipeline
+void
+generate_and_compile_pipelined (void)
+{
+  pthread_t genthreads[MAXIMAL_GENTHREADS];
+  struct genjob_st *jobs = NULL;
+  struct rusage uscompil = { };
+  double childcpuclock = 0.0;
+  double firstspawn = NAN, lastreap = NAN;
+  int nbrunning = 0, nbcompiled = 0, nbfailed = 0;
+  int nbplugins = nb_plugins ();
+  double startelapsedclock = my_clock (CLOCK_MONOTONIC);
+  printf
+    ("%s (git %s, pid %d on %s) start pipelined generation of %d C files"
+     " of mean size %d with %d threads and %d compilation jobs\n",
+     progname, MANYDL_GIT, (int) getpid (), myhostname, nbplugins, meansize,
+     pipelined_nbthreads, makenbjobs);
+  fflush (NULL);
+  if (makenbjobs < 1)
+    makenbjobs = 1;
+  genqueue.gq_size = 4 * makenbjobs;
+  genqueue.gq_ring = calloc (genqueue.gq_size, sizeof (int));
+  jobs = calloc (makenbjobs, sizeof (struct genjob_st));
+  if (!genqueue.gq_ring || !jobs)
+    {
+      fprintf (stderr, "%s: failed to calloc the pipeline queue (%s)\n",
+               progname, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  plugin_stats = calloc (nbplugins, sizeof (struct plugstat_st));
+  if (!plugin_stats)
+    {
+      fprintf (stderr, "%s: failed to calloc plugin statistics (%s)\n",
+               progname, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  genqueue.gq_firstgen = startelapsedclock;
+  genqueue.gq_nbgenthreads = pipelined_nbthreads;
+  for (int t = 0; t < pipelined_nbthreads; t++)
+    {
+      int err = pthread_create (genthreads + t, NULL, pipelined_generator,
+                                NULL);
+      if (err)
+        {
+          fprintf (stderr, "%s: failed to create generator thread#%d (%s)\n",
+                   progname, t, strerror (err));
+          exit (EXIT_FAILURE);
+        };
+    };
+  /// the job server loop
+  pthread_mutex_lock (&genqueue.gq_mtx);
+  while (nbcompiled + nbfailed + genqueue.gq_nbcached < nbplugins)
+    {
+      while (nbrunning < makenbjobs && genqueue.gq_count > 0)
+        {
+          int ix = genqueue.gq_ring[genqueue.gq_head];
+          genqueue.gq_head = (genqueue.gq_head + 1) % genqueue.gq_size;
+          genqueue.gq_count--;
+          pthread_cond_signal (&genqueue.gq_notfull);
+          pthread_mutex_unlock (&genqueue.gq_mtx);
+          jobs[nbrunning].gj_ix = ix;
+          jobs[nbrunning].gj_start = my_clock (CLOCK_MONOTONIC);
+          jobs[nbrunning].gj_pid = spawn_plugin_compilation (ix);
+          if (isnan (firstspawn))
+            firstspawn = jobs[nbrunning].gj_start;
+          nbrunning++;
+          pthread_mutex_lock (&genqueue.gq_mtx);
+        };
+      pthread_mutex_unlock (&genqueue.gq_mtx);
+      /* reap only our own compilations: generator threads may have
+         children too, e.g. indent run by system */
+      bool reaped = false;
+      for (int j = 0; j < nbrunning; j++)
+        {
+          int status = 0;
+          struct rusage ru = { };
+          pid_t pid = wait4 (jobs[j].gj_pid, &status, WNOHANG, &ru);
+          if (pid <= 0)
+            continue;
+          reaped = true;
+          lastreap = my_clock (CLOCK_MONOTONIC);
+          if (WIFEXITED (status) && WEXITSTATUS (status) == 0)
+            {
+              struct plugstat_st *ps = plugin_stats + jobs[j].gj_ix;
+              ps->ps_compile_elapsed = lastreap - jobs[j].gj_start;
+              ps->ps_compile_cpu =
+                ru.ru_utime.tv_sec + 1.0e-6 * ru.ru_utime.tv_usec
+                + ru.ru_stime.tv_sec + 1.0e-6 * ru.ru_stime.tv_usec;
+              nbcompiled++;
+              if (cachedir)
+                cache_store_plugin (jobs[j].gj_ix);
+            }
+          else
+            {
+              char curname[NAME_BUFLEN];
+              compute_name_for_index (curname, jobs[j].gj_ix);
+              fprintf (stderr, "%s: compilation of %s.c failed (status %#x)\n",
+                       progname, curname, status);
+              nbfailed++;
+            };
+          jobs[j] = jobs[--nbrunning];
+          j--;
+        };
+      pthread_mutex_lock (&genqueue.gq_mtx);
+      if (!reaped && (nbrunning >= makenbjobs || genqueue.gq_count == 0))
+        {
+          /// wait for a generated file, or poll the compilations
+          struct timespec ts = { 0, 0 };
+          clock_gettime (CLOCK_REALTIME, &ts);
+          ts.tv_nsec += 1000000;
+          if (ts.tv_nsec >= 1000000000)
+            ts.tv_sec++, ts.tv_nsec -= 1000000000;
+          pthread_cond_timedwait (&genqueue.gq_notempty, &genqueue.gq_mtx,
+                                  &ts);
+        };
+    };
+  pthread_mutex_unlock (&genqueue.gq_mtx);
+  for (int t = 0; t < pipelined_nbthreads; t++)
+    pthread_join (genthreads[t], NULL);
+  free (genqueue.gq_ring), genqueue.gq_ring = NULL;
+  free (jobs), jobs = NULL;
+  if (!getrusage (RUSAGE_CHILDREN, &uscompil))
+    childcpuclock =
+      ((double) uscompil.ru_utime.tv_sec +
+       1.0e-6 * uscompil.ru_utime.tv_usec) +
+      ((double) uscompil.ru_stime.tv_sec + 1.0e-6 * uscompil.ru_stime.tv_usec);
+  if (isnan (firstspawn))       /* every plugin was cached */
+    firstspawn = lastreap = genqueue.gq_lastgen;
+  generate_elapsed_clock = genqueue.gq_lastgen;
+  generate_cpu_clock = my_clock (CLOCK_PROCESS_CPUTIME_ID);
+  compile_elapsed_clock = lastreap;
+  compile_cpu_clock = generate_cpu_clock + childcpuclock;
+  compile_children_cpu = childcpuclock;
+  double overlap = genqueue.gq_lastgen - firstspawn;
+  if (overlap < 0.0)
+    overlap = 0.0;
+  printf ("%s pipelined generation of %d C files in %.3f elapsed sec"
+          " (%.4f / file)\n", progname, nbplugins,
+          genqueue.gq_lastgen - genqueue.gq_firstgen,
+          (genqueue.gq_lastgen - genqueue.gq_firstgen) / (double) nbplugins);
+  printf ("%s pipelined compilation of %d plugins in %.3f elapsed sec"
+          " (%.4f / file), %.3f children CPU sec, %d cached\n", progname,
+          nbcompiled, lastreap - firstspawn,
+          (lastreap - firstspawn) / (double) nbplugins, childcpuclock,
+          genqueue.gq_nbcached);
+  printf ("%s pipeline took %.3f elapsed sec, with %.3f sec overlapped"
+          " (first compilation after %.3f sec)\n", progname,
+          lastreap - startelapsedclock, overlap,
+          firstspawn - startelapsedclock);
+  fflush (NULL);
+  if (nbfailed > 0)
+    {
+      fprintf (stderr, "%s: %d plugin compilations failed\n", progname,
+               nbfailed);
+      exit (EXIT_FAILURE);
+    };
+  report_compile_scaling ();
+}                               /* end generate_and_compile_pipelined */
+
+
+
+/* fill namarr and funarr with the functions of the just loaded plugin
+   of index ix, from its genf_table in batched mode */
+static void
+resolve_plugin_functions (int ix, const char *pluginpath)
+{
+  char curname[NAME_BUFLEN];
+  compute_name_for_index (curname, ix);
+  if (batchsize <= 1)
+    {
+      free (namarr[ix]);
       namarr[ix] = strdup (curname + 1);
-      snprintf (pluginpath, sizeof (pluginpath), "./%s%s",
-                curname, pluginsuffix);
+      funarr[ix] = dlsym (hdlarr[ix], namarr[ix]);
+      if (!funarr[ix])
+        {
+          fprintf (stderr,
+                   "%s: cannot dlsym name %s in plugin#%d %s (%s)\n",
+                   progname, namarr[ix], ix, pluginpath, dlerror ());
+          exit (EXIT_FAILURE);
+        };
+      return;
+    };
+  funptr_t *table = dlsym (hdlarr[ix], "genf_table");
+  const int *tablesize = dlsym (hdlarr[ix], "genf_table_size");
+  int nbfun = plugin_function_count (ix);
+  if (!table || !tablesize || *tablesize != nbfun)
+    {
+      fprintf (stderr,
+               "%s: bad genf_table of %d functions in plugin#%d %s (%s)\n",
+               progname, nbfun, ix, pluginpath,
+               (table && tablesize) ? "wrong size" : dlerror ());
+      exit (EXIT_FAILURE);
+    };
+  for (int k = 0; k < nbfun; k++)
+    {
+      char funame[sizeof (curname) + 16];
+      snprintf (funame, sizeof (funame), "%s_%d", curname + 1, k);
+      free (namarr[ix * batchsize + k]);
+      namarr[ix * batchsize + k] = strdup (funame);
+      funarr[ix * batchsize + k] = table[k];
+    };
+}                               /* end resolve_plugin_functions */
+
+// €Français: chargement des tous les greffons _genf_*.so; pour le
+// fichier généré _genf_D_52.c on charge dynamiquement _genf_D_52.so
+// contenant la fonction int genf_D_52(int a, int b), ou avec -b la
+// table genf_table de ses fonctions genf_D_52_0, genf_D_52_1 ...
+void
+dlopen_all_plugins (void)
+{
+  int nbplugins = nb_plugins ();
+  long startrss = current_rss_kb ();
+  int startmaps = count_mappings ();
+  double startelapsedclock = my_clock (CLOCK_MONOTONIC);
+  double startcpuclock = my_clock (CLOCK_PROCESS_CPUTIME_ID);
+  hdlarr = calloc ((size_t) nbplugins, sizeof (void *));
+  if (!hdlarr)
+    {
+      fprintf (stderr, "%s: failed to calloc hdlarr for %d plugins (%s)\n",
+               progname, nbplugins, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  namarr = calloc ((size_t) maxcnt, sizeof (char *));
+  if (!namarr)
+    {
+      fprintf (stderr, "%s: failed to calloc namarr for %d functions (%s)\n",
+               progname, maxcnt, strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+  funarr = calloc ((size_t) maxcnt, sizeof (funptr_t));
+  if (!funarr)
+    {
+      fprintf (stderr,
+               "%s: failed to calloc funarr for %d function pointers (%s)\n",
+               progname, maxcnt, strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+  printf ("%s start dlopen-ing %d plugins\n", progname, nbplugins);
+  fflush (NULL);
+  fflush (NULL);
+  for (int ix = 0; ix < nbplugins; ix++)
+    {
+      char pluginpath[96];
+      memset (pluginpath, 0, sizeof (pluginpath));
+      plugin_path (pluginpath, sizeof (pluginpath), ix);
       if (access (pluginpath, F_OK))
         {
           fprintf (stderr, "%s: cannot access plugin#%d %s (%s)\n",
@@ -917,28 +2331,537 @@ dlopen_all_plugins (void)
                    progname, ix, pluginpath, dlerror ());
           exit (EXIT_FAILURE);
         };
-      funarr[ix] = dlsym (hdlarr[ix], namarr[ix]);
-      if (!funarr[ix])
-        {
-          fprintf (stderr, "%s: cannot dlsym name %s in plugin#%d %s (%s)\n",
-                   progname, namarr[ix], ix, pluginpath, dlerror ());
-          exit (EXIT_FAILURE);
-        };
+      resolve_plugin_functions (ix, pluginpath);
     };
   double endelapsedclock = my_clock (CLOCK_MONOTONIC);
   double endcpuclock = my_clock (CLOCK_PROCESS_CPUTIME_ID);
+  long endrss = current_rss_kb ();
+  int endmaps = count_mappings ();
   printf ("%s dlopen-ed %d plugins in %.3f elapsed sec (%.4f / plugin)\n",
-          progname, maxcnt, endelapsedclock - startelapsedclock,
-          (endelapsedclock - startelapsedclock) / (double) maxcnt);
+          progname, nbplugins, endelapsedclock - startelapsedclock,
+          (endelapsedclock - startelapsedclock) / (double) nbplugins);
   printf ("%s dlopen-ed %d plugins in %.3f CPU sec (%.4f / plugin)\n",
-          progname, maxcnt, endcpuclock - startcpuclock,
-          (endcpuclock - startcpuclock) / (double) maxcnt);
+          progname, nbplugins, endcpuclock - startcpuclock,
+          (endcpuclock - startcpuclock) / (double) nbplugins);
+  printf ("%s batch of %d functions per plugin: %.3f µs elapsed,"
+          " %.2f kB RSS and %.3f mappings per function"
+          " (RSS %ld -> %ld kB, %d -> %d mappings)\n",
+          progname, batchsize,
+          1.0e6 * (endelapsedclock - startelapsedclock) / (double) maxcnt,
+          (endrss - startrss) / (double) maxcnt,
+          (endmaps - startmaps) / (double) maxcnt,
+          startrss, endrss, startmaps, endmaps);
   dlopen_elapsed_clock = endelapsedclock;
   dlopen_cpu_clock = endcpuclock;
   fflush (NULL);
 }                               /* end dlopen_all_plugins */
 
 
+/***** €Français: banc d'essai du chargeur dynamique (option -L).
+ *
+ * The loader benchmark loads all the plugins from several threads,
+ * with RTLD_NOW or RTLD_LAZY, in the default namespace or spread
+ * over a few dlmopen namespaces, and dlcloses them after each run.
+ * Open latencies are kept in completion order, which is the length
+ * of the link map when each plugin was loaded.
+ *****/
+
+#define LOADER_NAMESPACES 4
+
+struct loadrun_st
+{
+  int lr_mode;                  /* RTLD_NOW or RTLD_LAZY */
+  bool lr_dlmopen;
+  int lr_nbthreads;
+  int lr_nextix;                /* next plugin to load */
+  int lr_nbdone;                /* loaded plugins */
+  void **lr_handles;            /* indexed by plugin */
+  double *lr_latency;           /* in seconds, by completion order */
+};
+
+/// the dlmopen namespaces, each one started by the host shim
+Lmid_t loader_lmids[LOADER_NAMESPACES];
+bool loader_haslmids;
+
+/* Generated plugins refer to dynstep, tab, say_fun_a_b_c_d and (with
+   the call shape of -G) add_x_3_y of the executable, which is not
+   visible in a new namespace: the host shim defines them and is the
+   first object of each namespace. */
+static void
+create_loader_namespaces (void)
+{
+  char sopath[64];
+  int status = 0;
+  FILE *f = fopen (HOST_SHIM_NAME ".c", "w");
+  if (!f)
+    {
+      perror (HOST_SHIM_NAME ".c");
+      exit (EXIT_FAILURE);
+    };
+  fprintf (f, "/* host shim generated by " __FILE__ " for dlmopen */\n");
+  fprintf (f, "#include <stdio.h>\n" "long dynstep;\n" "int tab[%d];\n",
+           MAXTAB);
+  fprintf (f, "void say_fun_a_b_c_d (const char *fun,"
+           " int a, int b, int c, int d)\n"
+           "{ printf (\"<%%s> a=%%d b=%%d c=%%d d=%%d\\n\","
+           " fun, a, b, c, d); }\n");
+  fprintf (f, "int add_x_3_y (int x, int y)\n{ return x + 3 * y; }\n");
+  fclose (f);
+  snprintf (sopath, sizeof (sopath), "./%s%s", HOST_SHIM_NAME, pluginsuffix);
+  pid_t pid = spawn_compilation (HOST_SHIM_NAME ".c", sopath, -1, -1);
+  if (waitpid (pid, &status, 0) < 0 || !WIFEXITED (status)
+      || WEXITSTATUS (status) != 0)
+    {
+      fprintf (stderr, "%s: failed to compile %s.c (status %#x)\n",
+               progname, HOST_SHIM_NAME, status);
+      exit (EXIT_FAILURE);
+    };
+  for (int n = 0; n < LOADER_NAMESPACES; n++)
+    {
+      void *h = dlmopen (LM_ID_NEWLM, sopath, RTLD_NOW);
+      if (!h || dlinfo (h, RTLD_DI_LMID, loader_lmids + n))
+        {
+          fprintf (stderr, "%s: failed to dlmopen %s in namespace#%d (%s)\n",
+                   progname, sopath, n, dlerror ());
+          exit (EXIT_FAILURE);
+        };
+    };
+  loader_haslmids = true;
+}                               /* end create_loader_namespaces */
+
+static void *
+loader_thread (void *arg)
+{
+  struct loadrun_st *lr = arg;
+  int nbplugins = nb_plugins ();
+  char pluginpath[96];
+  for (;;)
+    {
+      int ix = __atomic_fetch_add (&lr->lr_nextix, 1, __ATOMIC_RELAXED);
+      if (ix >= nbplugins)
+        break;
+      plugin_path (pluginpath, sizeof (pluginpath), ix);
+      double t0 = my_clock (CLOCK_MONOTONIC);
+      void *h = lr->lr_dlmopen
+        ? dlmopen (loader_lmids[ix % LOADER_NAMESPACES], pluginpath,
+                   lr->lr_mode) : dlopen (pluginpath, lr->lr_mode);
+      double t1 = my_clock (CLOCK_MONOTONIC);
+      if (!h)
+        {
+          fprintf (stderr, "%s: cannot load plugin#%d %s (%s)\n",
+                   progname, ix, pluginpath, dlerror ());
+          exit (EXIT_FAILURE);
+        };
+      lr->lr_handles[ix] = h;
+      int rank = __atomic_fetch_add (&lr->lr_nbdone, 1, __ATOMIC_RELAXED);
+      lr->lr_latency[rank] = t1 - t0;
+    };
+  return NULL;
+}                               /* end loader_thread */
+
+static int
+cmp_double (const void *p1, const void *p2)
+{
+  double d1 = *(const double *) p1, d2 = *(const double *) p2;
+  return (d1 > d2) - (d1 < d2);
+}                               /* end cmp_double */
+
+/// the q-quantile of n sorted values
+static double
+sorted_quantile (const double *sorted, int n, double q)
+{
+  int r = (int) (q * (n - 1) + 0.5);
+  return sorted[r < 0 ? 0 : (r >= n ? n - 1 : r)];
+}                               /* end sorted_quantile */
+
+#define LOADER_TENTHS 10
+
+/* load then dlclose all plugins once, and print the latency
+   distribution and its growth with the link map */
+static void
+loader_run (int mode, bool usedlmopen, int nbthreads)
+{
+  pthread_t threads[MAXIMAL_LOADER_THREADS];
+  struct loadrun_st lr;
+  int nbplugins = nb_plugins ();
+  double *sorted = calloc (nbplugins, sizeof (double));
+  memset (&lr, 0, sizeof (lr));
+  lr.lr_mode = mode;
+  lr.lr_dlmopen = usedlmopen;
+  lr.lr_nbthreads = nbthreads;
+  lr.lr_handles = calloc (nbplugins, sizeof (void *));
+  lr.lr_latency = calloc (nbplugins, sizeof (double));
+  if (!sorted || !lr.lr_handles || !lr.lr_latency)
+    {
+      fprintf (stderr, "%s: failed to calloc loader run of %d plugins (%s)\n",
+               progname, nbplugins, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  double startclock = my_clock (CLOCK_MONOTONIC);
+  for (int t = 0; t < nbthreads; t++)
+    {
+      int err = pthread_create (threads + t, NULL, loader_thread, &lr);
+      if (err)
+        {
+          fprintf (stderr, "%s: failed to create loader thread#%d (%s)\n",
+                   progname, t, strerror (err));
+          exit (EXIT_FAILURE);
+        };
+    };
+  for (int t = 0; t < nbthreads; t++)
+    pthread_join (threads[t], NULL);
+  double loadclock = my_clock (CLOCK_MONOTONIC);
+  for (int ix = nbplugins - 1; ix >= 0; ix--)
+    if (dlclose (lr.lr_handles[ix]))
+      fprintf (stderr, "%s: dlclose plugin#%d failed (%s)\n", progname, ix,
+               dlerror ());
+  double closeclock = my_clock (CLOCK_MONOTONIC);
+  memcpy (sorted, lr.lr_latency, nbplugins * sizeof (double));
+  qsort (sorted, nbplugins, sizeof (double), cmp_double);
+  printf ("%-10s %-7s %3d %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+          (mode & RTLD_NOW) ? "RTLD_NOW" : "RTLD_LAZY",
+          usedlmopen ? "dlmopen" : "dlopen", nbthreads,
+          1.0e6 * sorted_quantile (sorted, nbplugins, 0.5),
+          1.0e6 * sorted_quantile (sorted, nbplugins, 0.9),
+          1.0e6 * sorted_quantile (sorted, nbplugins, 0.99),
+          1.0e6 * sorted[nbplugins - 1],
+          1.0e6 * (loadclock - startclock) / nbplugins,
+          1.0e6 * (closeclock - loadclock) / nbplugins);
+  /// the median latency for each tenth of the link map length
+  printf ("%24s median µs by link map tenth:", "");
+  for (int d = 0; d < LOADER_TENTHS; d++)
+    {
+      int lo = (int) ((long) nbplugins * d / LOADER_TENTHS);
+      int hi = (int) ((long) nbplugins * (d + 1) / LOADER_TENTHS);
+      if (hi <= lo)
+        continue;
+      memcpy (sorted, lr.lr_latency + lo, (hi - lo) * sizeof (double));
+      qsort (sorted, hi - lo, sizeof (double), cmp_double);
+      printf (" %.1f", 1.0e6 * sorted_quantile (sorted, hi - lo, 0.5));
+    };
+  putchar ('\n');
+  fflush (NULL);
+  free (sorted);
+  free (lr.lr_handles);
+  free (lr.lr_latency);
+}                               /* end loader_run */
+
+// €Français: banc d'essai du chargement parallèle des greffons
+void
+loader_benchmark (void)
+{
+  static const int modes[2] = { RTLD_NOW, RTLD_LAZY };
+  printf ("%s loader benchmark of %d plugins with up to %d threads\n",
+          progname, nb_plugins (), loader_nbthreads);
+  if (!loader_haslmids)
+    create_loader_namespaces ();
+  printf ("%-10s %-7s %3s %9s %9s %9s %9s %9s %9s\n", "# mode", "loader",
+          "thr", "p50 µs", "p90 µs", "p99 µs", "max µs", "open µs",
+          "close µs");
+  for (int m = 0; m < 2; m++)
+    for (int ns = 0; ns < 2; ns++)
+      {
+        loader_run (modes[m], ns > 0, 1);
+        if (loader_nbthreads > 1)
+          loader_run (modes[m], ns > 0, loader_nbthreads);
+      };
+}                               /* end loader_benchmark */
+
+
+/***** €Français: banc d'essai des appels (option -D).
+ *
+ * The dispatch benchmark calls the leaf functions of the first N
+ * plugins, for N = 10, 100, ... up to all of them, following a
+ * pregenerated random sequence of plugin indexes, in four ways:
+ * through the funarr-like pointer array, through a packed table of
+ * the pregenerated calls with their function pointer and argument,
+ * through a generated caller plugin doing direct calls (so via its
+ * PLT stubs) in a switch, and through dlsym on every call.
+ *****/
+
+#define DISPATCH_CALLS (1L << 22)
+#define DISPATCH_DLSYM_CALLS (1L << 16)
+#define DISPATCH_MAX_DIRECT 100000
+
+/// a pregenerated call, packed four per cache line
+struct callent_st
+{
+  funptr_t ce_fun;
+  int ce_a;
+  int ce_pad;
+};
+
+typedef int caller_t (const int *, long, int);
+
+enum dispatch_counter_en
+{
+  DISPATCH_ITLB_MISSES,
+  DISPATCH_BRANCH_MISSES,
+  DISPATCH_NB_COUNTERS
+};
+
+int dispatch_counter_fds[DISPATCH_NB_COUNTERS] = { -1, -1 };
+
+static void
+open_dispatch_counters (void)
+{
+  struct perf_event_attr pea;
+  for (int c = 0; c < DISPATCH_NB_COUNTERS; c++)
+    {
+      memset (&pea, 0, sizeof (pea));
+      pea.size = sizeof (pea);
+      pea.disabled = 1;
+      pea.exclude_kernel = 1;
+      pea.exclude_hv = 1;
+      if (c == DISPATCH_ITLB_MISSES)
+        {
+          pea.type = PERF_TYPE_HW_CACHE;
+          pea.config = PERF_COUNT_HW_CACHE_ITLB
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        }
+      else
+        {
+          pea.type = PERF_TYPE_HARDWARE;
+          pea.config = PERF_COUNT_HW_BRANCH_MISSES;
+        };
+      dispatch_counter_fds[c] =
+        (int) syscall (SYS_perf_event_open, &pea, 0, -1, -1, 0);
+      if (dispatch_counter_fds[c] < 0 && verbose)
+        fprintf (stderr, "%s: perf_event_open counter#%d failed (%s)\n",
+                 progname, c, strerror (errno));
+    };
+}                               /* end open_dispatch_counters */
+
+static void
+switch_dispatch_counters (bool on)
+{
+  for (int c = 0; c < DISPATCH_NB_COUNTERS; c++)
+    if (dispatch_counter_fds[c] >= 0)
+      {
+        if (on)
+          ioctl (dispatch_counter_fds[c], PERF_EVENT_IOC_RESET, 0);
+        ioctl (dispatch_counter_fds[c],
+               on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+      };
+}                               /* end switch_dispatch_counters */
+
+/// print one measure, with its counters per call when available
+static void
+print_dispatch (int nbplug, const char *variant, long nbcalls,
+                double elapsed)
+{
+  printf ("%9d %-10s %9.2f", nbplug, variant, 1.0e9 * elapsed / nbcalls);
+  for (int c = 0; c < DISPATCH_NB_COUNTERS; c++)
+    {
+      long long val = 0;
+      if (dispatch_counter_fds[c] >= 0
+          && read (dispatch_counter_fds[c], &val, sizeof (val)) ==
+          sizeof (val))
+        printf (" %12.4f", (double) val / nbcalls);
+      else
+        printf (" %12s", "n/a");
+    };
+  putchar ('\n');
+  fflush (NULL);
+}                               /* end print_dispatch */
+
+static int __attribute__((noinline))
+dispatch_through_array (funptr_t * leafarr, const int *seq, long n, int r)
+{
+  for (long i = 0; i < n; i++)
+    r = (*leafarr[seq[i]]) ((int) i, r);
+  return r;
+}                               /* end dispatch_through_array */
+
+static int __attribute__((noinline))
+dispatch_through_packed (const struct callent_st *calls, long n, int r)
+{
+  for (long i = 0; i < n; i++)
+    r = (*calls[i].ce_fun) (calls[i].ce_a, r);
+  return r;
+}                               /* end dispatch_through_packed */
+
+static int __attribute__((noinline))
+dispatch_through_dlsym (char **leafnames, const int *seq, long n, int r)
+{
+  for (long i = 0; i < n; i++)
+    {
+      funptr_t f = (funptr_t) dlsym (hdlarr[seq[i]], leafnames[seq[i]]);
+      r = (*f) ((int) i, r);
+    };
+  return r;
+}                               /* end dispatch_through_dlsym */
+
+/* generate, compile and load the caller plugin doing direct calls to
+   the leaves of the first nbplug plugins, which are promoted to the
+   global scope; return its genf_caller function */
+static caller_t *
+build_dispatch_caller (int nbplug)
+{
+  char curname[NAME_BUFLEN];
+  char pluginpath[96];
+  int status = 0;
+  FILE *f = fopen (CALLER_NAME ".c", "w");
+  if (!f)
+    {
+      perror (CALLER_NAME ".c");
+      exit (EXIT_FAILURE);
+    };
+  fprintf (f, "/* caller generated by " __FILE__ " for %d plugins */\n",
+           nbplug);
+  for (int ix = 0; ix < nbplug; ix++)
+    {
+      compute_name_for_index (curname, ix);
+      fprintf (f, "extern int %s_leaf (int, int);\n", curname + 1);
+    };
+  fprintf (f, "int genf_caller (const int *seq, long n, int r)\n{\n"
+           "  for (long i = 0; i < n; i++)\n" "    switch (seq[i])\n"
+           "      {\n");
+  for (int ix = 0; ix < nbplug; ix++)
+    {
+      compute_name_for_index (curname, ix);
+      fprintf (f, "      case %d: r = %s_leaf ((int) i, r); break;\n", ix,
+               curname + 1);
+    };
+  fprintf (f, "      }\n" "  return r;\n}\n");
+  fclose (f);
+  snprintf (pluginpath, sizeof (pluginpath), "./%s%s", CALLER_NAME,
+            pluginsuffix);
+  pid_t pid = spawn_compilation (CALLER_NAME ".c", pluginpath, -1, -1);
+  if (waitpid (pid, &status, 0) < 0 || !WIFEXITED (status)
+      || WEXITSTATUS (status) != 0)
+    {
+      fprintf (stderr, "%s: failed to compile %s.c (status %#x)\n",
+               progname, CALLER_NAME, status);
+      return NULL;
+    };
+  for (int ix = 0; ix < nbplug; ix++)
+    {
+      plugin_path (pluginpath, sizeof (pluginpath), ix);
+      if (!dlopen (pluginpath, RTLD_NOW | RTLD_NOLOAD | RTLD_GLOBAL))
+        {
+          fprintf (stderr, "%s: cannot promote plugin#%d %s (%s)\n",
+                   progname, ix, pluginpath, dlerror ());
+          return NULL;
+        };
+    };
+  snprintf (pluginpath, sizeof (pluginpath), "./%s%s", CALLER_NAME,
+            pluginsuffix);
+  void *hdl = dlopen (pluginpath, RTLD_LAZY);
+  if (!hdl)
+    {
+      fprintf (stderr, "%s: cannot dlopen caller %s (%s)\n",
+               progname, pluginpath, dlerror ());
+      return NULL;
+    };
+  return (caller_t *) dlsym (hdl, "genf_caller");
+}                               /* end build_dispatch_caller */
+
+// €Français: comparaison des façons d'appeler les fonctions feuilles
+void
+run_dispatch_benchmark (void)
+{
+  int nbplugins = nb_plugins ();
+  funptr_t *leafarr = calloc (nbplugins, sizeof (funptr_t));
+  char **leafnames = calloc (nbplugins, sizeof (char *));
+  int *seq = calloc (DISPATCH_CALLS, sizeof (int));
+  struct callent_st *calls =
+    aligned_alloc (64, DISPATCH_CALLS * sizeof (struct callent_st));
+  caller_t *caller = NULL;
+  int r = 0;
+  if (!leafarr || !leafnames || !seq || !calls)
+    {
+      fprintf (stderr, "%s: failed to allocate the dispatch benchmark (%s)\n",
+               progname, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  for (int ix = 0; ix < nbplugins; ix++)
+    {
+      char curname[NAME_BUFLEN];
+      char leafname[NAME_BUFLEN + 8];
+      compute_name_for_index (curname, ix);
+      snprintf (leafname, sizeof (leafname), "%s_leaf", curname + 1);
+      leafnames[ix] = strdup (leafname);
+      leafarr[ix] = (funptr_t) dlsym (hdlarr[ix], leafname);
+      if (!leafarr[ix])
+        {
+          fprintf (stderr, "%s: cannot dlsym %s in plugin#%d (%s)\n",
+                   progname, leafname, ix, dlerror ());
+          exit (EXIT_FAILURE);
+        };
+    };
+  int nbdirect = (nbplugins < DISPATCH_MAX_DIRECT)
+    ? nbplugins : DISPATCH_MAX_DIRECT;
+  caller = build_dispatch_caller (nbdirect);
+  open_dispatch_counters ();
+  printf ("%s dispatch benchmark of %ld calls to leaves of up to %d plugins\n",
+          progname, DISPATCH_CALLS, nbplugins);
+  printf ("# plugins %-10s %9s %12s %12s\n", "variant", "ns/call",
+          "iTLB-miss", "branch-miss");
+  /// the rounds use 10, 100, ... plugins, then all of them
+  long rounds[24];
+  int nbrounds = 0;
+  for (long nbplug = 10; nbplug < nbplugins && nbrounds < 23; nbplug *= 10)
+    rounds[nbrounds++] = nbplug;
+  rounds[nbrounds++] = nbplugins;
+  for (int rix = 0; rix < nbrounds; rix++)
+    {
+      long nbplug = rounds[rix];
+      for (long i = 0; i < DISPATCH_CALLS; i++)
+        {
+          seq[i] = DICE ((int) nbplug);
+          calls[i].ce_fun = leafarr[seq[i]];
+          calls[i].ce_a = (int) i;
+          calls[i].ce_pad = 0;
+        };
+      /// each variant is warmed up once, binding the lazy PLT stubs
+      r = dispatch_through_array (leafarr, seq, DISPATCH_CALLS, r);
+      switch_dispatch_counters (true);
+      double t0 = my_clock (CLOCK_MONOTONIC);
+      r = dispatch_through_array (leafarr, seq, DISPATCH_CALLS, r);
+      double t1 = my_clock (CLOCK_MONOTONIC);
+      switch_dispatch_counters (false);
+      print_dispatch ((int) nbplug, "array", DISPATCH_CALLS, t1 - t0);
+      r = dispatch_through_packed (calls, DISPATCH_CALLS, r);
+      switch_dispatch_counters (true);
+      t0 = my_clock (CLOCK_MONOTONIC);
+      r = dispatch_through_packed (calls, DISPATCH_CALLS, r);
+      t1 = my_clock (CLOCK_MONOTONIC);
+      switch_dispatch_counters (false);
+      print_dispatch ((int) nbplug, "packed", DISPATCH_CALLS, t1 - t0);
+      if (caller && nbplug <= nbdirect)
+        {
+          r = (*caller) (seq, DISPATCH_CALLS, r);
+          switch_dispatch_counters (true);
+          t0 = my_clock (CLOCK_MONOTONIC);
+          r = (*caller) (seq, DISPATCH_CALLS, r);
+          t1 = my_clock (CLOCK_MONOTONIC);
+          switch_dispatch_counters (false);
+          print_dispatch ((int) nbplug, "direct-plt", DISPATCH_CALLS,
+                          t1 - t0);
+        };
+      r = dispatch_through_dlsym (leafnames, seq, DISPATCH_DLSYM_CALLS, r);
+      switch_dispatch_counters (true);
+      t0 = my_clock (CLOCK_MONOTONIC);
+      r = dispatch_through_dlsym (leafnames, seq, DISPATCH_DLSYM_CALLS, r);
+      t1 = my_clock (CLOCK_MONOTONIC);
+      switch_dispatch_counters (false);
+      print_dispatch ((int) nbplug, "dlsym", DISPATCH_DLSYM_CALLS, t1 - t0);
+    };
+  printf ("%s dispatch benchmark result %d\n", progname, r);
+  for (int c = 0; c < DISPATCH_NB_COUNTERS; c++)
+    if (dispatch_counter_fds[c] >= 0)
+      close (dispatch_counter_fds[c]), dispatch_counter_fds[c] = -1;
+  for (int ix = 0; ix < nbplugins; ix++)
+    free (leafnames[ix]);
+  free (leafnames);
+  free (leafarr);
+  free (seq);
+  free (calls);
+}                               /* end run_dispatch_benchmark */
+
+
 // €Français: appel aléatoire aux fonctions générées
 long
 do_the_random_calls_to_dlsymed_functions (void)
@@ -975,6 +2898,613 @@ do_the_random_calls_to_dlsymed_functions (void)
 }                               /* end do_the_random_calls_to_dlsymed_functions */
 
 
+/***** €Français: déchargement et rechargement des greffons (option -U).
+ *
+ * At each churn round, a random tenth of the plugins is dlclosed,
+ * regenerated with fresh random code, compiled and dlopened again.
+ * The RSS, the number of mappings and the open and close latencies
+ * are printed per round.  A leak is flagged when the RSS or mappings
+ * keep growing over the second half of the rounds.
+ *****/
+
+#define CHURN_LEAK_KB_PER_ROUND 64.0
+#define CHURN_LEAK_MAPS_PER_ROUND 0.5
+
+/// least squares slope of y over its indexes from lo to hi excluded
+static double
+slope_over_rounds (const double *y, int lo, int hi)
+{
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  int n = hi - lo;
+  if (n < 2)
+    return 0.0;
+  for (int i = lo; i < hi; i++)
+    {
+      sx += i;
+      sy += y[i];
+      sxx += (double) i * i;
+      sxy += (double) i * y[i];
+    };
+  return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}                               /* end slope_over_rounds */
+
+// €Français: tours de déchargement et rechargement des greffons
+void
+churn_plugins (void)
+{
+  int nbplugins = nb_plugins ();
+  int nbchurn = nbplugins / 10 > 0 ? nbplugins / 10 : 1;
+  int *chosen = calloc (nbchurn, sizeof (int));
+  bool *picked = calloc (nbplugins, sizeof (bool));
+  pid_t *pids = calloc (nbchurn, sizeof (pid_t));
+  double *rsshist = calloc (churn_rounds, sizeof (double));
+  double *mapshist = calloc (churn_rounds, sizeof (double));
+  if (!chosen || !picked || !pids || !rsshist || !mapshist)
+    {
+      fprintf (stderr, "%s: failed to calloc churn of %d plugins (%s)\n",
+               progname, nbchurn, strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  printf ("%s churning %d of %d plugins during %d rounds,"
+          " RSS %ld kB, %d mappings\n", progname, nbchurn, nbplugins,
+          churn_rounds, current_rss_kb (), count_mappings ());
+  long nbpinned = 0;             /* plugins still loaded after dlclose */
+  printf ("# round %9s %9s %9s %9s %9s %9s %8s\n", "close µs", "max",
+          "open µs", "max", "compile s", "RSS kB", "mappings");
+  for (int round = 0; round < churn_rounds; round++)
+    {
+      char curname[NAME_BUFLEN];
+      char pluginpath[96];
+      double closesum = 0, closemax = 0, opensum = 0, openmax = 0;
+      memset (picked, 0, nbplugins * sizeof (bool));
+      for (int c = 0; c < nbchurn; c++)
+        {
+          int ix = DICE (nbplugins);
+          while (picked[ix])
+            ix = (ix + 1) % nbplugins;
+          picked[ix] = true;
+          chosen[c] = ix;
+        };
+      for (int c = 0; c < nbchurn; c++)
+        {
+          int ix = chosen[c];
+          double t0 = my_clock (CLOCK_MONOTONIC);
+          if (dlclose (hdlarr[ix]))
+            fprintf (stderr, "%s: dlclose plugin#%d failed (%s)\n",
+                     progname, ix, dlerror ());
+          double t = my_clock (CLOCK_MONOTONIC) - t0;
+          hdlarr[ix] = NULL;
+          /// a plugin pinned by another loaded object stays mapped,
+          /// and reopening it would not reload anything
+          plugin_path (pluginpath, sizeof (pluginpath), ix);
+          void *still = dlopen (pluginpath, RTLD_NOW | RTLD_NOLOAD);
+          if (still)
+            {
+              dlclose (still);
+              nbpinned++;
+            };
+          closesum += t;
+          if (t > closemax)
+            closemax = t;
+        };
+      /// regenerate and compile the replacements, makenbjobs at once
+      double compilestart = my_clock (CLOCK_MONOTONIC);
+      for (int c = 0; c < nbchurn; c++)
+        {
+          compute_name_for_index (curname, chosen[c]);
+          if (memfd_src)
+            open_plugin_memfds (chosen[c]);
+          generate_file (curname, plugin_function_count (chosen[c]),
+                         memfd_src ? memfd_src[chosen[c]] : -1);
+          plugin_path (pluginpath, sizeof (pluginpath), chosen[c]);
+          if (!memfd_so)
+            unlink (pluginpath);
+        };
+      for (int first = 0; first < nbchurn; first += makenbjobs)
+        {
+          int last = first + makenbjobs < nbchurn
+            ? first + makenbjobs : nbchurn;
+          for (int c = first; c < last; c++)
+            pids[c] = spawn_plugin_compilation (chosen[c]);
+          for (int c = first; c < last; c++)
+            {
+              int status = 0;
+              if (waitpid (pids[c], &status, 0) < 0
+                  || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+                {
+                  fprintf (stderr,
+                           "%s: churn compilation of plugin#%d failed"
+                           " (status %#x)\n", progname, chosen[c], status);
+                  exit (EXIT_FAILURE);
+                };
+            };
+        };
+      double compiletime = my_clock (CLOCK_MONOTONIC) - compilestart;
+      for (int c = 0; c < nbchurn; c++)
+        {
+          int ix = chosen[c];
+          plugin_path (pluginpath, sizeof (pluginpath), ix);
+          double t0 = my_clock (CLOCK_MONOTONIC);
+          hdlarr[ix] = dlopen (pluginpath, RTLD_NOW);
+          double t = my_clock (CLOCK_MONOTONIC) - t0;
+          if (!hdlarr[ix])
+            {
+              fprintf (stderr, "%s: cannot dlopen again plugin#%d %s (%s)\n",
+                       progname, ix, pluginpath, dlerror ());
+              exit (EXIT_FAILURE);
+            };
+          resolve_plugin_functions (ix, pluginpath);
+          opensum += t;
+          if (t > openmax)
+            openmax = t;
+        };
+      rsshist[round] = current_rss_kb ();
+      mapshist[round] = count_mappings ();
+      printf ("%7d %9.1f %9.1f %9.1f %9.1f %9.3f %9.0f %8.0f\n", round,
+              1.0e6 * closesum / nbchurn, 1.0e6 * closemax,
+              1.0e6 * opensum / nbchurn, 1.0e6 * openmax, compiletime,
+              rsshist[round], mapshist[round]);
+      fflush (NULL);
+    };
+  double rssslope =
+    slope_over_rounds (rsshist, churn_rounds / 2, churn_rounds);
+  double mapsslope =
+    slope_over_rounds (mapshist, churn_rounds / 2, churn_rounds);
+  if (nbpinned > 0)
+    printf ("%s: churn NOT MEASURED, %ld dlclose-d plugins stayed loaded"
+            ", RSS grows by %.1f kB and mappings by %.2f"
+            " per round\n", progname, nbpinned, rssslope, mapsslope);
+  else if (rssslope > CHURN_LEAK_KB_PER_ROUND
+           || mapsslope > CHURN_LEAK_MAPS_PER_ROUND)
+    printf ("%s: churn LEAK suspected, RSS grows by %.1f kB and mappings"
+            " by %.2f per round after %d rounds\n", progname, rssslope,
+            mapsslope, churn_rounds / 2);
+  else
+    printf ("%s: churn steady, RSS grows by %.1f kB and mappings by %.2f"
+            " per round after %d rounds\n", progname, rssslope, mapsslope,
+            churn_rounds / 2);
+  fflush (NULL);
+  free (chosen);
+  free (picked);
+  free (pids);
+  free (rsshist);
+  free (mapshist);
+}                               /* end churn_plugins */
+
+
+/***** €Français: rapport JSON de l'exécution, et comparaison de deux
+ * rapports par manydl --compare old.json new.json
+ *****/
+
+static void
+json_string (FILE * f, const char *str)
+{
+  putc ('"', f);
+  for (const char *pc = str; pc && *pc; pc++)
+    {
+      if (*pc == '"' || *pc == '\\')
+        fprintf (f, "\\%c", *pc);
+      else if ((unsigned char) *pc < ' ')
+        fprintf (f, "\\u%04x", (unsigned char) *pc);
+      else
+        putc (*pc, f);
+    };
+  putc ('"', f);
+}                               /* end json_string */
+
+/// print a number, or null for NaN
+static void
+json_number (FILE * f, double x)
+{
+  if (isnan (x) || isinf (x))
+    fputs ("null", f);
+  else
+    fprintf (f, "%.6g", x);
+}                               /* end json_number */
+
+static void
+json_phase (FILE * f, const char *name, double elapsed, double cpu,
+            bool last)
+{
+  fprintf (f, "    \"%s\": {\"elapsed\": ", name);
+  json_number (f, elapsed);
+  fputs (", \"cpu\": ", f);
+  json_number (f, cpu);
+  fprintf (f, "}%s\n", last ? "" : ",");
+}                               /* end json_phase */
+
+/// the CPU time of all the waited children, in seconds
+static double
+children_cpu_time (void)
+{
+  struct rusage ru = { };
+  getrusage (RUSAGE_CHILDREN, &ru);
+  return ru.ru_utime.tv_sec + 1.0e-6 * ru.ru_utime.tv_usec
+    + ru.ru_stime.tv_sec + 1.0e-6 * ru.ru_stime.tv_usec;
+}                               /* end children_cpu_time */
+
+static void
+json_rusage (FILE * f, const char *name, int who, bool last)
+{
+  struct rusage ru = { };
+  getrusage (who, &ru);
+  fprintf (f, "  \"%s\": {\"utime\": %.6f, \"stime\": %.6f,"
+           " \"maxrss_kb\": %ld, \"minflt\": %ld, \"majflt\": %ld,"
+           " \"nvcsw\": %ld, \"nivcsw\": %ld}%s\n", name,
+           ru.ru_utime.tv_sec + 1.0e-6 * ru.ru_utime.tv_usec,
+           ru.ru_stime.tv_sec + 1.0e-6 * ru.ru_stime.tv_usec,
+           ru.ru_maxrss, ru.ru_minflt, ru.ru_majflt, ru.ru_nvcsw,
+           ru.ru_nivcsw, last ? "" : ",");
+}                               /* end json_rusage */
+
+/// the first line of "$CC --version"
+static void
+compiler_version (char *buf, size_t siz)
+{
+  char cmd[256];
+  memset (buf, 0, siz);
+  snprintf (cmd, sizeof (cmd), "%s --version 2>/dev/null", manydl_gcc);
+  FILE *p = popen (cmd, "r");
+  if (!p)
+    return;
+  if (fgets (buf, (int) siz, p))
+    buf[strcspn (buf, "\n")] = '\0';
+  pclose (p);
+}                               /* end compiler_version */
+
+// €Français: écriture du rapport JSON
+void
+write_json_report (long nbcalls)
+{
+  char compvers[200];
+  long long sobytes = 0, somax = 0, srcbytes = 0;
+  int nbso = 0;
+  int nbplugins = nb_plugins ();
+  FILE *f = fopen (reportpath, "w");
+  if (!f)
+    {
+      fprintf (stderr, "%s: cannot write report %s (%s)\n", progname,
+               reportpath, strerror (errno));
+      return;
+    };
+  for (int ix = 0; ix < nbplugins; ix++)
+    {
+      char path[NAME_BUFLEN + 16];
+      struct stat st = { };
+      source_path (path, sizeof (path), ix);
+      if (!stat (path, &st))
+        srcbytes += st.st_size;
+      plugin_path (path, sizeof (path), ix);
+      if (!stat (path, &st))
+        {
+          nbso++;
+          sobytes += st.st_size;
+          if (st.st_size > somax)
+            somax = st.st_size;
+        };
+    };
+  compiler_version (compvers, sizeof (compvers));
+  /* compile_cpu_clock includes the CPU time of the compiling children,
+     which the later process clocks do not */
+  double selfcompilecpu = compile_cpu_clock - compile_children_cpu;
+  double computestart = isnan (compute_elapsed_clock)
+    ? dlopen_elapsed_clock : compute_elapsed_clock;
+  double computecpustart = isnan (compute_cpu_clock)
+    ? dlopen_cpu_clock : compute_cpu_clock;
+  fprintf (f, "{\n  \"program\": \"manydl\",\n  \"git\": ");
+  json_string (f, manydl_git);
+  fprintf (f, ",\n  \"built\": \"%s\",\n  \"pid\": %d,\n",
+           __DATE__ "@" __TIME__, (int) getpid ());
+  fprintf (f, "  \"host\": {\"hostname\": ");
+  json_string (f, myhostname);
+  fputs (", \"sysname\": ", f);
+  json_string (f, my_uts.sysname);
+  fputs (", \"release\": ", f);
+  json_string (f, my_uts.release);
+  fputs (", \"version\": ", f);
+  json_string (f, my_uts.version);
+  fputs (", \"machine\": ", f);
+  json_string (f, my_uts.machine);
+  fprintf (f, ", \"cpus\": %ld},\n", sysconf (_SC_NPROCESSORS_ONLN));
+  fputs ("  \"compiler\": {\"cc\": ", f);
+  json_string (f, manydl_gcc);
+  fputs (", \"cflags\": ", f);
+  json_string (f, manydl_genf_cflags);
+  fputs (", \"version\": ", f);
+  json_string (f, compvers);
+  fputs ("},\n", f);
+  fprintf (f, "  \"parameters\": {\"functions\": %d, \"plugins\": %d,"
+           " \"meansize\": %d, \"batchsize\": %d, \"jobs\": %d,"
+           " \"seed\": %ld, \"pipelined_threads\": %d, \"fakerun\": %s,"
+           " \"profile\": \"%s\", \"sizedist\": \"%s\","
+           " \"builddir\": \"%s\"},\n",
+           maxcnt, nbplugins, meansize, batchsize, makenbjobs, random_seed,
+           pipelined_nbthreads, fakerun ? "true" : "false",
+           genprofile->gp_name, sizedist_names[sizedist],
+           builddir_names[builddir_mode]);
+  fputs ("  \"phases\": {\n", f);
+  json_phase (f, "generate", generate_elapsed_clock - start_elapsed_clock,
+              generate_cpu_clock - start_cpu_clock, false);
+  json_phase (f, "compile", compile_elapsed_clock - generate_elapsed_clock,
+              compile_cpu_clock - generate_cpu_clock, false);
+  json_phase (f, "dlopen", dlopen_elapsed_clock - compile_elapsed_clock,
+              dlopen_cpu_clock - selfcompilecpu, false);
+  json_phase (f, "compute", compute_elapsed_clock - dlopen_elapsed_clock,
+              compute_cpu_clock - dlopen_cpu_clock, false);
+  json_phase (f, "terminating", terminating_elapsed_clock - computestart,
+              terminating_cpu_clock - computecpustart, false);
+  /// like the compile phase, the total includes the compilers' CPU
+  json_phase (f, "total", my_clock (CLOCK_MONOTONIC) - start_elapsed_clock,
+              my_clock (CLOCK_PROCESS_CPUTIME_ID) + children_cpu_time ()
+              - start_cpu_clock, true);
+  fputs ("  },\n", f);
+  json_rusage (f, "self", RUSAGE_SELF, false);
+  json_rusage (f, "children", RUSAGE_CHILDREN, false);
+  fprintf (f, "  \"memory\": {\"rss_kb\": %ld, \"mappings\": %d},\n",
+           current_rss_kb (), count_mappings ());
+  fprintf (f, "  \"files\": {\"plugins\": %d, \"plugin_bytes\": %lld,"
+           " \"mean_plugin_bytes\": %.1f, \"max_plugin_bytes\": %lld,"
+           " \"source_bytes\": %lld},\n", nbso, sobytes,
+           nbso > 0 ? (double) sobytes / nbso : 0.0, somax, srcbytes);
+  if (cachedir)
+    fprintf (f, "  \"cache\": {\"hits\": %ld, \"misses\": %ld,"
+             " \"stored\": %ld, \"evicted\": %ld},\n", cache_nbhits,
+             cache_nbmisses, cache_nbstored, cache_nbevicted);
+  fputs ("  \"compile_size_exponent\": ", f);
+  json_number (f, compile_size_exponent);
+  fprintf (f, ",\n  \"calls\": %ld\n}\n", nbcalls);
+  if (fclose (f))
+    fprintf (stderr, "%s: failed to write report %s (%s)\n", progname,
+             reportpath, strerror (errno));
+  else
+    printf ("%s: wrote JSON report %s\n", progname, reportpath);
+}                               /* end write_json_report */
+
+/* a report is flattened into dotted keys with their string or number
+   value, e.g. phases.compile.elapsed */
+struct jsonflat_st
+{
+  char jf_key[256];
+  char jf_str[200];
+  double jf_num;
+  bool jf_isnum;
+};
+
+struct jsonrep_st
+{
+  struct jsonflat_st *jr_arr;
+  int jr_len, jr_size;
+  const char *jr_path;
+};
+
+static const char *
+json_skip_space (const char *p)
+{
+  while (*p && isspace (*p))
+    p++;
+  return p;
+}                               /* end json_skip_space */
+
+static const char *
+json_parse_string (const char *p, char *buf, size_t siz)
+{
+  size_t n = 0;
+  if (*p != '"')
+    return NULL;
+  for (p++; *p && *p != '"'; p++)
+    {
+      char c = *p;
+      if (c == '\\' && p[1])
+        {
+          c = *++p;
+          if (c == 'u')
+            {
+              c = '?';
+              p += (strlen (p) >= 5) ? 4 : 0;
+            }
+          else if (c == 'n')
+            c = '\n';
+          else if (c == 't')
+            c = '\t';
+        };
+      if (n + 1 < siz)
+        buf[n++] = c;
+    };
+  buf[n] = '\0';
+  return (*p == '"') ? p + 1 : NULL;
+}                               /* end json_parse_string */
+
+static void
+json_add_flat (struct jsonrep_st *jr, const char *key, const char *str,
+               double num, bool isnum)
+{
+  if (jr->jr_len >= jr->jr_size)
+    {
+      jr->jr_size = 2 * jr->jr_size + 32;
+      jr->jr_arr = realloc (jr->jr_arr,
+                            jr->jr_size * sizeof (struct jsonflat_st));
+      if (!jr->jr_arr)
+        {
+          fprintf (stderr, "%s: out of memory reading %s\n", progname,
+                   jr->jr_path);
+          exit (EXIT_FAILURE);
+        };
+    };
+  struct jsonflat_st *jf = jr->jr_arr + jr->jr_len++;
+  memset (jf, 0, sizeof (*jf));
+  snprintf (jf->jf_key, sizeof (jf->jf_key), "%.255s", key);
+  snprintf (jf->jf_str, sizeof (jf->jf_str), "%.199s", str ? str : "");
+  jf->jf_num = num;
+  jf->jf_isnum = isnum;
+}                               /* end json_add_flat */
+
+/// parse a JSON value under the given key prefix, return the next char
+static const char *
+json_parse_value (struct jsonrep_st *jr, const char *p, const char *prefix)
+{
+  char buf[200];
+  p = json_skip_space (p);
+  if (*p == '{' || *p == '[')
+    {
+      bool isobj = (*p == '{');
+      int rank = 0;
+      p = json_skip_space (p + 1);
+      while (p && *p && *p != (isobj ? '}' : ']'))
+        {
+          char key[512];
+          if (isobj)
+            {
+              p = json_parse_string (p, buf, sizeof (buf));
+              if (!p)
+                return NULL;
+              p = json_skip_space (p);
+              if (*p++ != ':')
+                return NULL;
+            }
+          else
+            snprintf (buf, sizeof (buf), "%d", rank);
+          snprintf (key, sizeof (key), "%s%s%s", prefix,
+                    *prefix ? "." : "", buf);
+          p = json_parse_value (jr, p, key);
+          if (!p)
+            return NULL;
+          p = json_skip_space (p);
+          if (*p == ',')
+            p = json_skip_space (p + 1);
+          rank++;
+        };
+      return (p && *p) ? p + 1 : NULL;
+    }
+  else if (*p == '"')
+    {
+      p = json_parse_string (p, buf, sizeof (buf));
+      if (p)
+        json_add_flat (jr, prefix, buf, NAN, false);
+      return p;
+    }
+  else if (!strncmp (p, "null", 4))
+    {
+      json_add_flat (jr, prefix, "null", NAN, false);
+      return p + 4;
+    }
+  else if (!strncmp (p, "true", 4) || !strncmp (p, "false", 5))
+    {
+      bool t = (*p == 't');
+      json_add_flat (jr, prefix, t ? "true" : "false", NAN, false);
+      return p + (t ? 4 : 5);
+    }
+  else
+    {
+      char *end = NULL;
+      double x = strtod (p, &end);
+      if (end == p)
+        return NULL;
+      json_add_flat (jr, prefix, NULL, x, true);
+      return end;
+    };
+}                               /* end json_parse_value */
+
+static void
+read_json_report (struct jsonrep_st *jr, const char *path)
+{
+  FILE *f = fopen (path, "r");
+  char *content = NULL;
+  size_t len = 0;
+  memset (jr, 0, sizeof (*jr));
+  jr->jr_path = path;
+  if (!f)
+    {
+      fprintf (stderr, "%s: cannot open report %s (%s)\n", progname, path,
+               strerror (errno));
+      exit (EXIT_FAILURE);
+    };
+  if (getdelim (&content, &len, '\0', f) < 0
+      || !json_parse_value (jr, content, ""))
+    {
+      fprintf (stderr, "%s: bad JSON report %s\n", progname, path);
+      exit (EXIT_FAILURE);
+    };
+  free (content);
+  fclose (f);
+}                               /* end read_json_report */
+
+/* keys identifying a run rather than measuring it, which always
+   differ between two reports */
+static bool
+is_json_identity_key (const char *key)
+{
+  return !strcmp (key, "pid") || !strcmp (key, "built")
+    || !strcmp (key, "parameters.seed");
+}                               /* end is_json_identity_key */
+
+/* print the differences between two reports: changed strings, and
+   every number with its relative change */
+int
+compare_json_reports (const char *oldpath, const char *newpath)
+{
+  struct jsonrep_st oldrep, newrep;
+  read_json_report (&oldrep, oldpath);
+  read_json_report (&newrep, newpath);
+  printf ("# comparing %s with %s\n", oldpath, newpath);
+  printf ("%-32s %14s %14s %9s\n", "# key", "old", "new", "change");
+  for (int i = 0; i < newrep.jr_len; i++)
+    {
+      struct jsonflat_st *nj = newrep.jr_arr + i;
+      struct jsonflat_st *oj = NULL;
+      if (is_json_identity_key (nj->jf_key))
+        continue;
+      for (int k = 0; k < oldrep.jr_len && !oj; k++)
+        if (!strcmp (oldrep.jr_arr[k].jf_key, nj->jf_key))
+          oj = oldrep.jr_arr + k;
+      if (!oj)
+        printf ("%-32s %14s %14s\n", nj->jf_key, "-",
+                nj->jf_isnum ? "(number)" : nj->jf_str);
+      else if (nj->jf_isnum && oj->jf_isnum)
+        {
+          printf ("%-32s %14.6g %14.6g", nj->jf_key, oj->jf_num,
+                  nj->jf_num);
+          if (oj->jf_num != 0.0)
+            printf (" %+8.1f%%",
+                    100.0 * (nj->jf_num - oj->jf_num) / fabs (oj->jf_num));
+          putchar ('\n');
+        }
+      else if (nj->jf_isnum || oj->jf_isnum)
+        {
+          /// a number on one side only, e.g. null or a string on the other
+          char oldbuf[32], newbuf[32];
+          snprintf (oldbuf, sizeof (oldbuf), "%g", oj->jf_num);
+          snprintf (newbuf, sizeof (newbuf), "%g", nj->jf_num);
+          printf ("%-32s %s\n%32s -> %s\n", nj->jf_key,
+                  oj->jf_isnum ? oldbuf : oj->jf_str, "",
+                  nj->jf_isnum ? newbuf : nj->jf_str);
+        }
+      else if (strcmp (nj->jf_str, oj->jf_str))
+        printf ("%-32s %s\n%32s -> %s\n", nj->jf_key, oj->jf_str, "",
+                nj->jf_str);
+    };
+  /// the keys which disappeared from the new report
+  for (int k = 0; k < oldrep.jr_len; k++)
+    {
+      struct jsonflat_st *oj = oldrep.jr_arr + k;
+      bool found = false;
+      if (is_json_identity_key (oj->jf_key))
+        continue;
+      for (int i = 0; i < newrep.jr_len && !found; i++)
+        found = !strcmp (newrep.jr_arr[i].jf_key, oj->jf_key);
+      if (!found)
+        {
+          if (oj->jf_isnum)
+            printf ("%-32s %14.6g %14s\n", oj->jf_key, oj->jf_num, "-");
+          else
+            printf ("%-32s %14s %14s\n", oj->jf_key, oj->jf_str, "-");
+        }
+    };
+  free (oldrep.jr_arr);
+  free (newrep.jr_arr);
+  return 0;
+}                               /* end compare_json_reports */
+
+
 // €Français: exécution d'un script final qui reçoit le nom des
 // fichiers C et connait dans des variables d'environnement les
 // paramètres décrivant ceux-ci.
@@ -1030,7 +3560,7 @@ run_terminating_script (void)
     }
   // then use popen on the terminatingscript command
   // and write all the generated C file names to that pipe
-  for (int ix = 0; ix < maxcnt; ix++)
+  for (int ix = 0; ix < nb_plugins (); ix++)
     {
       char nambuf[NAME_BUFLEN + 4];
       memset (nambuf, 0, sizeof (nambuf));
@@ -1099,6 +3629,8 @@ main (int argc, char **argv)
     show_help ();
   if (argc > 1 && !strcmp (argv[1], "--version"))
     show_version ();
+  if (argc == 4 && !strcmp (argv[1], "--compare"))
+    return compare_json_reports (argv[2], argv[3]);
   get_options (argc, argv);
   if (verbose)
     {
@@ -1136,12 +3668,29 @@ main (int argc, char **argv)
     printf ("%s:%d: ad@%p, add_x_3_y@%p, z=%d\n", __FILE__, __LINE__,
             ad, (void *) &add_x_3_y, z);
   };
-  generate_all_c_files ();
+  setup_build_directory ();
+  if (cachedir && !fakerun)
+    cache_initialize ();
+  if (pipelined_nbthreads > 0 && !fakerun)
+    generate_and_compile_pipelined ();
+  else
+    generate_all_c_files ();
   if (!fakerun)
     {
-      compile_all_plugins ();
+      if (pipelined_nbthreads == 0)
+        compile_all_plugins ();
+      if (cachedir)
+        cache_trim ();
+      if (loader_nbthreads > 0)
+        loader_benchmark ();
       dlopen_all_plugins ();
       nbcalls = do_the_random_calls_to_dlsymed_functions ();
+      /// the dispatch caller promotes and binds every plugin, which
+      /// would pin them all, so the churn comes first
+      if (churn_rounds > 0)
+        churn_plugins ();
+      if (dispatch_benchmark)
+        run_dispatch_benchmark ();
     };
   if (terminatingscript)
     {
@@ -1157,11 +3706,13 @@ main (int argc, char **argv)
     {
       // €Français: la carte de l'espace d'adressage virtuelle est écrite
       // dans un fichier _pmap_manydl* par l'utilitaire pmap(1)
-      char pmapout[64];
-      char pmapcmd[128];
+      char pmapout[sizeof (startcwd) + 64];
+      char pmapcmd[sizeof (pmapout) + 64];
       memset (pmapout, 0, sizeof (pmapout));
-      snprintf (pmapout, sizeof (pmapout), "_pmap_manydl_%d_git%s",
-                (int) getpid (), MANYDL_GIT);
+      /* outside of a -X build directory, which is removed at exit */
+      snprintf (pmapout, sizeof (pmapout), "%s%s_pmap_manydl_%d_git%s",
+                builddir_path[0] ? startcwd : "",
+                builddir_path[0] ? "/" : "", (int) getpid (), MANYDL_GIT);
       snprintf (pmapcmd, sizeof (pmapcmd), "/usr/bin/pmap -p %d > %s",
                 (int) getpid (), pmapout);
       fflush (NULL);
@@ -1197,7 +3748,7 @@ main (int argc, char **argv)
       ("%s: dlopened %d plugins of mean size %d in %.3f elapsed, %.3f cpu seconds\n",
        progname, maxcnt, meansize,
        dlopen_elapsed_clock - compile_elapsed_clock,
-       compile_cpu_clock - dlopen_cpu_clock);
+       dlopen_cpu_clock - (compile_cpu_clock - compile_children_cpu));
   if (!isnan (compute_elapsed_clock) && !isnan (compute_cpu_clock))
     printf
       ("%s: computed %ld calls with %d plugins of mean size %d in %.3f elapsed, %.3f cpu seconds\n",
@@ -1211,6 +3762,7 @@ main (int argc, char **argv)
        terminating_elapsed_clock - dlopen_elapsed_clock,
        terminating_cpu_clock - dlopen_cpu_clock);
 
+  write_json_report (nbcalls);
   // we don't bother to dlclose
   return 0;
 }                               /* end of main */
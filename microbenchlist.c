@@ -14,19 +14,61 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
 General Public License for more details.
 
 */
+#define _GNU_SOURCE 1
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <sched.h>
+#include <pthread.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <linux/perf_event.h>
 
 #define PERIOD 0x40000
 
+/// values per node of the unrolled list, filling a 64 bytes cache line
+#define UNROLL_K 6
+
+/// most independent lists traversed together by sumlist_interleaved
+#define MAX_INTERLEAVE 32
+
+/// most threads of the --threads benchmark, and segments per thread
+#define MAX_THREADS 256
+#define SEGMENTS_PER_THREAD 8
+#define CACHE_LINE 64
+
+/// from <numaif.h>, to avoid requiring libnuma
+#define MBL_MPOL_BIND 2
+#define MBL_MPOL_MF_MOVE (1 << 1)
+
 struct node_st
 {
   long v;
   struct node_st *next;
 };
 
+/// a node of the unrolled list, with UNROLL_K values
+struct unode_st
+{
+  struct unode_st *unext;
+  long ucnt;
+  long uv[UNROLL_K];
+};
+
+/// a node with a skip pointer some nodes ahead, for prefetching
+struct pnode_st
+{
+  long pv;
+  struct pnode_st *pnext;
+  struct pnode_st *pskip;
+};
+
 extern void printptrint (const char *str, int lin, void *ptr, int cnt);
 
 long
@@ -158,14 +200,1223 @@ sumlist5 (struct node_st *n)
 }				/* end sumlist5 */
 
 
+/***** the measuring harness: warm-up runs, then repeated samples of
+  several runs each, summarized by their median, median absolute
+  deviation and a 95% confidence interval of the median, optionally
+  with perf_event_open counters, on an optionally pinned CPU ****/
+
+/// harness settings, from the program options
+struct harness_st
+{
+  int ha_warmup;		/// number of warm-up runs
+  int ha_reps;			/// number of measured samples
+  int ha_cpu;			/// pinned CPU, or -1
+  bool ha_perf;			/// use perf counters
+  bool ha_json;			/// JSON output
+} harness = { 3, 21, -1, false, false };
+
+#define NB_COUNTERS 4
+static const struct
+{
+  const char *cd_name;
+  uint64_t cd_config;
+} counter_defs[NB_COUNTERS] = {
+  {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+  {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+  {"cache-misses", PERF_COUNT_HW_CACHE_MISSES},
+  {"branch-misses", PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+static int counter_fds[NB_COUNTERS] = { -1, -1, -1, -1 };
+
+#define MAX_SAMPLES 1001
+#define MAX_MEASURES 256
+
+/// a function measured by the harness, returning a checked sum
+typedef long bench_fun_t (void *data);
+
+/// the summary of a measure, times in ns per element
+struct measure_st
+{
+  char me_name[48];
+  long me_elems;		/// elements per run
+  size_t me_bytes;		/// bytes traversed per run, or 0
+  long me_inner;		/// runs per sample
+  int me_nbsamples;
+  double me_median, me_mad, me_cilow, me_cihigh, me_min;
+  bool me_counting;
+  double me_counters[NB_COUNTERS];	/// per element, or NAN
+};
+
+static struct measure_st measures[MAX_MEASURES];
+static int nbmeasures;
+
+/// where printptrint writes, stderr when stdout has JSON
+FILE *ptrout;
+
+static double
+elapsed_ns (const struct timespec *t0, const struct timespec *t1)
+{
+  return (t1->tv_sec - t0->tv_sec) * 1.0e9 + (t1->tv_nsec - t0->tv_nsec);
+}				/* end elapsed_ns */
+
+/* open the perf counters of this thread, inherited by the threads it
+   creates later so that --threads counts all of them, those
+   unavailable staying -1; return true if at least one is usable */
+static bool
+open_counters (void)
+{
+  bool some = false;
+  for (int c = 0; c < NB_COUNTERS; c++)
+    {
+      struct perf_event_attr pe;
+      memset (&pe, 0, sizeof (pe));
+      pe.type = PERF_TYPE_HARDWARE;
+      pe.size = sizeof (pe);
+      pe.config = counter_defs[c].cd_config;
+      pe.disabled = 1;
+      pe.exclude_kernel = 1;
+      pe.exclude_hv = 1;
+      pe.inherit = 1;
+      counter_fds[c] = (int) syscall (SYS_perf_event_open, &pe, 0, -1, -1, 0);
+      if (counter_fds[c] >= 0)
+	some = true;
+    };
+  return some;
+}				/* end open_counters */
+
+static void
+close_counters (void)
+{
+  for (int c = 0; c < NB_COUNTERS; c++)
+    if (counter_fds[c] >= 0)
+      {
+	close (counter_fds[c]);
+	counter_fds[c] = -1;
+      };
+}				/* end close_counters */
+
+static void
+switch_counters (bool on)
+{
+  for (int c = 0; c < NB_COUNTERS; c++)
+    if (counter_fds[c] >= 0)
+      ioctl (counter_fds[c],
+	     on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+}				/* end switch_counters */
+
+/* read the counters into vals, 0 for the unavailable ones.  Samples
+   are differences of readings, since PERF_EVENT_IOC_RESET does not
+   clear what the exited inherited threads folded into a counter */
+static void
+read_counters (uint64_t vals[NB_COUNTERS])
+{
+  for (int c = 0; c < NB_COUNTERS; c++)
+    {
+      vals[c] = 0;
+      if (counter_fds[c] >= 0
+	  && read (counter_fds[c], vals + c,
+		   sizeof (vals[c])) != sizeof (vals[c]))
+	vals[c] = 0;
+    };
+}				/* end read_counters */
+
+static int
+cmp_double (const void *p1, const void *p2)
+{
+  double d1 = *(const double *) p1, d2 = *(const double *) p2;
+  return (d1 > d2) - (d1 < d2);
+}				/* end cmp_double */
+
+/// the median of n sorted values
+static double
+sorted_median (const double *arr, int n)
+{
+  return (n % 2) ? arr[n / 2] : 0.5 * (arr[n / 2 - 1] + arr[n / 2]);
+}				/* end sorted_median */
+
+/* measure fun on data, whose runs handle elems elements and should
+   return expected, and record the summary under name */
+static struct measure_st *
+measure (const char *name, bench_fun_t * fun, void *data, long elems,
+	 size_t bytes, long expected)
+{
+  static double samples[MAX_SAMPLES];
+  static double devs[MAX_SAMPLES];
+  if (nbmeasures >= MAX_MEASURES)
+    {
+      fprintf (stderr, "too many measures\n");
+      exit (EXIT_FAILURE);
+    };
+  struct measure_st *me = measures + nbmeasures++;
+  memset (me, 0, sizeof (*me));
+  snprintf (me->me_name, sizeof (me->me_name), "%s", name);
+  me->me_elems = elems;
+  me->me_bytes = bytes;
+  /// warm-up runs check the result, and calibrate samples of 1ms
+  double runns = 1.0;
+  for (int w = 0; w < harness.ha_warmup || w == 0; w++)
+    {
+      struct timespec t0, t1;
+      clock_gettime (CLOCK_MONOTONIC, &t0);
+      long s = (*fun) (data);
+      clock_gettime (CLOCK_MONOTONIC, &t1);
+      if (s != expected)
+	{
+	  fprintf (stderr, "%s gave %ld, expected %ld\n", name, s, expected);
+	  exit (EXIT_FAILURE);
+	};
+      runns = elapsed_ns (&t0, &t1);
+    };
+  me->me_inner = (long) (1.0e6 / (runns > 1.0 ? runns : 1.0)) + 1;
+  if (me->me_inner > (1L << 20))
+    me->me_inner = 1L << 20;
+  uint64_t totcount[NB_COUNTERS] = { 0, 0, 0, 0 };
+  me->me_nbsamples = harness.ha_reps;
+  for (int r = 0; r < me->me_nbsamples; r++)
+    {
+      struct timespec t0, t1;
+      uint64_t before[NB_COUNTERS], after[NB_COUNTERS];
+      long s = 0;
+      if (harness.ha_perf)
+	{
+	  read_counters (before);
+	  switch_counters (true);
+	};
+      clock_gettime (CLOCK_MONOTONIC, &t0);
+      for (long i = 0; i < me->me_inner; i++)
+	s += (*fun) (data);
+      clock_gettime (CLOCK_MONOTONIC, &t1);
+      if (harness.ha_perf)
+	{
+	  switch_counters (false);
+	  read_counters (after);
+	  for (int c = 0; c < NB_COUNTERS; c++)
+	    totcount[c] += after[c] - before[c];
+	};
+      if (s != expected * me->me_inner)
+	abort ();
+      samples[r] = elapsed_ns (&t0, &t1) / (me->me_inner * (double) elems);
+    };
+  int n = me->me_nbsamples;
+  qsort (samples, n, sizeof (double), cmp_double);
+  me->me_min = samples[0];
+  me->me_median = sorted_median (samples, n);
+  for (int r = 0; r < n; r++)
+    devs[r] = fabs (samples[r] - me->me_median);
+  qsort (devs, n, sizeof (double), cmp_double);
+  me->me_mad = sorted_median (devs, n);
+  /// distribution free confidence interval of the median, from the
+  /// ranks n/2 -+ 1.96*sqrt(n)/2 of the sorted samples
+  int lo = (int) floor (n / 2.0 - 0.98 * sqrt (n));
+  int hi = (int) ceil (n / 2.0 + 0.98 * sqrt (n));
+  me->me_cilow = samples[lo < 0 ? 0 : lo];
+  me->me_cihigh = samples[hi > n - 1 ? n - 1 : hi];
+  me->me_counting = harness.ha_perf;
+  for (int c = 0; c < NB_COUNTERS; c++)
+    me->me_counters[c] = (harness.ha_perf && counter_fds[c] >= 0)
+      ? totcount[c] / ((double) n * me->me_inner * elems) : NAN;
+  return me;
+}				/* end measure */
+
+static void
+print_measure_header (void)
+{
+  if (harness.ha_json)
+    return;
+  printf ("# %-14s %9s %9s %8s %19s %9s", "measure", "elements",
+	  "ns/elem", "MAD", "95% CI", "min");
+  if (harness.ha_perf)
+    printf (" %8s %8s %5s %8s %8s", "cyc/el", "ins/el", "IPC",
+	    "cmiss/el", "bmiss/el");
+  putchar ('\n');
+}				/* end print_measure_header */
+
+static void
+print_measure (const struct measure_st *me)
+{
+  if (harness.ha_json)
+    return;
+  printf ("%-16s %9ld %9.3f %8.3f [%8.3f,%8.3f] %9.3f", me->me_name,
+	  me->me_elems, me->me_median, me->me_mad, me->me_cilow,
+	  me->me_cihigh, me->me_min);
+  if (me->me_counting)
+    printf (" %8.3f %8.3f %5.2f %8.4f %8.4f", me->me_counters[0],
+	    me->me_counters[1], me->me_counters[1] / me->me_counters[0],
+	    me->me_counters[2], me->me_counters[3]);
+  putchar ('\n');
+  fflush (stdout);
+}				/* end print_measure */
+
+static void
+print_json_double (double d)
+{
+  if (isnan (d) || isinf (d))
+    fputs ("null", stdout);
+  else
+    printf ("%.6g", d);
+}				/* end print_json_double */
+
+/* print all the measures as one JSON document, with what identifies
+   the compiler and the instruction set of this build */
+static void
+print_json_measures (const char *mode)
+{
+  struct utsname un;
+  memset (&un, 0, sizeof (un));
+  uname (&un);
+  printf ("{\n  \"program\": \"microbenchlist\",\n  \"mode\": \"%s\",\n",
+	  mode);
+  printf ("  \"compiler\": \"%s\",\n", __VERSION__);
+  printf ("  \"isa\": [\"%s\"%s%s%s%s%s],\n",
+#if defined(__x86_64__)
+	  "x86_64",
+#elif defined(__aarch64__)
+	  "aarch64",
+#else
+	  "other",
+#endif
+#ifdef __SSE4_2__
+	  ", \"sse4.2\"",
+#else
+	  "",
+#endif
+#ifdef __AVX__
+	  ", \"avx\"",
+#else
+	  "",
+#endif
+#ifdef __AVX2__
+	  ", \"avx2\"",
+#else
+	  "",
+#endif
+#ifdef __AVX512F__
+	  ", \"avx512f\"",
+#else
+	  "",
+#endif
+#ifdef __ARM_NEON
+	  ", \"neon\""
+#else
+	  ""
+#endif
+    );
+  printf ("  \"optimize\": %s,\n",
+#ifdef __OPTIMIZE__
+	  "true"
+#else
+	  "false"
+#endif
+    );
+  printf ("  \"host\": \"%s\",\n  \"kernel\": \"%s %s\",\n",
+	  un.nodename, un.sysname, un.release);
+  printf ("  \"warmup\": %d,\n  \"repetitions\": %d,\n  \"cpu\": %d,\n",
+	  harness.ha_warmup, harness.ha_reps, harness.ha_cpu);
+  printf ("  \"measures\": [");
+  for (int m = 0; m < nbmeasures; m++)
+    {
+      const struct measure_st *me = measures + m;
+      printf ("%s\n    {\"name\": \"%s\", \"elements\": %ld,"
+	      " \"bytes\": %zd, \"runs_per_sample\": %ld, \"samples\": %d,"
+	      " \"median_ns\": ", m ? "," : "", me->me_name, me->me_elems,
+	      me->me_bytes, me->me_inner, me->me_nbsamples);
+      print_json_double (me->me_median);
+      printf (", \"mad_ns\": ");
+      print_json_double (me->me_mad);
+      printf (", \"ci95_ns\": [");
+      print_json_double (me->me_cilow);
+      printf (", ");
+      print_json_double (me->me_cihigh);
+      printf ("], \"min_ns\": ");
+      print_json_double (me->me_min);
+      if (me->me_bytes > 0)
+	{
+	  printf (", \"gb_per_s\": ");
+	  print_json_double (me->me_bytes / (me->me_median * me->me_elems));
+	};
+      if (me->me_counting)
+	for (int c = 0; c < NB_COUNTERS; c++)
+	  {
+	    printf (", \"%s_per_elem\": ", counter_defs[c].cd_name);
+	    print_json_double (me->me_counters[c]);
+	  };
+      putchar ('}');
+    };
+  printf ("\n  ]\n}\n");
+}				/* end print_json_measures */
+
+static void
+pin_cpu (int cpu)
+{
+  cpu_set_t cs;
+  CPU_ZERO (&cs);
+  CPU_SET (cpu, &cs);
+  if (sched_setaffinity (0, sizeof (cs), &cs))
+    {
+      perror ("sched_setaffinity");
+      exit (EXIT_FAILURE);
+    };
+}				/* end pin_cpu */
+
+
+/***** the --layout benchmark: the same reduction over various memory
+  layouts of the same values, for sizes sweeping the cache levels ****/
+
+long
+sumunrolled (struct unode_st *u)
+{
+  long s = 0;
+  while (u)
+    {
+      for (long i = 0; i < u->ucnt; i++)
+	s += u->uv[i];
+      u = u->unext;
+    };
+  return s;
+}				/* end sumunrolled */
+
+/// four lanes of longs, using the GCC vector extension
+typedef long vlong4_t __attribute__((vector_size (4 * sizeof (long))));
+
+long
+sumarray (const long *arr, long n)
+{
+  vlong4_t acc = { 0, 0, 0, 0 };
+  long i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      vlong4_t v;
+      memcpy (&v, arr + i, sizeof (v));
+      acc += v;
+    };
+  long s = acc[0] + acc[1] + acc[2] + acc[3];
+  for (; i < n; i++)
+    s += arr[i];
+  return s;
+}				/* end sumarray */
+
+enum layout_en
+{
+  LAYOUT_MALLOC,		/// a node per malloc, in allocation order
+  LAYOUT_ARENA,			/// nodes contiguous in one arena, in order
+  LAYOUT_SHUFFLED,		/// arena nodes linked in random order
+  LAYOUT_UNROLLED,		/// UNROLL_K values per arena node
+  LAYOUT_ARRAY,			/// plain array, vector reduction
+  LAYOUT__LAST
+};
+
+static const char *const layout_names[LAYOUT__LAST] = {
+  "malloc", "arena", "shuffled", "unrolled", "array"
+};
+
+/// a built layout of the n values
+struct layout_st
+{
+  enum layout_en la_kind;
+  long la_n;
+  size_t la_bytes;		/// bytes of the traversed nodes or array
+  struct node_st *la_list;	/// for lists
+  struct node_st *la_arena;	/// for arena lists
+  struct unode_st *la_unrolled;
+  long *la_array;
+};
+
+static void *
+xcalloc (size_t nb, size_t sz)
+{
+  void *p = calloc (nb, sz);
+  if (!p)
+    {
+      perror ("calloc");
+      exit (EXIT_FAILURE);
+    };
+  return p;
+}				/* end xcalloc */
+
+static void
+build_layout (struct layout_st *la, enum layout_en kind, const long *vals,
+	      long n)
+{
+  memset (la, 0, sizeof (*la));
+  la->la_kind = kind;
+  la->la_n = n;
+  switch (kind)
+    {
+    case LAYOUT_MALLOC:
+      {
+	struct node_st *n0 = NULL;
+	for (long i = n - 1; i >= 0; i--)
+	  {
+	    struct node_st *nd = malloc (sizeof (struct node_st));
+	    if (!nd)
+	      {
+		perror ("malloc");
+		exit (EXIT_FAILURE);
+	      };
+	    nd->v = vals[i];
+	    nd->next = n0;
+	    n0 = nd;
+	  };
+	la->la_list = n0;
+	la->la_bytes = n * sizeof (struct node_st);
+      }
+      break;
+    case LAYOUT_ARENA:
+    case LAYOUT_SHUFFLED:
+      {
+	struct node_st *ar = xcalloc (n, sizeof (struct node_st));
+	long *perm = xcalloc (n, sizeof (long));
+	for (long i = 0; i < n; i++)
+	  perm[i] = i;
+	if (kind == LAYOUT_SHUFFLED)
+	  for (long i = n - 1; i > 0; i--)
+	    {
+	      long j = random () % (i + 1);
+	      long t = perm[i];
+	      perm[i] = perm[j];
+	      perm[j] = t;
+	    };
+	/// the i-th visited node is ar[perm[i]]
+	for (long i = 0; i < n; i++)
+	  {
+	    ar[perm[i]].v = vals[i];
+	    ar[perm[i]].next = (i + 1 < n) ? ar + perm[i + 1] : NULL;
+	  };
+	la->la_list = ar + perm[0];
+	la->la_arena = ar;
+	la->la_bytes = n * sizeof (struct node_st);
+	free (perm);
+      }
+      break;
+    case LAYOUT_UNROLLED:
+      {
+	long nbu = (n + UNROLL_K - 1) / UNROLL_K;
+	struct unode_st *ua = xcalloc (nbu, sizeof (struct unode_st));
+	for (long u = 0; u < nbu; u++)
+	  {
+	    ua[u].unext = (u + 1 < nbu) ? ua + u + 1 : NULL;
+	    for (long i = u * UNROLL_K; i < n && i < (u + 1) * UNROLL_K; i++)
+	      ua[u].uv[ua[u].ucnt++] = vals[i];
+	  };
+	la->la_unrolled = ua;
+	la->la_bytes = nbu * sizeof (struct unode_st);
+      }
+      break;
+    case LAYOUT_ARRAY:
+      la->la_array = xcalloc (n, sizeof (long));
+      memcpy (la->la_array, vals, n * sizeof (long));
+      la->la_bytes = n * sizeof (long);
+      break;
+    default:
+      abort ();
+    };
+}				/* end build_layout */
+
+static long
+run_layout (const struct layout_st *la)
+{
+  switch (la->la_kind)
+    {
+    case LAYOUT_MALLOC:
+    case LAYOUT_ARENA:
+    case LAYOUT_SHUFFLED:
+      return sumlist0 (la->la_list);
+    case LAYOUT_UNROLLED:
+      return sumunrolled (la->la_unrolled);
+    case LAYOUT_ARRAY:
+      return sumarray (la->la_array, la->la_n);
+    default:
+      abort ();
+    };
+}				/* end run_layout */
+
+static void
+free_layout (struct layout_st *la)
+{
+  if (la->la_kind == LAYOUT_MALLOC)
+    {
+      struct node_st *nd = la->la_list;
+      while (nd)
+	{
+	  struct node_st *nx = nd->next;
+	  free (nd);
+	  nd = nx;
+	};
+    };
+  free (la->la_arena);
+  free (la->la_unrolled);
+  free (la->la_array);
+  memset (la, 0, sizeof (*la));
+}				/* end free_layout */
+
+static long
+run_layout_fun (void *data)
+{
+  return run_layout ((const struct layout_st *) data);
+}				/* end run_layout_fun */
+
+/* run every layout for sizes doubling from 1024 elements to maxn,
+   reporting ns/element, node bytes bandwidth and cache misses/element */
+int
+layout_benchmark (long maxn)
+{
+  if (!harness.ha_json)
+    {
+      printf ("# layout benchmark up to %ld elements, caches L1d %ld L2 %ld"
+	      " L3 %ld bytes\n", maxn, sysconf (_SC_LEVEL1_DCACHE_SIZE),
+	      sysconf (_SC_LEVEL2_CACHE_SIZE),
+	      sysconf (_SC_LEVEL3_CACHE_SIZE));
+      print_measure_header ();
+    };
+  for (long n = 1024; n <= maxn; n *= 2)
+    {
+      long *vals = xcalloc (n, sizeof (long));
+      long expected = 0;
+      for (long i = 0; i < n; i++)
+	expected += (vals[i] = (random () & 0x3ffff));
+      for (int k = 0; k < LAYOUT__LAST; k++)
+	{
+	  struct layout_st la;
+	  char name[48];
+	  build_layout (&la, (enum layout_en) k, vals, n);
+	  snprintf (name, sizeof (name), "%s", layout_names[k]);
+	  struct measure_st *me =
+	    measure (name, run_layout_fun, &la, n, la.la_bytes, expected);
+	  if (!harness.ha_json)
+	    {
+	      print_measure (me);
+	      printf ("#%*s %.2f GB/s\n", 16, "",
+		      la.la_bytes / (me->me_median * n));
+	    };
+	  free_layout (&la);
+	};
+      free (vals);
+    };
+  if (harness.ha_json)
+    print_json_measures ("layout");
+  return 0;
+}				/* end layout_benchmark */
+
+/***** the --prefetch benchmark: latency hiding traversals of lists
+  linked in shuffled order, all checked against sumlist0 ****/
+
+/// prefetch the node pskip nodes ahead
+long
+sumlist_skip (struct pnode_st *n)
+{
+  long s = 0;
+  while (n)
+    {
+      if (n->pskip)
+	__builtin_prefetch (n->pskip, 0, 3);
+      s += n->pv;
+      n = n->pnext;
+    };
+  return s;
+}				/* end sumlist_skip */
+
+/// traverse m independent lists together, for memory level parallelism
+long
+sumlist_interleaved (struct node_st *const *heads, int m)
+{
+  struct node_st *cur[MAX_INTERLEAVE];
+  long s = 0;
+  int live = m;
+  memcpy (cur, heads, m * sizeof (struct node_st *));
+  while (live > 0)
+    {
+      live = 0;
+      for (int j = 0; j < m; j++)
+	if (cur[j])
+	  {
+	    s += cur[j]->v;
+	    cur[j] = cur[j]->next;
+	    live++;
+	  };
+    };
+  return s;
+}				/* end sumlist_interleaved */
+
+/// sum through a jump-pointer array, prefetching dist nodes ahead
+long
+sumlist_jumparray (struct node_st *const *arr, long n, long dist)
+{
+  long s = 0;
+  for (long i = 0; i < n; i++)
+    {
+      if (i + dist < n)
+	__builtin_prefetch (arr[i + dist], 0, 3);
+      s += arr[i]->v;
+    };
+  return s;
+}				/* end sumlist_jumparray */
+
+/// fill the jump-pointer array in a first pass, then sum through it
+long
+sumlist_jumpbuild (struct node_st *n, struct node_st **arr, long dist)
+{
+  long cnt = 0;
+  while (n)
+    {
+      arr[cnt++] = n;
+      n = n->next;
+    };
+  return sumlist_jumparray (arr, cnt, dist);
+}				/* end sumlist_jumpbuild */
+
+/// settings of the --prefetch benchmark
+int prefetch_skip = 8;		/// skip pointers go that many nodes ahead
+int prefetch_lists = 4;		/// number of interleaved lists
+long prefetch_dist = 16;	/// prefetch distance in jump arrays
+
+/// the structures traversed by the --prefetch benchmark
+struct latency_st
+{
+  struct layout_st lt_base;	/// the shuffled list
+  struct pnode_st *lt_parena;	/// shuffled list with skip pointers
+  struct pnode_st *lt_phead;
+  struct node_st *lt_iarena;	/// arena of the interleaved lists
+  struct node_st *lt_iheads[MAX_INTERLEAVE];
+  struct node_st **lt_jumps;	/// jump-pointer array
+};
+
+enum latency_en
+{
+  LATENCY_PLAIN,
+  LATENCY_SKIP,
+  LATENCY_INTERLEAVED,
+  LATENCY_JUMPARRAY,
+  LATENCY_JUMPBUILD,
+  LATENCY__LAST
+};
+
+static const char *const latency_names[LATENCY__LAST] = {
+  "plain", "skip", "interleaved", "jumparray", "jumpbuild"
+};
+
+/// the measured variant, for run_latency_fun
+static enum latency_en latency_variant;
+
+static long
+run_latency_fun (void *data)
+{
+  struct latency_st *lt = data;
+  switch (latency_variant)
+    {
+    case LATENCY_PLAIN:
+      return sumlist0 (lt->lt_base.la_list);
+    case LATENCY_SKIP:
+      return sumlist_skip (lt->lt_phead);
+    case LATENCY_INTERLEAVED:
+      return sumlist_interleaved (lt->lt_iheads, prefetch_lists);
+    case LATENCY_JUMPARRAY:
+      return sumlist_jumparray (lt->lt_jumps, lt->lt_base.la_n,
+				prefetch_dist);
+    case LATENCY_JUMPBUILD:
+      return sumlist_jumpbuild (lt->lt_base.la_list, lt->lt_jumps,
+				prefetch_dist);
+    default:
+      abort ();
+    };
+}				/* end run_latency_fun */
+
+static long *
+shuffled_permutation (long n)
+{
+  long *perm = xcalloc (n, sizeof (long));
+  for (long i = 0; i < n; i++)
+    perm[i] = i;
+  for (long i = n - 1; i > 0; i--)
+    {
+      long j = random () % (i + 1);
+      long t = perm[i];
+      perm[i] = perm[j];
+      perm[j] = t;
+    };
+  return perm;
+}				/* end shuffled_permutation */
+
+static void
+build_latency (struct latency_st *lt, const long *vals, long n)
+{
+  memset (lt, 0, sizeof (*lt));
+  build_layout (&lt->lt_base, LAYOUT_SHUFFLED, vals, n);
+  /// the skip list has its own shuffled order
+  long *perm = shuffled_permutation (n);
+  struct pnode_st *pa = xcalloc (n, sizeof (struct pnode_st));
+  for (long i = 0; i < n; i++)
+    {
+      pa[perm[i]].pv = vals[i];
+      pa[perm[i]].pnext = (i + 1 < n) ? pa + perm[i + 1] : NULL;
+      pa[perm[i]].pskip =
+	(i + prefetch_skip < n) ? pa + perm[i + prefetch_skip] : NULL;
+    };
+  lt->lt_parena = pa;
+  lt->lt_phead = pa + perm[0];
+  free (perm);
+  /// the interleaved lists are consecutive segments of another order
+  perm = shuffled_permutation (n);
+  struct node_st *ia = xcalloc (n, sizeof (struct node_st));
+  for (int j = 0; j < prefetch_lists; j++)
+    {
+      long lo = (n * j) / prefetch_lists, hi = (n * (j + 1)) / prefetch_lists;
+      lt->lt_iheads[j] = (lo < hi) ? ia + perm[lo] : NULL;
+      for (long i = lo; i < hi; i++)
+	{
+	  ia[perm[i]].v = vals[i];
+	  ia[perm[i]].next = (i + 1 < hi) ? ia + perm[i + 1] : NULL;
+	};
+    };
+  lt->lt_iarena = ia;
+  free (perm);
+  lt->lt_jumps = xcalloc (n, sizeof (struct node_st *));
+  long cnt = 0;
+  for (struct node_st * nd = lt->lt_base.la_list; nd; nd = nd->next)
+    lt->lt_jumps[cnt++] = nd;
+}				/* end build_latency */
+
+static void
+free_latency (struct latency_st *lt)
+{
+  free_layout (&lt->lt_base);
+  free (lt->lt_parena);
+  free (lt->lt_iarena);
+  free (lt->lt_jumps);
+  memset (lt, 0, sizeof (*lt));
+}				/* end free_latency */
+
+/* run the latency hiding variants for sizes doubling from 1024
+   elements to maxn */
+int
+prefetch_benchmark (long maxn)
+{
+  if (!harness.ha_json)
+    {
+      printf ("# prefetch benchmark up to %ld elements, skip %d,"
+	      " %d interleaved lists, jump distance %ld\n",
+	      maxn, prefetch_skip, prefetch_lists, prefetch_dist);
+      print_measure_header ();
+    };
+  for (long n = 1024; n <= maxn; n *= 2)
+    {
+      struct latency_st lt;
+      long *vals = xcalloc (n, sizeof (long));
+      for (long i = 0; i < n; i++)
+	vals[i] = (random () & 0x3ffff);
+      build_latency (&lt, vals, n);
+      long expected = sumlist0 (lt.lt_base.la_list);
+      for (int k = 0; k < LATENCY__LAST; k++)
+	{
+	  char name[48];
+	  latency_variant = (enum latency_en) k;
+	  snprintf (name, sizeof (name), "%s", latency_names[k]);
+	  print_measure (measure (name, run_latency_fun, &lt, n,
+				  n * sizeof (struct node_st), expected));
+	};
+      free_latency (&lt);
+      free (vals);
+    };
+  if (harness.ha_json)
+    print_json_measures ("prefetch");
+  return 0;
+}				/* end prefetch_benchmark */
+
+/***** the --threads benchmark: one list built in segments, whose
+  sums are computed by 1 to T pinned threads, each summing consecutive
+  segments into its own cache line, optionally with the nodes of each
+  segment moved to the NUMA node of the thread summing it ****/
+
+/// a segment of the list, recorded during its construction
+struct segment_st
+{
+  struct node_st *sg_head;
+  long sg_len;
+  struct node_st *sg_arena;	/// page aligned nodes of the segment
+};
+
+/// a partial sum, alone in its cache line to avoid false sharing
+struct partial_st
+{
+  _Alignas (CACHE_LINE) long ps_sum;
+  char ps_pad[CACHE_LINE - sizeof (long)];
+};
+
+/// the thread pool of one measure
+struct tpool_st
+{
+  int tp_nbthreads;
+  int tp_nbsegments;
+  struct segment_st *tp_segments;
+  pthread_t tp_threads[MAX_THREADS];
+  pthread_barrier_t tp_start, tp_end;
+  volatile bool tp_quit;
+  bool tp_numa;			/// place the segments, set before the threads
+  bool tp_numafailed;		/// set atomically by a failed placement
+  struct partial_st tp_partials[MAX_THREADS];
+};
+
+/// the thread argument, its rank in the pool
+struct tpool_arg
+{
+  struct tpool_st *ta_pool;
+  int ta_rank;
+};
+
+bool numa_placement = false;	/// with --numa
+int max_threads = 0;		/// with --threads=T, else online CPUs
+
+long
+sumsegment (struct node_st *n, long len)
+{
+  long s = 0;
+  for (long i = 0; i < len; i++)
+    {
+      s += n->v;
+      n = n->next;
+    };
+  return s;
+}				/* end sumsegment */
+
+/// the consecutive segments summed by the thread of that rank
+static void
+rank_segments (const struct tpool_st *tp, int rank, int *plo, int *phi)
+{
+  *plo = (int) ((long) tp->tp_nbsegments * rank / tp->tp_nbthreads);
+  *phi = (int) ((long) tp->tp_nbsegments * (rank + 1) / tp->tp_nbthreads);
+}				/* end rank_segments */
+
+static void
+sum_rank (struct tpool_st *tp, int rank)
+{
+  int lo = 0, hi = 0;
+  long s = 0;
+  rank_segments (tp, rank, &lo, &hi);
+  for (int g = lo; g < hi; g++)
+    s += sumsegment (tp->tp_segments[g].sg_head, tp->tp_segments[g].sg_len);
+  tp->tp_partials[rank].ps_sum = s;
+}				/* end sum_rank */
+
+/* move the segments of the calling thread of that rank to its NUMA
+   node, return false on failure */
+static bool
+place_rank (struct tpool_st *tp, int rank)
+{
+  unsigned cpu = 0, node = 0;
+  unsigned long nodemask[16];
+  int lo = 0, hi = 0;
+  if (syscall (SYS_getcpu, &cpu, &node, NULL) < 0
+      || node >= 8 * sizeof (nodemask))
+    return true;
+  memset (nodemask, 0, sizeof (nodemask));
+  nodemask[node / (8 * sizeof (long))] |= 1UL << (node % (8 * sizeof (long)));
+  rank_segments (tp, rank, &lo, &hi);
+  for (int g = lo; g < hi; g++)
+    {
+      struct segment_st *sg = tp->tp_segments + g;
+      size_t len = sg->sg_len * sizeof (struct node_st);
+      if (syscall (SYS_mbind, sg->sg_arena, len, MBL_MPOL_BIND, nodemask,
+		   8 * sizeof (nodemask), MBL_MPOL_MF_MOVE) < 0)
+	{
+	  perror ("mbind");
+	  return false;
+	};
+    };
+  return true;
+}				/* end place_rank */
+
+static void *
+tpool_worker (void *arg)
+{
+  struct tpool_arg *ta = arg;
+  struct tpool_st *tp = ta->ta_pool;
+  int rank = ta->ta_rank;
+  if (tp->tp_numa && !place_rank (tp, rank))
+    __atomic_store_n (&tp->tp_numafailed, true, __ATOMIC_RELAXED);
+  for (;;)
+    {
+      pthread_barrier_wait (&tp->tp_start);
+      if (tp->tp_quit)
+	break;
+      sum_rank (tp, rank);
+      pthread_barrier_wait (&tp->tp_end);
+    };
+  return NULL;
+}				/* end tpool_worker */
+
+/// one parallel run: the calling thread sums as rank 0
+static long
+run_tpool_fun (void *data)
+{
+  struct tpool_st *tp = data;
+  long s = 0;
+  if (tp->tp_nbthreads > 1)
+    pthread_barrier_wait (&tp->tp_start);
+  sum_rank (tp, 0);
+  if (tp->tp_nbthreads > 1)
+    pthread_barrier_wait (&tp->tp_end);
+  for (int t = 0; t < tp->tp_nbthreads; t++)
+    s += tp->tp_partials[t].ps_sum;
+  return s;
+}				/* end run_tpool_fun */
+
+static void
+pin_thread (pthread_t th, int cpu)
+{
+  cpu_set_t cs;
+  CPU_ZERO (&cs);
+  CPU_SET (cpu, &cs);
+  int err = pthread_setaffinity_np (th, sizeof (cs), &cs);
+  if (err)
+    fprintf (stderr, "pthread_setaffinity_np to cpu#%d: %s\n", cpu,
+	     strerror (err));
+}				/* end pin_thread */
+
+/* sum the n nodes list with 1 to max_threads threads, reporting the
+   scaling of the reduction */
+int
+threads_benchmark (long n)
+{
+  int ncpu = (int) sysconf (_SC_NPROCESSORS_ONLN);
+  int maxt = (max_threads > 0) ? max_threads : ncpu;
+  /// rank 0 runs on the --cpu one, and the other ranks on the next ones
+  int firstcpu = (harness.ha_cpu >= 0) ? harness.ha_cpu % ncpu : 0;
+  if (maxt > MAX_THREADS)
+    maxt = MAX_THREADS;
+  int nbseg = maxt * SEGMENTS_PER_THREAD;
+  if (nbseg > n)
+    nbseg = (int) n;
+  struct segment_st *segs = xcalloc (nbseg, sizeof (struct segment_st));
+  long pagesize = sysconf (_SC_PAGESIZE);
+  /// build the list segment by segment, each in its own arena
+  struct node_st *root = NULL, *last = NULL;
+  for (int g = 0; g < nbseg; g++)
+    {
+      long len = (n * (g + 1)) / nbseg - (n * g) / nbseg;
+      size_t sz = len * sizeof (struct node_st);
+      sz = (sz + pagesize - 1) / pagesize * pagesize;
+      struct node_st *ar = aligned_alloc (pagesize, sz);
+      if (!ar)
+	{
+	  perror ("aligned_alloc segment");
+	  exit (EXIT_FAILURE);
+	};
+      for (long i = 0; i < len; i++)
+	{
+	  ar[i].v = (random () & 0x3ffff);
+	  ar[i].next = NULL;
+	  if (last)
+	    last->next = ar + i;
+	  else
+	    root = ar + i;
+	  last = ar + i;
+	};
+      segs[g].sg_head = ar;
+      segs[g].sg_len = len;
+      segs[g].sg_arena = ar;
+    };
+  long expected = sumlist0 (root);
+  if (!harness.ha_json)
+    {
+      printf ("# threads benchmark of %ld nodes in %d segments,"
+	      " 1 to %d threads on %d cpus%s\n", n, nbseg, maxt, ncpu,
+	      numa_placement ? ", NUMA placement" : "");
+      print_measure_header ();
+    };
+  double onethread = 0.0;
+  for (int t = 1; t <= maxt; t++)
+    {
+      static struct tpool_st tp;
+      struct tpool_arg targs[MAX_THREADS];
+      char name[48];
+      memset (&tp, 0, sizeof (tp));
+      tp.tp_nbthreads = t;
+      tp.tp_nbsegments = nbseg;
+      tp.tp_segments = segs;
+      pthread_barrier_init (&tp.tp_start, NULL, t);
+      pthread_barrier_init (&tp.tp_end, NULL, t);
+      pin_thread (pthread_self (), firstcpu);
+      tp.tp_numa = numa_placement && place_rank (&tp, 0);
+      for (int r = 1; r < t; r++)
+	{
+	  pthread_attr_t attr;
+	  cpu_set_t cs;
+	  CPU_ZERO (&cs);
+	  CPU_SET ((firstcpu + r) % ncpu, &cs);
+	  pthread_attr_init (&attr);
+	  pthread_attr_setaffinity_np (&attr, sizeof (cs), &cs);
+	  targs[r].ta_pool = &tp;
+	  targs[r].ta_rank = r;
+	  int err = pthread_create (tp.tp_threads + r, &attr, tpool_worker,
+				    targs + r);
+	  pthread_attr_destroy (&attr);
+	  if (err)
+	    {
+	      fprintf (stderr, "pthread_create: %s\n", strerror (err));
+	      exit (EXIT_FAILURE);
+	    };
+	};
+      snprintf (name, sizeof (name), "threads=%d", t);
+      struct measure_st *me = measure (name, run_tpool_fun, &tp, n,
+				       n * sizeof (struct node_st),
+				       expected);
+      if (t == 1)
+	onethread = me->me_median;
+      print_measure (me);
+      if (!harness.ha_json)
+	printf ("#%*s speedup %.2f, %.2f GB/s\n", 16, "",
+		onethread / me->me_median,
+		sizeof (struct node_st) / me->me_median);
+      tp.tp_quit = true;
+      if (t > 1)
+	pthread_barrier_wait (&tp.tp_start);
+      for (int r = 1; r < t; r++)
+	pthread_join (tp.tp_threads[r], NULL);
+      /// the joined threads cannot place anymore
+      if (!tp.tp_numa || tp.tp_numafailed)
+	numa_placement = false;
+      pthread_barrier_destroy (&tp.tp_start);
+      pthread_barrier_destroy (&tp.tp_end);
+    };
+  if (harness.ha_json)
+    print_json_measures ("threads");
+  for (int g = 0; g < nbseg; g++)
+    free (segs[g].sg_arena);
+  free (segs);
+  return 0;
+}				/* end threads_benchmark */
+
+/// a sumlist function called by the harness
+struct sumlist_call
+{
+  long (*sc_fun) (struct node_st *);
+  struct node_st *sc_root;
+};
+
+static long
+run_sumlist (void *data)
+{
+  struct sumlist_call *sc = data;
+  return (*sc->sc_fun) (sc->sc_root);
+}				/* end run_sumlist */
+
+static void
+usage (const char *progname)
+{
+  printf ("usage: %s [options] [kilo-nodes]\n"
+	  "\t --layout          # compare memory layouts, up to kilo-nodes\n"
+	  "\t --prefetch        # compare latency hiding, up to kilo-nodes\n"
+	  "\t --skip=K          # skip pointers K nodes ahead, default %d\n"
+	  "\t --lists=M         # M interleaved lists, default %d\n"
+	  "\t --distance=D      # jump array prefetch distance, default %ld\n"
+	  "\t --threads[=T]     # parallel sums with 1 to T threads\n"
+	  "\t --numa            # with --threads, move segments to NUMA nodes\n"
+	  "\t --warmup=N        # warm-up runs, default %d\n"
+	  "\t --reps=N          # measured samples, default %d\n"
+	  "\t --cpu=N           # pin to CPU N\n"
+	  "\t --perf            # perf_event_open counters, of all threads\n"
+	  "\t --json            # JSON output\n",
+	  progname, prefetch_skip, prefetch_lists, prefetch_dist,
+	  harness.ha_warmup, harness.ha_reps);
+}				/* end usage */
+
 int
 main (int argc, char **argv)
 {
-  long k = (argc > 1) ? (1024 * atoi (argv[1])) : (1024 * 1024);
+  bool layout = false;
+  bool prefetch = false;
+  bool threads = false;
+  long kilo = 0;
+  ptrout = stdout;
+  for (int ix = 1; ix < argc; ix++)
+    {
+      const char *arg = argv[ix];
+      if (!strcmp (arg, "--help") || !strcmp (arg, "-h"))
+	{
+	  usage (argv[0]);
+	  return 0;
+	}
+      else if (!strcmp (arg, "--layout"))
+	layout = true;
+      else if (!strcmp (arg, "--prefetch"))
+	prefetch = true;
+      else if (!strcmp (arg, "--threads"))
+	threads = true;
+      else if (!strncmp (arg, "--threads=", 10))
+	{
+	  threads = true;
+	  max_threads = atoi (arg + 10);
+	}
+      else if (!strcmp (arg, "--numa"))
+	numa_placement = true;
+      else if (!strncmp (arg, "--skip=", 7))
+	prefetch_skip = atoi (arg + 7);
+      else if (!strncmp (arg, "--lists=", 8))
+	prefetch_lists = atoi (arg + 8);
+      else if (!strncmp (arg, "--distance=", 11))
+	prefetch_dist = atol (arg + 11);
+      else if (!strncmp (arg, "--warmup=", 9))
+	harness.ha_warmup = atoi (arg + 9);
+      else if (!strncmp (arg, "--reps=", 7))
+	harness.ha_reps = atoi (arg + 7);
+      else if (!strncmp (arg, "--cpu=", 6))
+	harness.ha_cpu = atoi (arg + 6);
+      else if (!strcmp (arg, "--perf"))
+	harness.ha_perf = true;
+      else if (!strcmp (arg, "--json"))
+	harness.ha_json = true;
+      else if (arg[0] >= '0' && arg[0] <= '9')
+	kilo = atol (arg);
+      else
+	{
+	  usage (argv[0]);
+	  return 1;
+	};
+    };
+  if (prefetch_skip < 1)
+    prefetch_skip = 1;
+  if (prefetch_lists < 1)
+    prefetch_lists = 1;
+  else if (prefetch_lists > MAX_INTERLEAVE)
+    prefetch_lists = MAX_INTERLEAVE;
+  if (prefetch_dist < 0)
+    prefetch_dist = 0;
+  if (harness.ha_reps < 1)
+    harness.ha_reps = 1;
+  else if (harness.ha_reps > MAX_SAMPLES)
+    harness.ha_reps = MAX_SAMPLES;
+  if (harness.ha_json)
+    ptrout = stderr;
+  if (harness.ha_cpu >= 0)
+    pin_cpu (harness.ha_cpu);
+  if (harness.ha_perf && !open_counters ())
+    {
+      fprintf (stderr, "%s: no perf counters, see"
+	       " /proc/sys/kernel/perf_event_paranoid\n", argv[0]);
+      harness.ha_perf = false;
+    };
+  srandom ((int) time (NULL) + (int) getpid ());
+  if (threads)
+    {
+      int r = threads_benchmark ((kilo > 0 ? kilo : 16384) * 1024);
+      close_counters ();
+      return r;
+    };
+  if (prefetch)
+    {
+      int r = prefetch_benchmark ((kilo > 0 ? kilo : 4096) * 1024);
+      close_counters ();
+      return r;
+    };
+  if (layout)
+    {
+      int r = layout_benchmark ((kilo > 0 ? kilo : 4096) * 1024);
+      close_counters ();
+      return r;
+    };
+  long k = (kilo > 0) ? (1024 * kilo) : (1024 * 1024);
   if (k < 1000)
     k = 1000;
-  printf ("start k=%ld\n", k);
-  srandom ((int) time (NULL) + (int) getpid ());
   struct node_st *root = NULL;
   struct node_st *n = NULL;
   for (long i = 0; i < k; i++)
@@ -182,64 +1433,31 @@ main (int argc, char **argv)
     }
   root = n;
   n = NULL;
-  clock_t cl0 = clock ();
-  printf ("created %ld nodes in %.4f sec (%.4f µs/node) root@%p\n",
-	  k, cl0 * 1.0e-6, (cl0 * 1.0) / (double) k, root);
-  long l0 = sumlist0 (root);
-  clock_t cl1 = clock ();
-  printf ("counted l0=%ld in %.4f sec (%.4f µs/node)\n",
-	  l0, (cl1 - cl0) * 1.0e-6, ((cl1 - cl0) * 1.0) / (double) k);
-  long l1 = sumlist1 (root);
-  clock_t cl2 = clock ();
-  printf ("counted l1=%ld in %.4f sec (%.4f µs/node)\n",
-	  l1, (cl2 - cl1) * 1.0e-6, ((cl2 - cl1) * 1.0) / (double) k);
-  long l2 = sumlist2 (root);
-  clock_t cl3 = clock ();
-  printf ("counted l2=%ld in %.4f sec (%.4f µs/node)\n",
-	  l2, (cl3 - cl2) * 1.0e-6, ((cl3 - cl2) * 1.0) / (double) k);
-  long l3 = sumlist3 (root);
-  clock_t cl4 = clock ();
-  printf ("counted l3=%ld in %.4f sec (%.4f µs/node)\n",
-	  l3, (cl4 - cl3) * 1.0e-6, ((cl4 - cl3) * 1.0) / (double) k);
-  long l4 = sumlist4 (root);
-  clock_t cl5 = clock ();
-  printf ("counted l4=%ld in %.4f sec (%.4f µs/node)\n",
-	  l4, (cl5 - cl4) * 1.0e-6, ((cl5 - cl4) * 1.0) / (double) k);
-  long l5 = sumlist5 (root);
-  clock_t cl6 = clock ();
-  printf ("counted l5=%ld in %.4f sec (%.4f µs/node)\n",
-	  l5, (cl6 - cl5) * 1.0e-6, ((cl6 - cl5) * 1.0) / (double) k);
-  ///
-  cl0 = clock ();
-  l0 = sumlist0 (root);
-  cl1 = clock ();
-  printf ("recounted l0=%ld in %.4f sec (%.4f µs/node)\n",
-	  l0, (cl1 - cl0) * 1.0e-6, ((cl1 - cl0) * 1.0) / (double) k);
-  l1 = sumlist1 (root);
-  cl2 = clock ();
-  printf ("recounted l1=%ld in %.4f sec (%.4f µs/node)\n",
-	  l1, (cl2 - cl1) * 1.0e-6, ((cl2 - cl1) * 1.0) / (double) k);
-  l2 = sumlist2 (root);
-  cl3 = clock ();
-  printf ("recounted l2=%ld in %.4f sec (%.4f µs/node)\n",
-	  l2, (cl3 - cl2) * 1.0e-6, ((cl3 - cl2) * 1.0) / (double) k);
-  l3 = sumlist3 (root);
-  cl4 = clock ();
-  printf ("recounted l3=%ld in %.4f sec (%.4f µs/node)\n",
-	  l3, (cl4 - cl3) * 1.0e-6, ((cl4 - cl3) * 1.0) / (double) k);
-  l4 = sumlist4 (root);
-  cl5 = clock ();
-  printf ("recounted l4=%ld in %.4f sec (%.4f µs/node)\n",
-	  l4, (cl5 - cl4) * 1.0e-6, ((cl5 - cl4) * 1.0) / (double) k);
-  l5 = sumlist5 (root);
-  cl6 = clock ();
-  printf ("recounted l5=%ld in %.4f sec (%.4f µs/node)\n",
-	  l5, (cl6 - cl5) * 1.0e-6, ((cl6 - cl5) * 1.0) / (double) k);
+  if (!harness.ha_json)
+    {
+      printf ("# %ld nodes, root@%p\n", k, root);
+      print_measure_header ();
+    };
+  long (*const sumlists[]) (struct node_st *) = {
+    sumlist0, sumlist1, sumlist2, sumlist3, sumlist4, sumlist5
+  };
+  long expected = sumlist0 (root);
+  for (int f = 0; f < (int) (sizeof (sumlists) / sizeof (sumlists[0])); f++)
+    {
+      char name[48];
+      struct sumlist_call sc = { sumlists[f], root };
+      snprintf (name, sizeof (name), "sumlist%d", f);
+      print_measure (measure (name, run_sumlist, &sc, k,
+			      k * sizeof (struct node_st), expected));
+    };
+  if (harness.ha_json)
+    print_json_measures ("sumlist");
+  close_counters ();
   return 0;
 }				/* end main */
 
 void
 printptrint (const char *str, int lin, void *ptr, int cnt)
 {
-  printf ("! %s l:%d: %p #%d\n", str, lin, ptr, cnt);
+  fprintf (ptrout, "! %s l:%d: %p #%d\n", str, lin, ptr, cnt);
 }